@@ -1,23 +1,27 @@
-// directory.cc 
+// directory.cc
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
-//	entry represents a single file, and contains the file name,
-//	and the location of the file header on disk.  The fixed size
-//	of each directory entry means that we have the restriction
-//	of a fixed maximum size for file names.
+//	The directory is a hash table, stored in a regular Nachos file.
+//	The first sector of the file is a DirectoryInfo, giving the
+//	number of buckets in the table; each bucket after it is one
+//	sector, holding variable length entries for the names that hash
+//	to it.  Each entry represents a single file, and contains the
+//	file name, whether the file is itself a directory, and the
+//	location of the file header on disk.
 //
-//	The constructor initializes an empty directory of a certain size;
-//	we use ReadFrom/WriteBack to fetch the contents of the directory
-//	from disk, and to write back any modifications back to disk.
+//	A full bucket spills new entries into the next bucket over
+//	(linear probing), and is marked so that lookups keep going.  To
+//	keep probe sequences short, the table doubles in size (and
+//	every entry is rehashed) once there are more than MaxBucketLoad
+//	entries per bucket on average.  The directory file grows as
+//	needed, since files are extensible.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	The directory is not cached in memory; each operation reads only
+//	the buckets it needs, and writes back any modifications right
+//	away.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -25,153 +29,389 @@
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// HashName
+// 	Hash the first "len" characters of a file name (FNV-1a).
+//----------------------------------------------------------------------
+
+static unsigned int
+HashName(char *name, int len)
+{
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < len; i++) {
+	hash ^= (unsigned char) name[i];
+	hash *= 16777619u;
+    }
+    return hash;
+}
+
+//----------------------------------------------------------------------
+// EntryName, EntryMatches
+// 	The name stored in a directory entry directly follows it, and
+//	is not null terminated.
+//----------------------------------------------------------------------
+
+static char *
+EntryName(DirectoryEntry *entry)
+{
+    return (char *)entry + sizeof(DirectoryEntry);
+}
+
+static bool
+EntryMatches(DirectoryEntry *entry, char *name, int len)
+{
+    return (entry->nameLen == len) && !strncmp(EntryName(entry), name, len);
+}
+
+//----------------------------------------------------------------------
+// PutEntry
+// 	Add an entry to the end of a bucket in memory.  Return FALSE if
+//	there is no room left in the bucket.
+//----------------------------------------------------------------------
+
+static bool
+PutEntry(DirectoryBucket *bucket, char *name, int len, int sector, bool isDir)
+{
+    DirectoryEntry *entry;
+
+    if (bucket->used + DirEntryLength(len) > BucketDataSize)
+	return FALSE;
+    entry = (DirectoryEntry *) &bucket->data[bucket->used];
+    entry->sector = sector;
+    entry->isDir = isDir;
+    entry->nameLen = len;
+    memcpy(EntryName(entry), name, len);
+    bucket->used += DirEntryLength(len);
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
-// 	Initialize a directory; initially, the directory is completely
-//	empty.  If the disk is being formatted, an empty directory
-//	is all we need, but otherwise, we need to call FetchFrom in order
-//	to initialize it from disk.
+// 	Initialize a directory stored in "dirFile".  If the file is
+//	brand new, Initialize must be called to turn it into an empty
+//	directory.
 //
-//	"size" is the number of entries in the directory
+//	"dirFile" -- the file holding the directory; it must stay open
+//		while the Directory is in use
 //----------------------------------------------------------------------
 
-Directory::Directory(int size)
+Directory::Directory(OpenFile *dirFile)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    file = dirFile;
+    info.numBuckets = 0;
+    info.numEntries = 0;
+    (void) file->ReadAt((char *)&info, sizeof(DirectoryInfo), 0);
 }
 
 //----------------------------------------------------------------------
 // Directory::~Directory
-// 	De-allocate directory data structure.
+// 	De-allocate directory data structure.  The directory's file
+//	stays open; it belongs to the caller.
 //----------------------------------------------------------------------
 
 Directory::~Directory()
-{ 
-    delete [] table;
-} 
+{
+}
 
 //----------------------------------------------------------------------
-// Directory::FetchFrom
-// 	Read the contents of the directory from disk.
-//
-//	"file" -- file containing the directory contents
+// Directory::Initialize
+// 	Write an empty directory, with room for "numBuckets" buckets,
+//	into the directory's file.  Return FALSE if there isn't enough
+//	space on disk.
 //----------------------------------------------------------------------
 
-void
-Directory::FetchFrom(OpenFile *file)
+bool
+Directory::Initialize(int numBuckets)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    DirectoryBucket *table = new DirectoryBucket[numBuckets];
+    int size = numBuckets * SectorSize;
+    bool success;
+
+    memset(table, 0, size);
+    success = (file->WriteAt((char *)table, size, SectorSize) == size);
+    if (success) {
+	info.numBuckets = numBuckets;
+	info.numEntries = 0;
+	WriteInfo();
+	file->Flush();
+    }
+    delete [] table;
+    return success;
 }
 
 //----------------------------------------------------------------------
-// Directory::WriteBack
-// 	Write any modifications to the directory back to disk
-//
-//	"file" -- file to contain the new directory contents
+// Directory::ReadBucket, WriteBucket, WriteInfo
+// 	Move one sector of the directory between disk and memory.
+//	Bucket "which" is stored in sector "which" + 1 of the file.
 //----------------------------------------------------------------------
 
 void
-Directory::WriteBack(OpenFile *file)
+Directory::ReadBucket(int which, DirectoryBucket *bucket)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    (void) file->ReadAt((char *)bucket, SectorSize, (which + 1) * SectorSize);
+}
+
+void
+Directory::WriteBucket(int which, DirectoryBucket *bucket)
+{
+    (void) file->WriteAt((char *)bucket, SectorSize, (which + 1) * SectorSize);
+}
+
+void
+Directory::WriteInfo()
+{
+    (void) file->WriteAt((char *)&info, sizeof(DirectoryInfo), 0);
 }
 
 //----------------------------------------------------------------------
-// Directory::FindIndex
-// 	Look up file name in directory, and return its location in the table of
-//	directory entries.  Return -1 if the name isn't in the directory.
+// Directory::FindEntry
+// 	Look up file name in directory.  Return the offset of its entry
+//	within the bucket that holds it, and leave the bucket (and its
+//	number) in "bucket" and "which".  Return -1 if the name isn't
+//	in the directory.
+//
+//	We start at the bucket the name hashes to, and keep going to the
+//	next bucket only while the bucket we're looking at has overflowed.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
 int
-Directory::FindIndex(char *name)
+Directory::FindEntry(char *name, int *which, DirectoryBucket *bucket)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
+    int len = strlen(name);
+    DirectoryEntry *entry;
+
+    if (info.numBuckets == 0)
+	return -1;
+    *which = HashName(name, len) % info.numBuckets;
+    for (int i = 0; i < info.numBuckets; i++) {
+	ReadBucket(*which, bucket);
+	for (int offset = 0; offset < bucket->used;
+			offset += DirEntryLength(entry->nameLen)) {
+	    entry = (DirectoryEntry *) &bucket->data[offset];
+	    if (EntryMatches(entry, name, len))
+		return offset;
+	}
+	if (!bucket->overflow)
+	    break;
+	*which = (*which + 1) % info.numBuckets;
+    }
     return -1;		// name not in directory
 }
 
 //----------------------------------------------------------------------
 // Directory::Find
 // 	Look up file name in directory, and return the disk sector number
-//	where the file's header is stored. Return -1 if the name isn't 
+//	where the file's header is stored. Return -1 if the name isn't
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDir" -- if not NULL, set to whether the file is a directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(char *name)
+Directory::Find(char *name, bool *isDir)
 {
-    int i = FindIndex(name);
+    DirectoryBucket bucket;
+    DirectoryEntry *entry;
+    int which, offset;
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    offset = FindEntry(name, &which, &bucket);
+    if (offset == -1)
+	return -1;
+    entry = (DirectoryEntry *) &bucket.data[offset];
+    if (isDir != NULL)
+	*isDir = entry->isDir;
+    return entry->sector;
+}
+
+//----------------------------------------------------------------------
+// Directory::Insert
+// 	Put a new entry into the first bucket, starting from the one
+//	the name hashes to, that has room for it.  Buckets we pass over
+//	are marked as having overflowed.  Return FALSE if every bucket
+//	is full.
+//----------------------------------------------------------------------
+
+bool
+Directory::Insert(char *name, int newSector, bool isDir)
+{
+    DirectoryBucket bucket;
+    int len = strlen(name);
+    int which = HashName(name, len) % info.numBuckets;
+
+    for (int i = 0; i < info.numBuckets; i++) {
+	ReadBucket(which, &bucket);
+	if (PutEntry(&bucket, name, len, newSector, isDir)) {
+	    WriteBucket(which, &bucket);
+	    info.numEntries++;
+	    WriteInfo();
+	    return TRUE;
+	}
+	if (!bucket.overflow) {
+	    bucket.overflow = TRUE;
+	    WriteBucket(which, &bucket);
+	}
+	which = (which + 1) % info.numBuckets;
+    }
+    return FALSE;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, if
+//	the name is too long, or if the directory is full and there is
+//	no room on disk to make it bigger.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the file being added a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
-{ 
-    if (FindIndex(name) != -1)
+Directory::Add(char *name, int newSector, bool isDir)
+{
+    DirectoryBucket bucket;
+    int which, len = strlen(name);
+
+    if ((len == 0) || (len > FileNameMaxLen) || (info.numBuckets == 0))
 	return FALSE;
+    if (FindEntry(name, &which, &bucket) != -1)
+	return FALSE;
+
+    if (info.numEntries >= info.numBuckets * MaxBucketLoad)
+	(void) Grow();		// if this fails, we just get longer probes
+    if (Insert(name, newSector, isDir))
+	return TRUE;
+    return Grow() && Insert(name, newSector, isDir);
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Double the number of buckets in the directory, and rehash every
+//	entry into the new table.  Return FALSE, leaving the directory
+//	as it was, if the directory file can't grow.
+//
+//	The file is extended (with empty buckets) before anything is
+//	rehashed, so running out of disk space can't leave us with a
+//	half-written table.
+//----------------------------------------------------------------------
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
+bool
+Directory::Grow()
+{
+    int oldBuckets = info.numBuckets;
+    int newBuckets = 2 * oldBuckets;
+    int tailSize = (newBuckets - oldBuckets) * SectorSize;
+    DirectoryBucket *oldTable, *newTable;
+    DirectoryEntry *entry;
+    int which, len;
+
+    if (DirectoryFileLength(newBuckets) > MaxFileSize)
+	return FALSE;
+
+    DEBUG('f', "Growing directory to %d buckets\n", newBuckets);
+    oldTable = new DirectoryBucket[oldBuckets];
+    newTable = new DirectoryBucket[newBuckets];
+    memset(newTable, 0, newBuckets * SectorSize);
+    if (file->WriteAt((char *) &newTable[oldBuckets], tailSize,
+			DirectoryFileLength(oldBuckets)) != tailSize) {
+	delete [] oldTable;
+	delete [] newTable;
+	return FALSE;		// no room on disk
+    }
+
+    (void) file->ReadAt((char *)oldTable, oldBuckets * SectorSize, SectorSize);
+    for (int i = 0; i < oldBuckets; i++)
+	for (int offset = 0; offset < oldTable[i].used; offset +=
+				DirEntryLength(entry->nameLen)) {
+	    entry = (DirectoryEntry *) &oldTable[i].data[offset];
+	    len = entry->nameLen;
+	    which = HashName(EntryName(entry), len) % newBuckets;
+	    while (!PutEntry(&newTable[which], EntryName(entry), len,
+				entry->sector, entry->isDir)) {
+		newTable[which].overflow = TRUE;
+		which = (which + 1) % newBuckets;
+	    }
 	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+
+    (void) file->WriteAt((char *)newTable, newBuckets * SectorSize, SectorSize);
+    info.numBuckets = newBuckets;
+    WriteInfo();
+    file->Flush();		// make the new length stick
+    delete [] oldTable;
+    delete [] newTable;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // Directory::Remove
 // 	Remove a file name from the directory.  Return TRUE if successful;
-//	return FALSE if the file isn't in the directory. 
+//	return FALSE if the file isn't in the directory.
+//
+//	The entries after the removed one slide down to fill the gap.
+//	The bucket's overflow mark is left alone, since entries that
+//	spilled into later buckets may still be there.
 //
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool
 Directory::Remove(char *name)
-{ 
-    int i = FindIndex(name);
+{
+    DirectoryBucket bucket;
+    DirectoryEntry *entry;
+    int which, offset, size;
 
-    if (i == -1)
+    offset = FindEntry(name, &which, &bucket);
+    if (offset == -1)
 	return FALSE; 		// name not in directory
-    table[i].inUse = FALSE;
-    return TRUE;	
+    entry = (DirectoryEntry *) &bucket.data[offset];
+    size = DirEntryLength(entry->nameLen);
+    memmove(&bucket.data[offset], &bucket.data[offset + size],
+		bucket.used - (offset + size));
+    bucket.used -= size;
+    WriteBucket(which, &bucket);
+    info.numEntries--;
+    WriteInfo();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return TRUE if there are no files in the directory.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    return info.numEntries == 0;
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory.  Directories are
+//	marked with a trailing "/".
 //----------------------------------------------------------------------
 
 void
 Directory::List()
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+    DirectoryBucket bucket;
+    DirectoryEntry *entry;
+
+    for (int i = 0; i < info.numBuckets; i++) {
+	ReadBucket(i, &bucket);
+	for (int offset = 0; offset < bucket.used;
+			offset += DirEntryLength(entry->nameLen)) {
+	    entry = (DirectoryEntry *) &bucket.data[offset];
+	    printf("%.*s%s\n", entry->nameLen, EntryName(entry),
+			entry->isDir ? "/" : "");
+	}
+    }
 }
 
 //----------------------------------------------------------------------
@@ -182,16 +422,120 @@ Directory::List()
 
 void
 Directory::Print()
-{ 
+{
     FileHeader *hdr = new FileHeader;
+    DirectoryBucket bucket;
+    DirectoryEntry *entry;
 
-    printf("Directory contents:\n");
-    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
+    printf("Directory contents: %d files, %d buckets\n", info.numEntries,
+		info.numBuckets);
+    for (int i = 0; i < info.numBuckets; i++) {
+	ReadBucket(i, &bucket);
+	for (int offset = 0; offset < bucket.used;
+			offset += DirEntryLength(entry->nameLen)) {
+	    entry = (DirectoryEntry *) &bucket.data[offset];
+	    printf("Name: %.*s%s, Sector: %d, Bucket: %d\n", entry->nameLen,
+			EntryName(entry), entry->isDir ? "/" : "",
+			entry->sector, i);
+	    hdr->FetchFrom(entry->sector);
 	    hdr->Print();
 	}
+    }
     printf("\n");
     delete hdr;
 }
+
+//----------------------------------------------------------------------
+// DirectoryCache::DirectoryCache
+// 	Initialize an empty cache of directory lookups.
+//----------------------------------------------------------------------
+
+DirectoryCache::DirectoryCache()
+{
+    for (int i = 0; i < DirCacheSize; i++)
+	table[i].valid = FALSE;
+    hits = misses = 0;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Slot
+// 	Return the one slot where <dirSector, name> can be cached.
+//----------------------------------------------------------------------
+
+int
+DirectoryCache::Slot(int dirSector, char *name)
+{
+    unsigned int hash = HashName(name, strlen(name));
+
+    return (hash ^ (dirSector * 2654435761u)) % DirCacheSize;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Lookup
+// 	Return the header sector of file "name" in the directory whose
+//	header is at "dirSector", or -1 if it isn't cached.
+//
+//	"isDir" -- if not NULL, set to whether the file is a directory
+//----------------------------------------------------------------------
+
+int
+DirectoryCache::Lookup(int dirSector, char *name, bool *isDir)
+{
+    DirectoryCacheEntry *entry = &table[Slot(dirSector, name)];
+
+    if (entry->valid && (entry->dirSector == dirSector) &&
+			!strcmp(entry->name, name)) {
+	hits++;
+	if (isDir != NULL)
+	    *isDir = entry->isDir;
+	return entry->sector;
+    }
+    misses++;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Insert
+// 	Remember where file "name" in directory "dirSector" lives,
+//	replacing whatever was cached in the same slot.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Insert(int dirSector, char *name, int sector, bool isDir)
+{
+    DirectoryCacheEntry *entry = &table[Slot(dirSector, name)];
+
+    if (strlen(name) > FileNameMaxLen)
+	return;
+    entry->valid = TRUE;
+    entry->dirSector = dirSector;
+    entry->sector = sector;
+    entry->isDir = isDir;
+    strcpy(entry->name, name);
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Invalidate
+// 	Forget file "name" in directory "dirSector", if it is cached.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Invalidate(int dirSector, char *name)
+{
+    DirectoryCacheEntry *entry = &table[Slot(dirSector, name)];
+
+    if (entry->valid && (entry->dirSector == dirSector) &&
+			!strcmp(entry->name, name))
+	entry->valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// DirectoryCache::Print
+// 	Print how well the cache is doing.  For debugging.
+//----------------------------------------------------------------------
+
+void
+DirectoryCache::Print()
+{
+    printf("Directory cache: %d hits, %d misses\n", hits, misses);
+}
@@ -1,15 +1,20 @@
-// directory.h 
+// directory.h
 //	Data structures to manage a UNIX-like directory of file names.
-// 
+//
 //      A directory is a table of pairs: <file name, sector #>,
-//	giving the name of each file in the directory, and 
+//	giving the name of each file in the directory, and
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry can
+//	name another directory, so directories form a tree.
+//
+//	The table is a hash table kept on disk, so that finding a name
+//	only costs reading one or two sectors, no matter how many files
+//	are in the directory.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -18,53 +23,93 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "disk.h"
+
+#define FileNameMaxLen 		63	// file names are variable length,
+					// up to this many characters
+#define PathNameMaxLen		255	// longest path, "/a/b/c"
+
+#define RootDirBuckets		8	// initial size of the root directory
+#define SubDirBuckets		2	// initial size of other directories
+#define MaxBucketLoad		4	// average entries per bucket before
+					// the directory doubles in size
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+// Length of a directory file holding "buckets" buckets: one sector of
+// DirectoryInfo, followed by one sector per bucket.
+#define DirectoryFileLength(buckets)	(((buckets) + 1) * SectorSize)
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
 // the file's header is to be found on disk.
 //
+// On disk, an entry is this fixed part followed by "nameLen" bytes of
+// name (not '\0' terminated), padded so the next entry is int aligned.
+//
 // Internal data structures kept public so that Directory operations can
 // access them directly.
 
 class DirectoryEntry {
   public:
-    bool inUse;				// Is this directory entry in use?
-    int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
-    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
-					// the trailing '\0'
+    int sector;				// Location on disk to find the
+					//   FileHeader for this file
+    char isDir;				// Is this file a directory?
+    unsigned char nameLen;		// Length of the name that follows
+};
+
+// Number of bytes an entry for a name "len" characters long takes up
+#define DirEntryLength(len) \
+	((int)divRoundUp(sizeof(DirectoryEntry) + (len), sizeof(int)) * \
+		(int)sizeof(int))
+
+// A bucket of the hash table takes exactly one disk sector.  Entries
+// are packed into "data", "used" bytes of it are in use.  If an entry
+// that hashed to this bucket didn't fit, it went into the next bucket
+// over, and "overflow" tells lookups to keep looking there.
+
+#define BucketDataSize		(SectorSize - 2 * (int)sizeof(short))
+
+class DirectoryBucket {
+  public:
+    short used;				// Bytes of "data" in use
+    short overflow;			// Did entries spill past this bucket?
+    char data[BucketDataSize];		// Packed DirectoryEntry's
+};
+
+// The first sector of a directory file describes the rest of it.
+
+class DirectoryInfo {
+  public:
+    int numBuckets;			// Buckets in the hash table
+    int numEntries;			// Files in the directory
 };
 
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
-// The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
-//
-// The constructor initializes a directory structure in memory; the
-// FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// The directory data structure is stored on disk, as a regular
+// Nachos file.  Unlike the rest of the file system, a Directory
+// object does not keep a copy of the whole table in memory; each
+// operation reads (and, if needed, writes back) only the buckets it
+// touches.  Initialize formats an empty directory into a new file.
 
 class Directory {
   public:
-    Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
+    Directory(OpenFile *dirFile);	// Use the directory stored in "dirFile"
     ~Directory();			// De-allocate the directory
 
-    void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
-					// directory contents back to disk
+    bool Initialize(int numBuckets);	// Make "file" an empty directory
 
-    int Find(char *name);		// Find the sector number of the 
-					// FileHeader for file: "name"
+    int Find(char *name, bool *isDir);	// Find the sector number of the
+					// FileHeader for file: "name", and
+					// whether it is a directory
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
+    bool IsEmpty();			// Are there no files in the directory?
+
     void List();			// Print the names of all the files
 					//  in the directory
     void Print();			// Verbose print of the contents
@@ -72,12 +117,59 @@ class Directory {
 					//  names and their contents.
 
   private:
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
+    OpenFile *file;			// File holding the directory
+    DirectoryInfo info;			// Copy of the directory's first sector
+
+    void ReadBucket(int which, DirectoryBucket *bucket);
+    void WriteBucket(int which, DirectoryBucket *bucket);
+    void WriteInfo();
+
+    int FindEntry(char *name, int *which, DirectoryBucket *bucket);
+					// Find the bucket holding "name",
+					// and where in it the entry is
+    bool Insert(char *name, int newSector, bool isDir);
+					// Put an entry in the first bucket
+					// with room for it
+    bool Grow();			// Double the number of buckets
+};
+
+// The following class caches recent directory lookups, so that
+// resolving a hot path doesn't have to read every directory along
+// the way off of disk.  It maps <directory sector, name> to the
+// file header sector of the named file.
+//
+// The cache is direct mapped; a new entry just replaces whatever
+// was in its slot.  The file system must Invalidate an entry when it
+// removes the file.
+
+#define DirCacheSize		64
+
+class DirectoryCacheEntry {
+  public:
+    bool valid;
+    int dirSector;			// Directory the name is in
+    int sector;				// The file's header
+    bool isDir;				// Is the file a directory?
+    char name[FileNameMaxLen + 1];
+};
+
+class DirectoryCache {
+  public:
+    DirectoryCache();
+
+    int Lookup(int dirSector, char *name, bool *isDir);
+					// Return the cached header sector,
+					// or -1 if "name" isn't cached
+    void Insert(int dirSector, char *name, int sector, bool isDir);
+    void Invalidate(int dirSector, char *name);
+
+    void Print();			// Print hit/miss counts
+
+  private:
+    DirectoryCacheEntry table[DirCacheSize];
+    int hits, misses;
 
-    int FindIndex(char *name);		// Find the index into the directory 
-					//  table corresponding to "name"
+    int Slot(int dirSector, char *name);
 };
 
 #endif // DIRECTORY_H
@@ -5,10 +5,14 @@
 //	The file header is used to locate where on disk the 
 //	file's data is stored.  We implement this as a fixed size
 //	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	disk sector containing that portion of the file data -- followed
+//	by a fixed size table of indirect blocks, each a sector full of 
+//	more pointers (there are no doubly indirect blocks).  The table 
+//	sizes are chosen so that the file header will be just big enough 
+//	to fit in one disk sector.
+//
+//	Files can grow: Extend adds sectors to the end of the file, in
+//	contiguous batches where the free map allows it.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,6 +31,138 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header, with no data blocks.  Call
+//	Allocate or FetchFrom before using it.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    numBytes = 0;
+    numSectors = 0;
+    for (int i = 0; i < NumIndirect; i++) {
+	indirectSectors[i] = -1;
+	indirect[i] = NULL;
+	indirectDirty[i] = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	De-allocate the in-memory copies of the indirect blocks.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader()
+{
+    FreeIndirect();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FreeIndirect
+// 	Throw away the in-memory copies of the indirect blocks.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FreeIndirect()
+{
+    for (int i = 0; i < NumIndirect; i++) {
+	delete [] indirect[i];
+	indirect[i] = NULL;
+	indirectDirty[i] = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SectorAt
+// 	Return the disk sector holding the i'th data block of the file.
+//
+//	"i" is the index of the data block, 0 <= i < numSectors
+//----------------------------------------------------------------------
+
+int
+FileHeader::SectorAt(int i)
+{
+    ASSERT(i >= 0 && i < numSectors);
+    if (i < NumDirect)
+	return dataSectors[i];
+    i -= NumDirect;
+    return indirect[i / NumPerIndirect][i % NumPerIndirect];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::AddSector
+// 	Append the data block "sector" to the end of the file, allocating
+//	an indirect block out of "freeMap" if we need a new one.
+//	Return FALSE if the file can't get any bigger, or if there is no
+//	space for the indirect block.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"sector" is the (already allocated) data block to add
+//----------------------------------------------------------------------
+
+bool
+FileHeader::AddSector(BitMap *freeMap, int sector)
+{
+    int i = numSectors;
+
+    if (i >= MaxFileSectors)
+	return FALSE;			// file can't get any bigger
+    if (i < NumDirect) {
+	dataSectors[i] = sector;
+	numSectors++;
+	return TRUE;
+    }
+
+    i -= NumDirect;
+    int which = i / NumPerIndirect;
+    if (indirect[which] == NULL) {	// first block in this indirect block
+	int indSector = freeMap->FindNear(sector + 1);
+	if (indSector == -1)
+	    return FALSE;		// no space for the indirect block
+	indirectSectors[which] = indSector;
+	indirect[which] = new int[NumPerIndirect];
+	for (int j = 0; j < NumPerIndirect; j++)
+	    indirect[which][j] = -1;
+    }
+    indirect[which][i % NumPerIndirect] = sector;
+    indirectDirty[which] = TRUE;
+    numSectors++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::TrimSectors
+// 	Undo AddSector back to the first "keep" data blocks, returning
+//	the blocks past them to "freeMap", along with any indirect block
+//	that only they were using.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"keep" is how many data blocks the file should be left with
+//----------------------------------------------------------------------
+
+void
+FileHeader::TrimSectors(BitMap *freeMap, int keep)
+{
+    for (int i = numSectors - 1; i >= keep; i--) {
+	freeMap->Clear(SectorAt(i));
+	if (i < NumDirect)
+	    continue;
+
+	int j = i - NumDirect;
+	int which = j / NumPerIndirect;
+	indirect[which][j % NumPerIndirect] = -1;
+	if ((j % NumPerIndirect) == 0) {	// AddSector allocated the
+	    freeMap->Clear(indirectSectors[which]);	// indirect block
+	    indirectSectors[which] = -1;		// for this one
+	    delete [] indirect[which];
+	    indirect[which] = NULL;
+	    indirectDirty[which] = FALSE;
+	}
+    }
+    numSectors = keep;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -41,19 +177,101 @@
 bool
 FileHeader::Allocate(BitMap *freeMap, int fileSize)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
-	return FALSE;		// not enough space
+    FreeIndirect();
+    numBytes = 0;
+    numSectors = 0;
+    for (int i = 0; i < NumIndirect; i++)
+	indirectSectors[i] = -1;
+
+    if (fileSize == 0)
+	return TRUE;			// grows on the first write
+    return Extend(freeMap, fileSize, 0);
+}
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file to be "newSize" bytes long.  If the file already has
+//	enough sectors (from an earlier preallocation), this just changes 
+//	the length.  Otherwise we allocate the missing sectors -- or 
+//	"hint" sectors, if that is more -- as one contiguous run right 
+//	after the current last sector if we can, falling back to the 
+//	nearest free sectors one at a time if the disk is fragmented.
+//	The new sectors are zeroed, so neither the preallocated tail nor
+//	a hole left by writing past the end of the file can show what
+//	an earlier file left on the disk.
+//
+//	Return FALSE, and leave the header and "freeMap" as they were, if 
+//	there isn't enough space.  The caller is responsible for writing 
+//	the header and "freeMap" back to disk.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the new length of the file, in bytes
+//	"hint" is how many sectors the caller would like preallocated
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(BitMap *freeMap, int newSize, int hint)
+{
+    int needed, count, start, near, oldSectors, i;
+    char zeroes[SectorSize];
+
+    if (newSize <= numBytes)
+	return TRUE;
+    if (newSize > MaxFileSize)
+	return FALSE;			// file would be too big
+
+    needed = divRoundUp(newSize, SectorSize) - numSectors;
+    if (needed <= 0) {			// fits in the preallocated tail
+	numBytes = newSize;
+	return TRUE;
+    }
+
+    // Don't grow past what the disk (or the header) can hold; the 
+    // preallocated part of the batch is just a hint, so we can 
+    // shrink it, but we must get at least the sectors we need.
+    // Leave room for the indirect blocks we may have to allocate.
+    count = max(needed, min(hint, MaxGrowthSectors));
+    count = min(count, MaxFileSectors - numSectors);
+    count = min(count, freeMap->NumClear() - 
+			divRoundUp(count, NumPerIndirect) - 1);
+    if (count < needed)
+	return FALSE;			// not enough space
+
+    oldSectors = numSectors;
+    near = (numSectors > 0) ? SectorAt(numSectors - 1) + 1 : 0;
+    start = freeMap->FindRun(count, near);
+    for (i = 0; i < count; i++) {
+	int sector;
+
+	if (start != -1)
+	    sector = start + i;		// contiguous run
+	else if ((sector = freeMap->FindNear(near)) == -1)
+	    break;			// can't happen, we checked NumClear
+	near = sector + 1;
+	if (!AddSector(freeMap, sector)) {
+	    freeMap->Clear(sector);	// shouldn't happen, see above
+	    break;
+	}
+    }
+    if (i < count) {			// give back what we took
+	if (start != -1)
+	    for (int j = i + 1; j < count; j++)
+		freeMap->Clear(start + j);
+	TrimSectors(freeMap, oldSectors);
+	return FALSE;
+    }
+
+    memset(zeroes, 0, SectorSize);
+    for (i = oldSectors; i < numSectors; i++)
+	journal->WriteSector(SectorAt(i), zeroes);
+    numBytes = newSize;
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	including the indirect blocks and any preallocated sectors.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -62,14 +280,22 @@ void
 FileHeader::Deallocate(BitMap *freeMap)
 {
     for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+	int sector = SectorAt(i);
+
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
     }
+    for (int i = 0; i < NumIndirect; i++)
+	if (indirectSectors[i] != -1) {
+	    ASSERT(freeMap->Test(indirectSectors[i]));
+	    freeMap->Clear(indirectSectors[i]);
+	}
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk, along with any indirect
+//	blocks.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -77,12 +303,19 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    FreeIndirect();
+    journal->ReadSector(sector, (char *)this);
+    for (int i = 0; i < NumIndirect; i++)
+	if (indirectSectors[i] != -1) {
+	    indirect[i] = new int[NumPerIndirect];
+	    journal->ReadSector(indirectSectors[i], (char *)indirect[i]);
+	}
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with any indirect blocks that have changed. 
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -90,7 +323,12 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    synchDisk->WriteSector(sector, (char *)this); 
+    for (int i = 0; i < NumIndirect; i++)
+	if (indirectDirty[i]) {
+	    journal->WriteSector(indirectSectors[i], (char *)indirect[i]);
+	    indirectDirty[i] = FALSE;
+	}
+    journal->WriteSector(sector, (char *)this); 
 }
 
 //----------------------------------------------------------------------
@@ -106,7 +344,7 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    return SectorAt(offset / SectorSize);
 }
 
 //----------------------------------------------------------------------
@@ -120,6 +358,18 @@ FileHeader::FileLength()
     return numBytes;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::AllocatedLength
+// 	Return the number of bytes the file can hold before Extend has
+//	to allocate more sectors.
+//----------------------------------------------------------------------
+
+int
+FileHeader::AllocatedLength()
+{
+    return numSectors * SectorSize;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Print
 // 	Print the contents of the file header, and the contents of all
@@ -134,10 +384,10 @@ FileHeader::Print()
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+	printf("%d ", SectorAt(i));
     printf("\nFile contents:\n");
-    for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
+    for (i = k = 0; i < numSectors && k < numBytes; i++) {
+	journal->ReadSector(SectorAt(i), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -17,29 +17,60 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumDirect 	16		// data sectors named in the header
+#define NumIndirect 	((int) ((SectorSize - (2 + NumDirect) * sizeof(int)) \
+				/ sizeof(int)))
+					// indirect sectors named in the header
+#define NumPerIndirect 	((int) (SectorSize / sizeof(int)))
+					// data sectors named in each
+					// indirect sector
+#define MaxFileSectors 	(NumDirect + NumIndirect * NumPerIndirect)
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
+
+// When a file grows past the sectors it already has, we don't allocate
+// just the sectors the write needs -- we grab a batch of contiguous
+// sectors, so a file that is written by appending doesn't end up 
+// scattered over the disk and doesn't need a header rewrite for 
+// every sector.  The caller passes in a preallocation hint (how many
+// sectors to grab at once); OpenFile starts each file at
+// MinGrowthSectors and doubles the hint every time the file has to
+// grow, up to MaxGrowthSectors.
+#define MinGrowthSectors	4
+#define MaxGrowthSectors	32
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of pointers to data blocks,
+// followed by a table of pointers to indirect blocks, each of which
+// is a sector full of pointers to more data blocks.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that we assume the size of the on-disk part of this data structure
+// to be the same as one disk sector.  The indirect blocks are read
+// into memory along with the header, so that ByteToSector never needs
+// to go to disk.
+//
+// A file may have more sectors allocated than it needs to hold its
+// data ("numSectors" covers more than "numBytes"); the extra sectors
+// are the preallocated tail that later appends write into.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The file header can be initialized by allocating blocks for the file 
+// (if it is a new file), or by reading it from disk.
 
 class FileHeader {
   public:
+    FileHeader();			// Initialize an empty file header
+    ~FileHeader();			// De-allocate in-memory indirect 
+					//  blocks
+
     bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
+    bool Extend(BitMap *bitMap, int newSize, int hint);
+					// Grow the file to "newSize" bytes,
+					//  allocating at least "hint" new
+					//  sectors if any are needed
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
 
@@ -53,14 +84,34 @@ class FileHeader {
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    int AllocatedLength();		// Return the number of bytes the
+					// file can hold without growing
 
     void Print();			// Print the contents of the file.
 
   private:
+    // NOTE: the following fields are the on-disk file header, and must 
+    // come first and fill exactly one sector.
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int dataSectors[NumDirect];		// Disk sector numbers for the first
+					// data blocks in the file
+    int indirectSectors[NumIndirect];	// Disk sector numbers of the 
+					// indirect blocks, -1 if unused
+
+    // In-memory only.
+    int *indirect[NumIndirect];		// Contents of each indirect block,
+					// NULL if not allocated
+    bool indirectDirty[NumIndirect];	// Indirect block changed since 
+					// it was read from disk?
+
+    int SectorAt(int i);		// Sector number of i'th data block
+    bool AddSector(BitMap *freeMap, int sector);
+					// Append a data block to the file
+    void TrimSectors(BitMap *freeMap, int keep);
+					// Give back the data blocks past
+					// the first "keep"
+    void FreeIndirect();		// Free in-memory indirect blocks
 };
 
 #endif // FILEHDR_H
@@ -7,19 +7,25 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in a file system directory
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them 
-//	on bootup.
+//      Both the bitmap and the directories are represented as normal
+//	files.  The file headers of the bitmap and the root directory are
+//	located in specific sectors (sector 0 and sector 1), so that the 
+//	file system can find them on bootup.  Other directories are found
+//	by looking them up in their parent directory.
 //
-//	The file system assumes that the bitmap and directory files are
-//	kept "open" continuously while Nachos is running.
+//	File names are paths, "/dir/subdir/file", starting at the root 
+//	directory (the leading "/" is optional).  Since walking a path 
+//	reads a directory for every component, recent lookups are kept in
+//	a DirectoryCache.
+//
+//	The file system assumes that the bitmap and root directory files
+//	are kept "open" continuously while Nachos is running.
 //
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
@@ -28,16 +34,18 @@
 //	modified part of the directory and/or bitmap, we simply discard
 //	the changed version, without writing it back to disk.
 //
+//	Each such operation is bracketed by Journal::Begin and End, so
+//	that its changes reach the disk all together, through the
+//	write-ahead journal (cf. journal.h), or not at all.  The journal
+//	is replayed when the file system is initialized.
+//
 // 	Our implementation at this point has the following restrictions:
 //
 //	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   files cannot be bigger than MaxFileSize (about 58KB)
+//	   there is no current directory; all paths start at the root
+//	   only metadata is journaled; if Nachos exits in the middle of
+//	    a write, the file may hold a mix of old and new data
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -45,11 +53,13 @@
 
 #include "copyright.h"
 
+#include "system.h"
 #include "disk.h"
 #include "bitmap.h"
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "journal.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -57,12 +67,9 @@
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and root directory.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+#define DirectoryFileSize 	DirectoryFileLength(RootDirBuckets)
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -71,8 +78,8 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).  
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we just have to replay the journal, and open
+//	the files representing the bitmap and the directory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
@@ -80,9 +87,10 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    journal = new Journal(format);
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        Directory *directory;
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
 
@@ -92,6 +100,8 @@ FileSystem::FileSystem(bool format)
     // (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	for (int i = JournalSector; i < NumSectors; i++)
+	    freeMap->Mark(i);		// and for the journal
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
@@ -123,7 +133,8 @@ FileSystem::FileSystem(bool format)
 
         DEBUG('f', "Writing bitmap and directory back to disk.\n");
 	freeMap->WriteBack(freeMapFile);	 // flush changes to disk
-	directory->WriteBack(directoryFile);
+	directory = new Directory(directoryFile);
+	directory->Initialize(RootDirBuckets);
 
 	if (DebugIsEnabled('f')) {
 	    freeMap->Print();
@@ -140,77 +151,263 @@ FileSystem::FileSystem(bool format)
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
     }
+    dirCache = new DirectoryCache;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the bitmap and directory files, and de-allocate the
+//	journal.  The journal is checkpointed by Interrupt::Halt, not
+//	here, since this also runs when Nachos is aborted.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    delete dirCache;
+    delete freeMapFile;
+    delete directoryFile;
+    delete journal;
+    journal = NULL;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory, CloseDirectory
+// 	Open (close) the directory whose file header is at "sector".
+//	The root directory is always open, so we just hand back the
+//	file we already have.
+//----------------------------------------------------------------------
+
+OpenFile *
+FileSystem::OpenDirectory(int sector)
+{
+    if (sector == DirectorySector)
+	return directoryFile;
+    return new OpenFile(sector);
+}
+
+void
+FileSystem::CloseDirectory(OpenFile *file)
+{
+    if (file != directoryFile)
+	delete file;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LookupEntry
+// 	Look up "name" in the directory whose file header is at 
+//	"dirSector".  Return the sector of the file's header, or -1 if
+//	there is no such file.  The directory cache is checked first;
+//	on a miss, we read the directory and remember the answer.
+//
+//	"isDir" -- if not NULL, set to whether the file is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupEntry(int dirSector, char *name, bool *isDir)
+{
+    OpenFile *dirFile;
+    Directory *directory;
+    bool entryIsDir;
+    int sector;
+
+    sector = dirCache->Lookup(dirSector, name, isDir);
+    if (sector != -1)
+	return sector;
+
+    dirFile = OpenDirectory(dirSector);
+    directory = new Directory(dirFile);
+    sector = directory->Find(name, &entryIsDir);
+    if (sector != -1) {
+	dirCache->Insert(dirSector, name, sector, entryIsDir);
+	if (isDir != NULL)
+	    *isDir = entryIsDir;
+    }
+    delete directory;
+    CloseDirectory(dirFile);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Resolve
+// 	Walk "path" down from the root directory.  Return the header 
+//	sector of the directory that holds the last component of the 
+//	path, and copy that component into "name" (which is left empty 
+//	if the path names the root directory itself).
+//
+//	Return -1 if the path is too long, a component is too long, or
+//	some directory along the way doesn't exist.
+//
+//	"path" -- the path to resolve, e.g. "/passport/customer12"
+//	"name" -- space for FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int
+FileSystem::Resolve(char *path, char *name)
+{
+    int dirSector = DirectorySector;
+    bool isDir;
+    char *next;
+    int len;
+
+    name[0] = '\0';
+    if (strlen(path) > PathNameMaxLen)
+	return -1;
+    for (;;) {
+	while (*path == '/')
+	    path++;
+	next = strchr(path, '/');
+	len = (next == NULL) ? strlen(path) : (next - path);
+	if (len > FileNameMaxLen)
+	    return -1;
+	strncpy(name, path, len);
+	name[len] = '\0';
+
+	if (next != NULL)
+	    while (*next == '/')
+		next++;
+	if ((next == NULL) || (*next == '\0'))
+	    return dirSector;			// "name" is the last component
+
+	dirSector = LookupEntry(dirSector, name, &isDir);
+	if ((dirSector == -1) || !isDir)
+	    return -1;				// no such directory
+	path = next;
+    }
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+//	Files grow when they are written past the end, so "initialSize"
+//	only preallocates space; it can be 0.
+//
+//	"name" -- path of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize)
+{
+    bool success;
+
+    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    journal->Begin();
+    success = CreateEntry(name, initialSize, FALSE);
+    journal->End();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeDirectory
+// 	Create an empty directory (similar to UNIX mkdir).
 //
-//	The steps to create a file are:
+//	"name" -- path of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::MakeDirectory(char *name)
+{
+    bool success;
+
+    DEBUG('f', "Creating directory %s\n", name);
+    journal->Begin();
+    success = CreateEntry(name, DirectoryFileLength(SubDirBuckets), TRUE);
+    journal->End();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Create a file or directory.  The steps are:
+//	  Find the directory the new file goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
+//	  Flush the file header and the bitmap to disk
+//	  If it is a directory, write an empty directory into it
 //	  Add the name to the directory
-//	  Store the new file header on disk 
-//	  Flush the changes to the bitmap and the directory back to disk
+//
+//	The bitmap is flushed before the name is added, since adding a
+//	name can make the directory grow, which allocates more sectors.
+//	If the name can't be added, we give the sectors back.
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		the directory to put the file in doesn't exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
+//	 	no room to grow the directory
 //
 // 	Note that this implementation assumes there is no concurrent access
 //	to the file system!
-//
-//	"name" -- name of file to be created
-//	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Create(char *name, int initialSize)
+FileSystem::CreateEntry(char *path, int initialSize, bool isDir)
 {
-    Directory *directory;
+    char name[FileNameMaxLen + 1];
+    OpenFile *dirFile, *newFile;
+    Directory *directory, *newDirectory;
     BitMap *freeMap;
     FileHeader *hdr;
-    int sector;
+    int dirSector, sector;
     bool success;
 
-    DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    dirSector = Resolve(path, name);
+    if ((dirSector == -1) || (name[0] == '\0'))
+	return FALSE;			// no such directory
+    if (LookupEntry(dirSector, name, NULL) != -1)
+	return FALSE;			// file is already in directory
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
-      success = FALSE;			// file is already in directory
-    else {	
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->Find();	// find a sector to hold the file header
-    	if (sector == -1) 		
-            success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = FALSE;	// no space in directory
-	else {
-    	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
-            	success = FALSE;	// no space on disk for data
-	    else {	
-	    	success = TRUE;
-		// everthing worked, flush all changes back to disk
-    	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
-    	    	freeMap->WriteBack(freeMapFile);
-	    }
-            delete hdr;
-	}
-        delete freeMap;
+    freeMap = new BitMap(NumSectors);
+    freeMap->FetchFrom(freeMapFile);
+    sector = freeMap->Find();	// find a sector to hold the file header
+    if (sector == -1) {
+	delete freeMap;
+	return FALSE;			// no free block for file header 
+    }
+    hdr = new FileHeader;
+    if (!hdr->Allocate(freeMap, initialSize)) {
+	delete hdr;
+	delete freeMap;
+	return FALSE;			// no space on disk for data
+    }
+    hdr->WriteBack(sector);
+    freeMap->WriteBack(freeMapFile);
+    delete hdr;
+    delete freeMap;
+
+    success = TRUE;
+    if (isDir) {
+	newFile = new OpenFile(sector);
+	newDirectory = new Directory(newFile);
+	success = newDirectory->Initialize(SubDirBuckets);
+	delete newDirectory;
+	delete newFile;
+    }
+    if (success) {
+	dirFile = OpenDirectory(dirSector);
+	directory = new Directory(dirFile);
+	success = directory->Add(name, sector, isDir);
+	delete directory;
+	CloseDirectory(dirFile);
+    }
+
+    if (success)
+	dirCache->Insert(dirSector, name, sector, isDir);
+    else {			// undo the allocation
+	hdr = new FileHeader;
+	hdr->FetchFrom(sector);
+	freeMap = new BitMap(NumSectors);
+	freeMap->FetchFrom(freeMapFile);
+	hdr->Deallocate(freeMap);
+	freeMap->Clear(sector);
+	freeMap->WriteBack(freeMapFile);
+	delete hdr;
+	delete freeMap;
     }
-    delete directory;
     return success;
 }
 
@@ -218,86 +415,185 @@ FileSystem::Create(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
+//	  along its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	Directories can't be opened this way.
+//
+//	"name" -- the path of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
+    char fileName[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
-    int sector;
+    int dirSector, sector;
+    bool isDir;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
-    if (sector >= 0) 		
+    dirSector = Resolve(name, fileName);
+    if ((dirSector == -1) || (fileName[0] == '\0'))
+	return NULL;
+    sector = LookupEntry(dirSector, fileName, &isDir);
+    if ((sector >= 0) && !isDir) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
     return openFile;				// return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory (and the directory cache)
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system.  A directory can only be removed once it 
+//	is empty.
+//
+//	If the file is still open, only its directory entry goes away
+//	now; its space is given back when the last open of it is closed
+//	(see OpenFile::~OpenFile), so that no one writes to sectors that
+//	may already belong to another file.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
+{
+    bool success;
+
+    journal->Begin();
+    success = RemoveEntry(name);
+    journal->End();
+    return success;
+}
+
+bool
+FileSystem::RemoveEntry(char *name)
 { 
+    char fileName[FileNameMaxLen + 1];
+    OpenFile *dirFile;
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *fileHdr;
-    int sector;
+    int dirSector, sector;
+    bool isDir, empty;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-       delete directory;
-       return FALSE;			 // file not found 
+    dirSector = Resolve(name, fileName);
+    if ((dirSector == -1) || (fileName[0] == '\0'))
+	return FALSE;
+    sector = LookupEntry(dirSector, fileName, &isDir);
+    if (sector == -1)
+	return FALSE;			 // file not found 
+    if (isDir) {
+	dirFile = new OpenFile(sector);
+	directory = new Directory(dirFile);
+	empty = directory->IsEmpty();
+	delete directory;
+	delete dirFile;
+	if (!empty)
+	    return FALSE;		// directory still has files in it
     }
+
+    dirFile = OpenDirectory(dirSector);
+    directory = new Directory(dirFile);
+    directory->Remove(fileName);		// flushed to disk
+    dirCache->Invalidate(dirSector, fileName);
+    delete directory;
+    CloseDirectory(dirFile);
+
+    if (OpenFile::MarkRemoved(sector))
+	return TRUE;			// freed on the last close
+
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
+    FreeFile(fileHdr, sector);
+    delete fileHdr;
+    return TRUE;
+} 
 
+//----------------------------------------------------------------------
+// FileSystem::FreeFile
+// 	Give back the data blocks and the header sector of a file that
+//	has been removed from its directory, and flush the bitmap.
+//
+//	"hdr" -- the file's header
+//	"hdrSector" -- where "hdr" lives on disk
+//----------------------------------------------------------------------
+
+void
+FileSystem::FreeFile(FileHeader *hdr, int hdrSector)
+{
+    BitMap *freeMap;
+
+    journal->Begin();
     freeMap = new BitMap(NumSectors);
     freeMap->FetchFrom(freeMapFile);
 
-    fileHdr->Deallocate(freeMap);  		// remove data blocks
-    freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    hdr->Deallocate(freeMap);  			// remove data blocks
+    freeMap->Clear(hdrSector);			// remove header block
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
-    delete fileHdr;
-    delete directory;
     delete freeMap;
-    return TRUE;
-} 
+    journal->End();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ExtendFile
+// 	Grow an open file so that it is "newSize" bytes long.  Called by
+//	OpenFile::WriteAt when a write runs past the end of the file.
+//
+//	If the file header already has enough sectors preallocated, only
+//	the in-memory header changes (the caller writes it back later).  
+//	Otherwise we allocate a batch of at least "hint" sectors, and flush 
+//	the bitmap and the file header back to disk, so that the two 
+//	always agree about which sectors the file owns.
+//
+//	Return FALSE if there is no space on disk to grow the file.
+//
+//	"hdr" -- the in-memory header of the open file
+//	"hdrSector" -- where "hdr" lives on disk
+//	"newSize" -- the length the file needs to be
+//	"hint" -- how many sectors to preallocate, if any are needed
+//----------------------------------------------------------------------
+
+bool
+FileSystem::ExtendFile(FileHeader *hdr, int hdrSector, int newSize, int hint)
+{
+    BitMap *freeMap;
+    bool success;
+
+    if (newSize <= hdr->AllocatedLength())
+	return hdr->Extend(NULL, newSize, hint);	// no allocation needed
+
+    DEBUG('f', "Extending file at sector %d to %d bytes\n", hdrSector, newSize);
+    journal->Begin();
+    freeMap = new BitMap(NumSectors);
+    freeMap->FetchFrom(freeMapFile);
+    success = hdr->Extend(freeMap, newSize, hint);
+    if (success) {
+	hdr->WriteBack(hdrSector);
+	freeMap->WriteBack(freeMapFile);
+    }
+    delete freeMap;
+    journal->End();
+    return success;
+}
 
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the root directory.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
+    Directory *directory = new Directory(directoryFile);
 
-    directory->FetchFrom(directoryFile);
     directory->List();
     delete directory;
 }
@@ -318,7 +614,7 @@ FileSystem::Print()
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
     BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+    Directory *directory = new Directory(directoryFile);
 
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
@@ -331,8 +627,9 @@ FileSystem::Print()
     freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
     directory->Print();
+    dirCache->Print();
+    journal->Print();
 
     delete bitHdr;
     delete dirHdr;
@@ -65,6 +65,9 @@ class FileSystem {
 };
 
 #else // FILESYS
+class FileHeader;
+class DirectoryCache;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -73,15 +76,27 @@ class FileSystem {
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+    ~FileSystem();			// Close the file system
 
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
 
+    bool MakeDirectory(char *name);	// Create a directory (UNIX mkdir)
+
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
     bool Remove(char *name);  		// Delete a file (UNIX unlink)
 
-    void List();			// List all the files in the file system
+    bool ExtendFile(FileHeader *hdr, int hdrSector, int newSize, int hint);
+					// Grow an open file to "newSize"
+					// bytes, preallocating "hint" 
+					// sectors if it needs more space
+    void FreeFile(FileHeader *hdr, int hdrSector);
+					// Give back the disk space of a
+					// removed file
+
+    void List();			// List all the files in the root
+					// directory
 
     void Print();			// List all the files and their contents
 
@@ -90,6 +105,18 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   DirectoryCache *dirCache;		// Recently looked up directory entries
+
+   int Resolve(char *path, char *name); // Find the directory holding the
+					// last component of "path"
+   int LookupEntry(int dirSector, char *name, bool *isDir);
+					// Find "name" in a directory, going
+					// through the cache
+   bool CreateEntry(char *path, int initialSize, bool isDir);
+					// Create a file or directory
+   bool RemoveEntry(char *path);	// Remove a file or directory
+   OpenFile *OpenDirectory(int sector); // Open a directory file
+   void CloseDirectory(OpenFile *file);
 };
 
 #endif // FILESYS
@@ -6,7 +6,10 @@
 //	   Print -- cat the contents of a Nachos file 
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
-//		(won't work on baseline system!)
+//		(the file starts out empty, and grows as it is written)
+//	   Growthtest -- grow one file through two opens of it at once,
+//		past the 3840 bytes files were limited to without
+//		indirect blocks
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -100,7 +103,7 @@ Print(char *name)
 // PerformanceTest
 // 	Stress the Nachos file system by creating a large file, writing
 //	it out a bit at a time, reading it back a bit at a time, and then
-//	deleting the file.
+//	deleting the file.  Then run GrowthTest and RemoveTest.
 //
 //	Implemented as three separate routines:
 //	  FileWrite -- write the file
@@ -169,6 +172,9 @@ FileRead()
     delete openFile;	// close file
 }
 
+static void GrowthTest();
+static void RemoveTest();
+
 void
 PerformanceTest()
 {
@@ -181,5 +187,149 @@ PerformanceTest()
       return;
     }
     stats->Print();
+    GrowthTest();
+    RemoveTest();
 }
 
+//----------------------------------------------------------------------
+// GrowthTest
+// 	Open an empty file twice, and grow it by writing chunks through
+//	the two opens in turn -- the even chunks through one, the odd
+//	ones through the other -- until it is well past 3840 bytes, the
+//	most a file could hold with only direct blocks.  Then close both,
+//	and check that the file has every chunk, where it was written.
+//	If each open kept its own header, the last one closed would
+//	overwrite the other's, and lose the chunks it added.
+//----------------------------------------------------------------------
+
+#define GrowthFileName	"GrowFile"
+#define GrowthChunk	100
+#define GrowthSize	(GrowthChunk * 80)
+
+static void
+GrowthTest()
+{
+    OpenFile *even, *odd, *openFile;
+    char *buffer = new char[GrowthChunk];
+    int i, j, errors = 0;
+
+    printf("Growth of a %d byte file through two opens, in %d byte chunks\n",
+	GrowthSize, GrowthChunk);
+    if (!fileSystem->Create(GrowthFileName, 0)) {
+	printf("Growth test: can't create %s\n", GrowthFileName);
+	delete [] buffer;
+	return;
+    }
+    even = fileSystem->Open(GrowthFileName);
+    odd = fileSystem->Open(GrowthFileName);
+    ASSERT((even != NULL) && (odd != NULL));
+    for (i = 0; i < GrowthSize / GrowthChunk; i++) {
+	for (j = 0; j < GrowthChunk; j++)
+	    buffer[j] = 'a' + (i % 26);
+	if ((((i % 2) == 0) ? even : odd)->WriteAt(buffer, GrowthChunk,
+				i * GrowthChunk) != GrowthChunk) {
+	    printf("Growth test: unable to write %s\n", GrowthFileName);
+	    errors++;
+	    break;
+	}
+    }
+    delete even;
+    delete odd;
+
+    openFile = fileSystem->Open(GrowthFileName);
+    ASSERT(openFile != NULL);
+    if (openFile->Length() != GrowthSize) {
+	printf("Growth test: %s is %d bytes, not %d\n", GrowthFileName,
+		openFile->Length(), GrowthSize);
+	errors++;
+    }
+    for (i = 0; i < GrowthSize / GrowthChunk; i++) {
+	if (openFile->Read(buffer, GrowthChunk) != GrowthChunk)
+	    break;
+	for (j = 0; j < GrowthChunk; j++)
+	    if (buffer[j] != 'a' + (i % 26)) {
+		errors++;
+		break;
+	    }
+    }
+    delete openFile;
+    delete [] buffer;
+    if (!fileSystem->Remove(GrowthFileName))
+	printf("Growth test: unable to remove %s\n", GrowthFileName);
+    printf("Growth test: %d errors\n", errors);
+}
+
+//----------------------------------------------------------------------
+// RemoveTest
+// 	Remove a file while it is still open and has just grown, then
+//	create and write another file before closing the first.  The
+//	second file must come through intact: the first one's sectors,
+//	and its header sector, must not be given back (or written to)
+//	until its last close.
+//----------------------------------------------------------------------
+
+#define RemovedFileName	"RemovedFile"
+#define SurvivorName	"Survivor"
+#define RemoveSize	(GrowthChunk * 20)
+
+static void
+RemoveTest()
+{
+    OpenFile *removed, *survivor;
+    char *buffer = new char[GrowthChunk];
+    int i, j, errors = 0;
+
+    printf("Removing an open %d byte file\n", RemoveSize);
+    if (!fileSystem->Create(RemovedFileName, 0) || 
+		!fileSystem->Create(SurvivorName, 0)) {
+	printf("Remove test: can't create %s, %s\n", RemovedFileName,
+		SurvivorName);
+	delete [] buffer;
+	return;
+    }
+    removed = fileSystem->Open(RemovedFileName);
+    ASSERT(removed != NULL);
+    memset(buffer, 'r', GrowthChunk);
+    for (i = 0; i < RemoveSize / GrowthChunk; i++)
+	removed->Write(buffer, GrowthChunk);
+    if (!fileSystem->Remove(RemovedFileName)) {
+	printf("Remove test: unable to remove %s\n", RemovedFileName);
+	errors++;
+    }
+    if ((survivor = fileSystem->Open(RemovedFileName)) != NULL) {
+	printf("Remove test: %s is still there\n", RemovedFileName);
+	delete survivor;
+	errors++;
+    }
+    removed->Write(buffer, GrowthChunk);	// mustn't grow it now
+
+    survivor = fileSystem->Open(SurvivorName);
+    ASSERT(survivor != NULL);
+    memset(buffer, 's', GrowthChunk);
+    for (i = 0; i < RemoveSize / GrowthChunk; i++)
+	survivor->Write(buffer, GrowthChunk);
+    delete survivor;
+    delete removed;			// gives back its sectors
+
+    survivor = fileSystem->Open(SurvivorName);
+    ASSERT(survivor != NULL);
+    if (survivor->Length() != RemoveSize) {
+	printf("Remove test: %s is %d bytes, not %d\n", SurvivorName,
+		survivor->Length(), RemoveSize);
+	errors++;
+    }
+    for (i = 0; i < RemoveSize / GrowthChunk; i++) {
+	if (survivor->Read(buffer, GrowthChunk) != GrowthChunk)
+	    break;
+	for (j = 0; j < GrowthChunk; j++)
+	    if (buffer[j] != 's') {
+		errors++;
+		break;
+	    }
+    }
+    delete survivor;
+    delete [] buffer;
+    if (!fileSystem->Remove(SurvivorName))
+	printf("Remove test: unable to remove %s\n", SurvivorName);
+    printf("Remove test: %d errors\n", errors);
+}
@@ -0,0 +1,464 @@
+// journal.cc
+//	Routines to keep a write-ahead journal of file system metadata,
+//	so that a crash in the middle of an operation like Create or
+//	Remove can't leave the bitmap, directories and file headers
+//	disagreeing with each other.
+//
+//	While an operation is in progress (between Begin and End), every
+//	sector it writes is kept in the "pending" table.  Operations that
+//	start while another one is running wait their turn, and their
+//	writes join the same group; the last one to finish writes the
+//	whole group to the log at once.  A sector written by several
+//	operations in the group (like the bitmap) is logged only once.
+//
+//	After a group is committed, its sectors move to the "committed"
+//	table.  They are written to their home locations only when the
+//	log runs out of space, or when Nachos shuts down.  Until then,
+//	reads are served from the tables, so the rest of the file system
+//	doesn't have to know the journal exists.
+//
+//	A write to a sector the journal holds, from outside an operation
+//	(for instance, a data block that used to be a directory block),
+//	is logged too; otherwise replaying the journal after a crash
+//	could overwrite it with the older contents.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "journal.h"
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize the journal.  If the disk is being formatted, start
+//	with an empty log; otherwise, replay any groups that were
+//	committed, but not checkpointed, before Nachos last stopped.
+//
+//	"format" -- is the disk being formatted?
+//----------------------------------------------------------------------
+
+Journal::Journal(bool format)
+{
+    lock = new Lock("journal lock");
+    opDone = new Condition("journal op done");
+    groupDone = new Condition("journal group done");
+
+    owner = NULL;
+    depth = 0;
+    waiting = 0;
+    committing = FALSE;
+    numPending = numCommitted = 0;
+    seq = 1;
+    logPos = 0;
+    numOps = numGroups = numLogWrites = numCheckpoints = 0;
+
+    if (format) {
+	ClearLog();
+	WriteHeader();
+    } else
+	Replay();
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the journal.  This may be on the way out after a
+//	ctl-C, so there is no disk I/O here; anything committed but not
+//	written home by Shutdown stays in the log, and is replayed on the
+//	next boot.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    delete lock;
+    delete opDone;
+    delete groupDone;
+}
+
+//----------------------------------------------------------------------
+// Journal::Shutdown
+// 	Commit the open group, if any, and write every committed sector
+//	to its home location, so the next boot has nothing to replay.
+//	Called when Nachos halts normally.
+//----------------------------------------------------------------------
+
+void
+Journal::Shutdown()
+{
+    lock->Acquire();
+    CommitGroup();
+    lock->Release();
+    if (logPos > 0) {
+	Checkpoint();
+	numCommitted = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::Find
+// 	Return the entry for "sector" in "table", or NULL if there isn't
+//	one.
+//----------------------------------------------------------------------
+
+JournalEntry *
+Journal::Find(JournalEntry *table, int size, int sector)
+{
+    for (int i = 0; i < size; i++)
+	if (table[i].sector == sector)
+	    return &table[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a metadata operation.  Wait until no other operation is
+//	running.  An operation may call Begin again (for instance, when
+//	creating a file makes its directory grow); only the outermost
+//	End finishes the operation.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    lock->Acquire();
+    if (owner == currentThread) {
+	depth++;
+	lock->Release();
+	return;
+    }
+    waiting++;
+    while ((owner != NULL) || committing)
+	opDone->Wait(lock);
+    waiting--;
+    owner = currentThread;
+    depth = 1;
+    numOps++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Finish a metadata operation, and return once everything it wrote
+//	has been committed to the log.
+//
+//	If other operations are waiting to start, we let the next one
+//	go, and wait for the group to be committed by whoever finishes
+//	last.  Otherwise, we commit the group ourselves.
+//----------------------------------------------------------------------
+
+void
+Journal::End()
+{
+    int group;
+
+    lock->Acquire();
+    ASSERT(owner == currentThread);
+    if (--depth > 0) {
+	lock->Release();
+	return;
+    }
+    owner = NULL;
+    if (waiting > 0) {
+	opDone->Signal(lock);
+	group = seq;
+	while ((numPending > 0) && (seq == group))
+	    groupDone->Wait(lock);
+    } else
+	CommitGroup();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::ReadSector
+// 	Read a sector, from the journal's copy if it has one, otherwise
+//	from the disk.
+//----------------------------------------------------------------------
+
+void
+Journal::ReadSector(int sector, char *data)
+{
+    JournalEntry *entry;
+
+    lock->Acquire();
+    entry = Find(pending, numPending, sector);
+    if (entry == NULL)
+	entry = Find(committed, numCommitted, sector);
+    if (entry != NULL) {
+	memcpy(data, entry->data, SectorSize);
+	lock->Release();
+	return;
+    }
+    lock->Release();
+    synchDisk->ReadSector(sector, data);
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteSector
+// 	Write a sector.  Inside a metadata operation, the write is added
+//	to the open group.  Outside of one, it goes straight to disk,
+//	unless the journal has a copy of the sector, in which case it is
+//	logged as an operation of its own.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteSector(int sector, char *data)
+{
+    bool held;
+
+    lock->Acquire();
+    if (owner == currentThread) {
+	Log(sector, data);
+	lock->Release();
+	return;
+    }
+    held = (Find(pending, numPending, sector) != NULL) ||
+		(Find(committed, numCommitted, sector) != NULL);
+    lock->Release();
+
+    if (!held) {
+	synchDisk->WriteSector(sector, data);
+	return;
+    }
+    Begin();
+    lock->Acquire();
+    Log(sector, data);
+    lock->Release();
+    End();
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	Add a sector to the open group, replacing an earlier write of the
+//	same sector.  If the group is full, commit it first, even though
+//	the current operation isn't done.
+//
+//	Assumes the journal lock is held.
+//----------------------------------------------------------------------
+
+void
+Journal::Log(int sector, char *data)
+{
+    JournalEntry *entry = Find(pending, numPending, sector);
+
+    if (entry == NULL) {
+	if (numPending == MaxGroupSectors) {
+	    DEBUG('f', "Journal group full, committing early\n");
+	    CommitGroup();
+	}
+	entry = &pending[numPending++];
+	entry->sector = sector;
+    }
+    memcpy(entry->data, data, SectorSize);
+}
+
+//----------------------------------------------------------------------
+// Journal::CommitGroup
+// 	Write the open group to the log: descriptor blocks, each followed
+//	by the sectors it describes.  The last descriptor is the commit
+//	block; it is written after its sectors, so once it is on disk,
+//	the whole group is, and will survive a crash.  If the log doesn't
+//	have room for the group, checkpoint first.
+//
+//	No operation can start while the group is being written, but
+//	we let go of the lock during the disk writes, so that reads can
+//	still be served.
+//
+//	Assumes the journal lock is held.
+//----------------------------------------------------------------------
+
+void
+Journal::CommitGroup()
+{
+    JournalBlock block;
+    JournalEntry *entry;
+    int size, pos, n, i, j;
+    bool checkpoint;
+
+    if (numPending == 0)
+	return;
+    committing = TRUE;
+    size = numPending + divRoundUp(numPending, EntriesPerBlock);
+    checkpoint = (logPos + size > LogSize);
+    lock->Release();
+
+    if (checkpoint)
+	Checkpoint();
+    DEBUG('f', "Committing journal group %d, %d sectors\n", seq, numPending);
+    memset(&block, 0, sizeof(JournalBlock));
+    pos = LogStart + logPos;
+    for (i = 0; i < numPending; i += n) {
+	n = min(numPending - i, EntriesPerBlock);
+	block.magic = (i + n < numPending) ? DescriptorMagic : CommitMagic;
+	block.seq = seq;
+	block.count = n;
+	for (j = 0; j < n; j++) {
+	    block.sectors[j] = pending[i + j].sector;
+	    synchDisk->WriteSector(pos + 1 + j, pending[i + j].data);
+	}
+	synchDisk->WriteSector(pos, (char *)&block);
+	pos += 1 + n;
+    }
+
+    lock->Acquire();
+    if (checkpoint)
+	numCommitted = 0;
+    for (i = 0; i < numPending; i++) {
+	entry = Find(committed, numCommitted, pending[i].sector);
+	if (entry == NULL) {
+	    entry = &committed[numCommitted++];
+	    entry->sector = pending[i].sector;
+	}
+	memcpy(entry->data, pending[i].data, SectorSize);
+    }
+    numPending = 0;
+    logPos += size;
+    seq++;
+    numGroups++;
+    numLogWrites += size;
+    committing = FALSE;
+    groupDone->Broadcast(lock);
+    opDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Write every committed sector to its home location, then mark the
+//	log as empty by advancing the sequence number in the journal
+//	header.  If we crash before the header is written, replay just
+//	writes the same sectors again.
+//
+//	Called with no operation able to change the committed table.
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint()
+{
+    DEBUG('f', "Checkpointing %d journaled sectors\n", numCommitted);
+    for (int i = 0; i < numCommitted; i++)
+	synchDisk->WriteSector(committed[i].sector, committed[i].data);
+    logPos = 0;
+    WriteHeader();
+    numCheckpoints++;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteHeader
+// 	Record that the log starts with group "seq".  Anything left in
+//	the log from older groups will be ignored.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteHeader()
+{
+    JournalBlock header;
+
+    memset(&header, 0, sizeof(JournalBlock));
+    header.magic = JournalMagic;
+    header.seq = seq;
+    synchDisk->WriteSector(JournalSector, (char *)&header);
+}
+
+//----------------------------------------------------------------------
+// Journal::ClearLog
+// 	Zero every sector of the log, for a new journal.  The sequence
+//	numbers start over at 1, so groups left in the log by an earlier
+//	file system on the same disk would otherwise look like ours to
+//	Replay.
+//----------------------------------------------------------------------
+
+void
+Journal::ClearLog()
+{
+    char zeroes[SectorSize];
+
+    memset(zeroes, 0, SectorSize);
+    for (int i = 0; i < LogSize; i++)
+	synchDisk->WriteSector(LogStart + i, zeroes);
+}
+
+//----------------------------------------------------------------------
+// Journal::Replay
+// 	Copy every committed group in the log to its home locations.
+//	Groups are found one after another from the start of the log,
+//	with consecutive sequence numbers starting at the one in the
+//	journal header.  We stop at the first group without a commit
+//	block -- the operations in it never finished.
+//----------------------------------------------------------------------
+
+void
+Journal::Replay()
+{
+    JournalBlock header, block;
+    char data[SectorSize];
+    int homes[LogSize], where[LogSize];
+    int pos = 0, p, n, i, replayed = 0;
+    bool complete, valid;
+
+    synchDisk->ReadSector(JournalSector, (char *)&header);
+    if (header.magic != JournalMagic) {
+	DEBUG('f', "No journal on disk, starting a new one\n");
+	ClearLog();
+	WriteHeader();
+	return;
+    }
+    seq = header.seq;
+
+    for (;;) {
+	n = 0;
+	p = pos;
+	complete = FALSE;
+	while (p < LogSize) {
+	    synchDisk->ReadSector(LogStart + p, (char *)&block);
+	    if (block.seq != seq)
+		break;
+	    valid = ((block.magic == DescriptorMagic) || 
+			(block.magic == CommitMagic)) && (block.count > 0) &&
+			(block.count <= EntriesPerBlock) &&
+			(p + 1 + block.count <= LogSize);
+	    for (i = 0; valid && (i < block.count); i++)
+		valid = (block.sectors[i] >= 0) &&
+				(block.sectors[i] < JournalSector);
+	    if (!valid)
+		break;
+	    for (i = 0; i < block.count; i++) {
+		homes[n] = block.sectors[i];
+		where[n] = LogStart + p + 1 + i;
+		n++;
+	    }
+	    p += 1 + block.count;
+	    if (block.magic == CommitMagic) {
+		complete = TRUE;
+		break;
+	    }
+	}
+	if (!complete)
+	    break;
+
+	DEBUG('f', "Replaying journal group %d, %d sectors\n", seq, n);
+	for (i = 0; i < n; i++) {
+	    synchDisk->ReadSector(where[i], data);
+	    synchDisk->WriteSector(homes[i], data);
+	}
+	replayed += n;
+	pos = p;
+	seq++;
+    }
+    if (replayed > 0)
+	printf("Journal: replayed %d sectors\n", replayed);
+    logPos = 0;
+    WriteHeader();
+}
+
+//----------------------------------------------------------------------
+// Journal::Print
+// 	Print how much work the journal has done.
+//----------------------------------------------------------------------
+
+void
+Journal::Print()
+{
+    printf("Journal: %d operations, %d group commits, %d log writes, "
+		"%d checkpoints\n", numOps, numGroups, numLogWrites,
+		numCheckpoints);
+}
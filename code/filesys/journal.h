@@ -0,0 +1,130 @@
+// journal.h
+//	Data structures for a write-ahead journal of file system metadata.
+//
+//	File system operations that change metadata (the bitmap,
+//	directories, and file headers) are bracketed by Begin and End.
+//	In between, sector writes are collected in memory instead of
+//	going to disk.  The changes made by all the operations that run
+//	while one is in progress are written to the journal together, as
+//	one "group commit"; End returns only once the caller's changes
+//	are safely in the journal.
+//
+//	Committed sectors stay in memory, and are only written to their
+//	home locations on disk when the journal fills up (a "checkpoint").
+//	If Nachos crashes before then, Replay copies them from the
+//	journal on the next boot.
+//
+//	Begin also serializes metadata operations, so two operations can
+//	never both grab the same free sector.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+
+// The journal lives in the last JournalSectors sectors of the disk.  The
+// first of these holds a JournalBlock with the sequence number of the
+// first group that hasn't been checkpointed; the rest is the log.
+#define JournalSectors		64
+#define JournalSector		(NumSectors - JournalSectors)
+#define LogStart		(JournalSector + 1)
+#define LogSize			(JournalSectors - 1)
+
+#define JournalMagic		0x4a524e4c	// "JRNL"
+#define DescriptorMagic		0x44455343	// "DESC"
+#define CommitMagic		0x434d4954	// "CMIT"
+
+// A group is written to the log as a series of descriptor blocks, each
+// followed by the (up to) EntriesPerBlock sectors it describes.  The
+// last descriptor of a group is its commit block, and is written after
+// everything else in the group.  A group without its commit block is
+// ignored by Replay.
+#define EntriesPerBlock		((int)(SectorSize / sizeof(int)) - 3)
+
+// The most sectors one group can hold, so that a group (with its
+// descriptors) always fits in an empty log.  An operation that writes
+// more than this is split across groups, and is not atomic.
+#define MaxGroupSectors		48
+
+// The following class defines the format of the journal's own blocks:
+// the journal header, and descriptors (including commit blocks).  Its
+// size is exactly one sector.
+
+class JournalBlock {
+  public:
+    int magic;				// What kind of block this is
+    int seq;				// Group this block belongs to
+    int count;				// Sectors described by this block
+    int sectors[EntriesPerBlock];	// Home location of each sector
+};
+
+// A sector that has been written by a metadata operation, but not yet
+// to its home location on disk.
+
+class JournalEntry {
+  public:
+    int sector;				// Home location of the sector
+    char data[SectorSize];		// Its newest contents
+};
+
+class Journal {
+  public:
+    Journal(bool format);		// If "format", start an empty
+					// journal; otherwise replay what's
+					// on disk
+    ~Journal();				// De-allocate the journal
+
+    void Shutdown();			// Checkpoint everything, before
+					// Nachos halts
+
+    void Begin();			// Start a metadata operation
+    void End();				// Finish it, and wait until it has
+					// been committed
+
+    void ReadSector(int sector, char *data);
+    void WriteSector(int sector, char *data);
+					// Read/write a disk sector, going
+					// through the journal's copy, if
+					// it has one
+
+    void Print();			// Print journal statistics
+
+  private:
+    Lock *lock;				// Protects everything below
+    Condition *opDone;			// Signalled when no operation is
+					// in progress
+    Condition *groupDone;		// Broadcast when a group commits
+
+    Thread *owner;			// Thread running an operation
+    int depth;				// Nested Begin calls by "owner"
+    int waiting;			// Threads waiting to Begin
+    bool committing;			// Is a group being written?
+
+    JournalEntry pending[MaxGroupSectors];  // Sectors in the open group
+    int numPending;
+    JournalEntry committed[LogSize];	// Sectors committed, but not yet
+    int numCommitted;			// checkpointed
+
+    int seq;				// Sequence number of the open group
+    int logPos;				// Where the next group goes in the log
+
+    int numOps, numGroups, numLogWrites, numCheckpoints;
+
+    void Replay();			// Apply committed groups from disk
+    void Log(int sector, char *data);	// Add a sector to the open group
+    void CommitGroup();			// Write the open group to the log
+    void Checkpoint();			// Write committed sectors home, and
+					// empty the log
+    void WriteHeader();			// Write the journal header
+    void ClearLog();			// Zero every sector of the log
+    JournalEntry *Find(JournalEntry *table, int size, int sector);
+};
+
+#endif // JOURNAL_H
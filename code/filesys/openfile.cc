@@ -5,7 +5,18 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  Writes past the end of the file
+//	grow it; if the growth fits in sectors that were preallocated by an
+//	earlier write, only the in-memory header changes, and it is written
+//	back when the file is closed.
+//
+//	A file that is open more than once has only one header in memory,
+//	shared by all of its OpenFiles, so that growth through one is seen
+//	by the others, and the header is only written back as a whole.
+//
+//	A file removed while it is open keeps its sectors until the last
+//	open of it is closed.  Until then it can be read and written, but
+//	it no longer grows, and its header is not written back.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,29 +31,138 @@ extern "C" {
 	int bcopy(char*, char *, int);
 };
 
+// The in-memory header of an open file, and how many OpenFiles are
+// using it.  All of them are kept on the list "openHeaders".
+
+class OpenHeader {
+  public:
+    int sector;				// where the header lives on disk
+    FileHeader *hdr;
+    bool dirty;				// Has the file length changed since
+					// the header was last written?
+    bool removed;			// Removed from its directory; free
+					// it on the last close
+    int refCount;			// OpenFiles sharing the header
+    OpenHeader *next;
+};
+
+static OpenHeader *openHeaders = NULL;
+
+//----------------------------------------------------------------------
+// FindHeader
+// 	Return the in-memory header of the file whose header is at
+//	"sector", or NULL if the file isn't open.
+//----------------------------------------------------------------------
+
+static OpenHeader *
+FindHeader(int sector)
+{
+    OpenHeader *h;
+
+    for (h = openHeaders; h != NULL; h = h->next)
+	if (h->sector == sector)
+	    return h;
+    return NULL;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is already there
+//	because the file is open elsewhere.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    shared = FindHeader(sector);
+    if (shared == NULL) {
+	FileHeader *fresh = new FileHeader;
+
+	fresh->FetchFrom(sector);
+	shared = FindHeader(sector);	// someone else may have opened
+	if (shared != NULL)		// the file while we waited for
+	    delete fresh;		// the disk
+	else {
+	    shared = new OpenHeader;
+	    shared->sector = sector;
+	    shared->hdr = fresh;
+	    shared->dirty = FALSE;
+	    shared->removed = FALSE;
+	    shared->refCount = 0;
+	    shared->next = openHeaders;
+	    openHeaders = shared;
+	}
+    }
+    shared->refCount++;
+    hdr = shared->hdr;
+    hdrSector = sector;
+    growHint = MinGrowthSectors;
     seekPosition = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	If the file grew while it was open, flush the new length to disk.
+//	The header stays in memory until the last open of the file is
+//	closed.  If the file was removed meanwhile, the last close gives
+//	back its space.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    OpenHeader **h;
+
+    Flush();
+    if (--shared->refCount > 0)
+	return;
+    for (h = &openHeaders; *h != shared; h = &(*h)->next)
+	;
+    *h = shared->next;
+    if (shared->removed)
+	fileSystem->FreeFile(hdr, hdrSector);
+    delete shared->hdr;
+    delete shared;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::MarkRemoved
+// 	Called by FileSystem::Remove once the file whose header is at
+//	"sector" is out of its directory.  If the file is open, mark it
+//	so that its space is freed by the last close, and return TRUE;
+//	return FALSE if it isn't open, and the caller should free it.
+//----------------------------------------------------------------------
+
+bool
+OpenFile::MarkRemoved(int sector)
+{
+    OpenHeader *h = FindHeader(sector);
+
+    if (h == NULL)
+	return FALSE;
+    h->removed = TRUE;
+    h->dirty = FALSE;			// never written back now
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Flush
+// 	If the file has grown since its header was last written, write
+//	the header back to disk.  Files that are kept open while Nachos
+//	is running (such as directories) call this to make a new length
+//	stick.  A removed file's header is never written back, since its
+//	sector may be about to go to another file.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Flush()
+{
+    if (shared->dirty && !shared->removed) {
+	shared->dirty = FALSE;		// before the write, which may wait,
+	hdr->WriteBack(hdrSector);	// so growth meanwhile marks it again
+    }
 }
 
 //----------------------------------------------------------------------
@@ -102,7 +222,14 @@ OpenFile::Write(char *into, int numBytes)
 //	   We read in all of the full or partial sectors that are part of the
 //	   request, but we only copy the part we are interested in.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
+//	   If the request runs past the end of the file, we first grow the
+//	   file (see FileSystem::ExtendFile).  Each time the file has to 
+//	   allocate more sectors, we ask for a bigger batch, so a file 
+//	   being appended to in small pieces grows in a few large, 
+//	   contiguous chunks.  If the disk is full, we write as much as 
+//	   fits in the file as it is.
+//
+//	   We must then read in any sectors that will be partially written,
 //	   so that we don't overwrite the unmodified portion.  We then copy
 //	   in the data that will be modified, and write back all the full
 //	   or partial sectors that are part of the request.
@@ -135,7 +262,7 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     // read in all the full and partial sectors that we need
     buf = new char[numSectors * SectorSize];
     for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
+        journal->ReadSector(hdr->ByteToSector(i * SectorSize), 
 					&buf[(i - firstSector) * SectorSize]);
 
     // copy the part we want
@@ -152,10 +279,25 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     bool firstAligned, lastAligned;
     char *buf;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if ((numBytes <= 0) || (position < 0))
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
+    if ((position + numBytes) > fileLength) {
+	int allocated = hdr->AllocatedLength();
+	int newLength = min(position + numBytes, MaxFileSize);
+
+	if ((newLength > fileLength) && !shared->removed &&
+	    fileSystem->ExtendFile(hdr, hdrSector, newLength, growHint)) {
+	    shared->dirty = TRUE;
+	    if (hdr->AllocatedLength() > allocated)	// had to allocate,
+		growHint = min(growHint * 2, MaxGrowthSectors); // so ask for
+							// more next time
+	    fileLength = hdr->FileLength();
+	}
+	if (position >= fileLength)
+	    return 0;				// no room to grow
+	if ((position + numBytes) > fileLength)
+	    numBytes = fileLength - position;
+    }
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
 			numBytes, position, fileLength);
 
@@ -180,7 +322,7 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 
 // write modified sectors back
     for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
+        journal->WriteSector(hdr->ByteToSector(i * SectorSize), 
 					&buf[(i - firstSector) * SectorSize]);
     delete [] buf;
     return numBytes;
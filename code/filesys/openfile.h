@@ -60,6 +60,7 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class OpenHeader;
 
 class OpenFile {
   public:
@@ -85,9 +86,24 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    void Flush();			// Write the file header back to disk,
+					// if the file has grown since it was
+					// last written
+
+    static bool MarkRemoved(int sector);
+					// If the file whose header is at
+					// "sector" is open, have its last
+					// close free its space, and return
+					// TRUE
     
   private:
-    FileHeader *hdr;			// Header for this file 
+    OpenHeader *shared;			// The in-memory header, shared by
+					// every open of this file
+    FileHeader *hdr;			// Header for this file (shared->hdr)
+    int hdrSector;			// Disk sector holding the header
+    int growHint;			// How many sectors to preallocate the
+					// next time the file has to grow
     int seekPosition;			// Current position within the file
 };
 
@@ -129,6 +129,8 @@ Disk::ReadRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskReads++;
+    currentThread->account->numDiskReads++;
+    TRACE(TraceDiskRead, sectorNumber);
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
@@ -149,6 +151,8 @@ Disk::WriteRequest(int sectorNumber, char* data)
     active = TRUE;
     UpdateLast(sectorNumber);
     stats->numDiskWrites++;
+    currentThread->account->numDiskWrites++;
+    TRACE(TraceDiskWrite, sectorNumber);
     interrupt->Schedule(DiskDone, (int) this, ticks, DiskInt);
 }
 
@@ -162,6 +166,7 @@ void
 Disk::HandleInterrupt ()
 { 
     active = FALSE;
+    TRACE(TraceDiskDone, 0);
     (*handler)(handlerArg);
 }
 
@@ -14,6 +14,12 @@
 //		a user instruction is executed
 //		there is nothing in the ready queue
 //
+//	Devices fed from host files (the network) don't poll them on
+//	a timer.  They ask to be "watched"; OneTick checks every watched
+//	file with one select, no more than once every NetworkTime ticks,
+//	and Idle sleeps in select until there's input or the next
+//	interrupt is due.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -29,7 +35,7 @@ using namespace std;
 // String definitions for debugging messages
 static char *intLevelNames[] = { "off", "on"};
 static char *intTypeNames[] = { "timer", "disk", "console write", 
-            "console read", "network send", "network recv"};
+            "console read", "network send", "network recv", "network timer"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -65,6 +71,8 @@ Interrupt::Interrupt()
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    numWatched = 0;
+    nextInputCheck = 0;
 }
 
 //----------------------------------------------------------------------
@@ -158,10 +166,13 @@ Interrupt::OneTick()
     {
         stats->totalTicks += (int64_t)SystemTick;
 	    stats->systemTicks += (int64_t)SystemTick;
+	    if (currentThread != NULL)
+		currentThread->account->systemTicks += (int64_t)SystemTick;
     } else 
     {					// USER_PROGRAM
 	    stats->totalTicks += (int64_t)UserTick;
 	    stats->userTicks += (int64_t)UserTick;
+	    currentThread->account->userTicks += (int64_t)UserTick;
     }
     
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
@@ -174,6 +185,10 @@ Interrupt::OneTick()
 					// (interrupt handlers run with
 					// interrupts disabled)
     
+    if ((numWatched > 0) && (stats->totalTicks >= nextInputCheck)) {
+	nextInputCheck = stats->totalTicks + NetworkTime;
+	CheckInput(0);			// has any input arrived?
+    }
     while (CheckIfDue(FALSE))		// check for pending interrupts
 	;
     
@@ -221,6 +236,8 @@ Interrupt::Idle()
 {
     DEBUG('i', "Machine idling; checking for interrupts.\n");
     status = IdleMode;
+    if (numWatched > 0)
+	WaitForInput();
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
 	    ;				// interrupts
@@ -242,6 +259,140 @@ Interrupt::Idle()
     Halt();
 }
 
+//----------------------------------------------------------------------
+// InputReady
+// 	Interrupt handler for a watched file: call the device's handler.
+//	The device should read everything that's waiting; if anything
+//	is left, the next check will schedule us again.
+//----------------------------------------------------------------------
+
+static void
+InputReady(int arg)
+{
+    WatchedFile *w = (WatchedFile *)arg;
+
+    w->scheduled = FALSE;
+    (*(w->handler))(w->arg);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::WatchFile
+// 	Arrange for "handler" to be called, as an interrupt of type
+//	"type", whenever host file "fd" has something to be read.
+//----------------------------------------------------------------------
+
+void
+Interrupt::WatchFile(int fd, VoidFunctionPtr handler, int arg, IntType type)
+{
+    ASSERT(numWatched < MaxWatchedFiles);
+    watched[numWatched].fd = fd;
+    watched[numWatched].handler = handler;
+    watched[numWatched].arg = arg;
+    watched[numWatched].type = type;
+    watched[numWatched].scheduled = FALSE;
+    numWatched++;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::UnwatchFile
+// 	Stop watching host file "fd".  Only call this when no interrupt
+//	for it can be pending (for instance, when shutting down).
+//----------------------------------------------------------------------
+
+void
+Interrupt::UnwatchFile(int fd)
+{
+    for (int i = 0; i < numWatched; i++)
+	if (watched[i].fd == fd) {
+	    watched[i] = watched[--numWatched];
+	    return;
+	}
+}
+
+//----------------------------------------------------------------------
+// Interrupt::CheckInput
+// 	Wait up to "usec" microseconds of host time (forever, if
+//	negative) for input on any watched file, with a single select.
+//	Schedule the handler of every file that has input, for the next
+//	tick, unless one is already on its way.
+//
+//	Returns the number of microseconds spent waiting.
+//----------------------------------------------------------------------
+
+int
+Interrupt::CheckInput(int usec)
+{
+    int fds[MaxWatchedFiles];
+    bool ready[MaxWatchedFiles];
+    int i, waited;
+
+    for (i = 0; i < numWatched; i++)
+	fds[i] = watched[i].fd;
+    waited = WaitForFiles(fds, ready, numWatched, usec);
+    for (i = 0; i < numWatched; i++)
+	if (ready[i] && !watched[i].scheduled) {
+	    watched[i].scheduled = TRUE;
+	    Schedule(InputReady, (int)&watched[i], 1, watched[i].type);
+	}
+    return waited;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::WaitForInput
+// 	Nothing is ready to run.  Before rolling simulated time forward to
+//	the next pending interrupt, wait on the host for input from a
+//	watched file -- for as long as that much simulated time would
+//	take (IdleWaitTime per NetworkTime ticks), or forever if nothing
+//	else is going to happen.  If input arrives, simulated time only
+//	moves forward by as much as we waited, and the input is handled
+//	first.
+//
+//	This replaces polling every NetworkTime ticks: an idle Nachos
+//	makes one select call, and uses no host CPU while it waits.
+//----------------------------------------------------------------------
+
+void
+Interrupt::WaitForInput()
+{
+    PendingInterrupt *next;
+    int64_t when, ticks;
+    int usec, waited, i;
+    bool onlyTimer;
+
+    for (i = 0; i < numWatched; i++)
+	if (watched[i].scheduled)
+	    return;			// input is already on its way
+
+    next = (PendingInterrupt *)pending->SortedRemove(&when);
+    onlyTimer = (next == NULL) || ((next->type == TimerInt) && 
+					pending->IsEmpty());
+    if (next != NULL)
+	pending->SortedInsert(next, when);
+
+    if (onlyTimer)
+	usec = -1;			// nothing else is going to happen
+    else if (when <= stats->totalTicks)
+	return;				// something is due already
+    else
+	usec = (int)min((when - stats->totalTicks) * IdleWaitTime / NetworkTime,
+			(int64_t)1000000000);
+
+    waited = CheckInput(usec);
+    for (i = 0; i < numWatched; i++)
+	if (watched[i].scheduled)
+	    break;
+    if (i == numWatched)
+	return;				// timed out; on to "next"
+
+    ticks = ((int64_t)waited * NetworkTime) / IdleWaitTime;
+    if ((next != NULL) && (stats->totalTicks + ticks >= when))
+	ticks = when - stats->totalTicks - 1;
+    if (ticks > 0) {
+	stats->idleTicks += ticks;
+	stats->totalTicks += ticks;
+    }
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
@@ -250,7 +401,14 @@ void
 Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
+#ifdef FILESYS
+    if (journal != NULL)
+	journal->Shutdown();	// so the next boot has nothing to replay
+#endif
     stats->Print();
+#ifdef USER_PROGRAM
+    SyscallReport();
+#endif
     Cleanup();     // Never returns.
 }
 
@@ -346,6 +504,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     if (machine != NULL)
     	machine->DelayedLoad(0, 0);
 #endif
+    TRACE(TraceInterrupt, toOccur->type);
     inHandler = TRUE;
     status = SystemMode;			// whatever we were doing,
 						// we are now going to be
@@ -50,7 +50,7 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 // In Nachos, we support a hardware timer device, a disk, a console
 // display and keyboard, and a network.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-				NetworkSendInt, NetworkRecvInt};
+				NetworkSendInt, NetworkRecvInt, NetworkTimerInt};
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -69,6 +69,27 @@ class PendingInterrupt {
     IntType type;		// for debugging
 };
 
+// A host file (for instance, the socket under the simulated network)
+// that a device wants to be interrupted about when it has something to
+// read.  Rather than have each device poll its file on a timer, the
+// interrupt simulation checks all of them together, and only
+// schedules the device's handler when there is input.
+
+#define MaxWatchedFiles	4
+
+// Host time a Nachos with no runnable threads waits, per NetworkTime
+// ticks of simulated time, for input from other Nachos
+#define IdleWaitTime	20000		// microseconds
+
+class WatchedFile {
+  public:
+    int fd;
+    VoidFunctionPtr handler;	// Called when "fd" has input
+    int arg;
+    IntType type;
+    bool scheduled;		// Is a call to "handler" pending?
+};
+
 // The following class defines the data structures for the simulation
 // of hardware interrupts.  We record whether interrupts are enabled
 // or disabled, and any hardware interrupts that are scheduled to occur
@@ -112,6 +133,10 @@ class Interrupt {
     
     void OneTick();       		// Advance simulated time
 
+    void WatchFile(int fd, VoidFunctionPtr handler, int arg, IntType type);
+    void UnwatchFile(int fd);		// Start/stop calling "handler"
+					// when host file "fd" has input
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
     List *pending;		// the list of interrupts scheduled
@@ -121,6 +146,10 @@ class Interrupt {
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
 
+    WatchedFile watched[MaxWatchedFiles];
+    int numWatched;
+    int64_t nextInputCheck;	// When OneTick next looks at "watched"
+
     // these functions are internal to the interrupt simulation code
 
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
@@ -128,6 +157,11 @@ class Interrupt {
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
+    int CheckInput(int usec);		// Wait up to "usec" for input on
+					// a watched file, and schedule
+					// the handlers of those that have
+    void WaitForInput();		// Idle until input or the next
+					// pending interrupt
 };
 
 #endif // INTERRRUPT_H
@@ -198,6 +198,8 @@ extern void ExceptionHandler(ExceptionType which);
 				// Entry point into Nachos for handling
 				// user system calls and exceptions
 				// Defined in exception.cc
+extern void SyscallReport();	// Print the syscall counts and times
+				// Defined in exception.cc
 
 
 // Routines for converting Words and Short Words to and from the
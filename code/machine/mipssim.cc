@@ -17,6 +17,8 @@
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
+static int profileCountdown = 0;	// instructions to the next PC sample
+
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -24,6 +26,9 @@ static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	When profiling, the PC is sampled every "profileInterval"
+//	instructions, whichever thread is running.
 //----------------------------------------------------------------------
 
 void
@@ -37,6 +42,11 @@ Machine::Run()
     for (;;) {
         OneInstruction(instr);
 	interrupt->OneTick();
+	if ((profileInterval > 0) && (--profileCountdown <= 0)) {
+	    profileCountdown = profileInterval;
+	    if (currentThread->space->profile != NULL)
+		currentThread->space->profile->Sample(registers[PCReg]);
+	}
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
@@ -25,8 +25,10 @@ static void NetworkSendDone(int arg)
 //   addr is used to generate the socket name
 //   reliability says whether we drop packets to emulate unreliable links
 //   readAvail, writeDone, callArg -- analogous to console
+//   queueDepth is how many packets can be on their way at once
 Network::Network(NetworkAddress addr, double reliability,
-	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg)
+	VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg,
+	int queueDepth)
 {
     ident = addr;
     if (reliability < 0) chanceToWork = 0;
@@ -37,67 +39,93 @@ Network::Network(NetworkAddress addr, double reliability,
     writeHandler = writeDone;
     readHandler = readAvail;
     handlerArg = callArg;
-    sendBusy = FALSE;
-    inHdr.length = 0;
+    txDepth = min(max(queueDepth, 1), MaxTxDepth);
+    txHead = txCount = txCompleted = 0;
+    txPending = FALSE;
+    inHead = inCount = 0;
     
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", (int)addr);
     AssignNameToSocket(sockName, sock);		 // Bind socket to a filename 
 						 // in the current directory.
 
-    // start polling for incoming packets
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
+    // get an interrupt whenever packets arrive on the socket
+    interrupt->WatchFile(sock, NetworkReadPoll, (int)this, NetworkRecvInt);
 }
 
 Network::~Network()
 {
+    interrupt->UnwatchFile(sock);
     CloseSocket(sock);
     DeAssignNameToSocket(sockName);
 }
 
-// if a packet is already buffered, we simply delay reading 
-// the incoming packet.  In real life, the incoming 
-// packet might be dropped if we can't read it in time.
+// called when the socket has packets waiting: take in every one we
+// have room for, so a burst is drained at once.  If the queue is full,
+// the rest wait in the socket -- the interrupt simulation will call us
+// again, since the socket is still readable.  In real life, they might
+// be dropped if we can't read them in time.
 void
 Network::CheckPktAvail()
 {
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
-
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
-	    return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	    return;
-    //cout << "Network::CheckPktAvail(): stats->totalTicks = " << stats->totalTicks << endl;
-    // otherwise, read packet in
-    char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
-
-    // divide packet into header and data
-    inHdr = *(PacketHeader *)buffer;
-    ASSERT((inHdr.to == ident) && (inHdr.length <= MaxPacketSize));
-    bcopy(buffer + sizeof(PacketHeader), inbox, inHdr.length);
-    delete []buffer ;
-
-    DEBUG('n', "Network received packet from %d, length %d...\n",
-	  				(int) inHdr.from, inHdr.length);
-    stats->numPacketsRecvd++;
-
-    // tell post office that the packet has arrived
-    (*readHandler)(handlerArg);	
+    PacketHeader *hdr;
+    int slot;
+
+    while ((inCount < NetworkQueueSize) && PollSocket(sock)) {
+	slot = (inHead + inCount) % NetworkQueueSize;
+	ReadFromSocket(sock, inbox[slot], MaxWireSize);
+	hdr = (PacketHeader *)inbox[slot];
+	ASSERT((hdr->to == ident) && (hdr->length <= MaxPacketSize));
+	inCount++;
+
+	DEBUG('n', "Network received packet from %d, length %d...\n",
+	  				(int) hdr->from, hdr->length);
+	stats->numPacketsRecvd++;
+	TRACE(TraceNetReceive, hdr->from);
+
+	// tell post office that the packet has arrived
+	(*readHandler)(handlerArg);
+    }
 }
 
-// notify user that another packet can be sent
+// retire every packet that is done sending, and notify the user that
+// more can be sent.  If packets are still on their way, interrupt
+// again only when the last of them is done, so that one interrupt
+// covers them all.
 void
 Network::SendDone()
 {
-    sendBusy = FALSE;
-    stats->numPacketsSent++;
-    (*writeHandler)(handlerArg);
+    txPending = FALSE;
+    while ((txCount > 0) && (txDone[txHead] <= stats->totalTicks)) {
+	txHead = (txHead + 1) % MaxTxDepth;
+	txCount--;
+	txCompleted++;
+	stats->numPacketsSent++;
+    }
+    stats->numSendInterrupts++;
+    if (txCount > 0) {
+	txPending = TRUE;
+	interrupt->Schedule(NetworkSendDone, (int)this, 
+		txDone[(txHead + txCount - 1) % MaxTxDepth] - stats->totalTicks,
+		NetworkSendInt);
+    }
+    if (txCompleted > 0)
+	(*writeHandler)(handlerArg);
+}
+
+// return how many packets have been sent since we were last asked
+int
+Network::SendsCompleted()
+{
+    int n = txCompleted;
+
+    txCompleted = 0;
+    return n;
 }
 
 // send a packet by concatenating hdr and data, and schedule
-// an interrupt to tell the user when the next packet can be sent 
+// an interrupt to tell the user when it has been sent, unless one is
+// already on its way
 //
 // Note we always pad out a packet to MaxWireSize before putting it into
 // the socket, because it's simpler at the receive end.
@@ -108,11 +136,18 @@ Network::Send(PacketHeader hdr, char* data)
 
     sprintf(toName, "SOCKET_%d", (int)hdr.to);
     
-    ASSERT((sendBusy == FALSE) && (hdr.length > 0) 
+    ASSERT((txCount < txDepth) && (hdr.length > 0) 
 		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
     DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
 
-    interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
+    TRACE(TraceNetSend, hdr.to);
+    txDone[(txHead + txCount) % MaxTxDepth] = stats->totalTicks + NetworkTime;
+    txCount++;
+    if (!txPending) {
+	txPending = TRUE;
+	interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, 
+				NetworkSendInt);
+    }
 
     if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
 	DEBUG('n', "oops, lost it!\n");
@@ -129,14 +164,19 @@ Network::Send(PacketHeader hdr, char* data)
     return retVal;
 }
 
-// read a packet, if one is buffered
+// read the oldest packet, if one is buffered
 PacketHeader
 Network::Receive(char* data)
 {
-    PacketHeader hdr = inHdr;
+    PacketHeader hdr;
 
-    inHdr.length = 0;
-    if (hdr.length != 0)
-    	bcopy(inbox, data, hdr.length);
+    if (inCount == 0) {
+	hdr.length = 0;
+	return hdr;
+    }
+    hdr = *(PacketHeader *)inbox[inHead];
+    bcopy(inbox[inHead] + sizeof(PacketHeader), data, hdr.length);
+    inHead = (inHead + 1) % NetworkQueueSize;
+    inCount--;
     return hdr;
 }
@@ -41,6 +41,13 @@ class PacketHeader {
 #define MaxPacketSize 	(MaxWireSize - sizeof(struct PacketHeader))	
 				// data "payload" of the largest packet
 
+#define NetworkQueueSize 16	// packets the device can hold until
+				// they are Received
+
+#define MaxTxDepth	32	// most packets the device can be sending
+				// at once
+#define DefaultTxDepth	8
+
 
 // The following class defines a physical network device.  The network
 // is capable of delivering fixed sized packets, in order but unreliably, 
@@ -51,23 +58,34 @@ class PacketHeader {
 // a packet.  Note that you can change the seed for the random number 
 // generator, by changing the arguments to RandomInit() in Initialize().
 // The random number generator is used to choose which packets to drop.
+//
+// The device has a transmit queue "txDepth" packets deep: that many can
+// be on their way at once, each taking NetworkTime to send.  Rather
+// than interrupt once per packet, the device interrupts once for every
+// packet that has finished by then, so a burst costs one interrupt.
 
 class Network {
   public:
     Network(NetworkAddress addr, double reliability,
-  	  VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg);
+  	  VoidFunctionPtr readAvail, VoidFunctionPtr writeDone, int callArg,
+	  int queueDepth);
 				// Allocate and initialize network driver
     ~Network();			// De-allocate the network driver data
     
     bool Send(PacketHeader hdr, char* data);
     				// Send the packet data to a remote machine,
 				// specified by "hdr".  Returns immediately.
-    				// "writeHandler" is invoked once the next 
-				// packet can be sent.  Note that writeHandler 
+				// There must be room in the transmit queue.
+    				// "writeHandler" is invoked once packets
+				// have been sent.  Note that writeHandler 
 				// is called whether or not the packet is 
 				// dropped, and note that the "from" field of 
 				// the PacketHeader is filled in automatically 
 				// by Send().
+    int SendsCompleted();	// How many packets have been sent since
+				// the last call -- that is, how many
+				// transmit queue slots have freed up
+    int TxDepth() { return txDepth; }
 
     PacketHeader Receive(char* data);
     				// Poll the network for incoming messages.  
@@ -78,7 +96,9 @@ class Network {
 
     void SendDone();		// Interrupt handler, called when message is 
 				// sent
-    void CheckPktAvail();	// Check if there is an incoming packet
+    void CheckPktAvail();	// Interrupt handler, called when the socket
+				// has packets; takes in as many as fit,
+				// calling "readHandler" once for each
 
   private:
     NetworkAddress ident;	// This machine's network address
@@ -91,11 +111,16 @@ class Network {
 				// 	arrived.
     int handlerArg;		// Argument to be passed to interrupt handler
 				//   (pointer to post office)
-    bool sendBusy;		// Packet is being sent.
-    bool packetAvail;		// Packet has arrived, can be pulled off of
-				//   network
-    PacketHeader inHdr;		// Information about arrived packet
-    char inbox[MaxPacketSize];  // Data for arrived packet
+    int txDepth;		// Size of the transmit queue
+    int64_t txDone[MaxTxDepth];	// When each packet being sent will be
+				// done, oldest at "txHead"
+    int txHead, txCount;
+    int txCompleted;		// Sent, but not yet reported
+    bool txPending;		// Is a SendDone interrupt scheduled?
+    int inHead, inCount;	// Packets waiting to be Received
+    char inbox[NetworkQueueSize][MaxWireSize];  // Arrived packets, as
+				// they came off the wire: PacketHeader,
+				// then data.  Oldest at "inHead"
 };
 
 #endif // NETWORK_H
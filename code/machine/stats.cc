@@ -7,6 +7,7 @@
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 #include <stdio.h>
+#include <string.h>
 #include <iostream>
 #include "copyright.h"
 #include "utility.h"
@@ -23,6 +24,38 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numSendInterrupts = 0;
+    numStacksAllocated = numStacksReused = 0;
+    numContextSwitches = numLockWaits = numLockHandoffs = 0;
+    numInversions = 0;
+    inversionTicks = maxInversionTicks = 0;
+    numTimerInterrupts = numTimerStops = 0;
+    numTLBMisses = 0;
+    threads = lastThread = NULL;
+    numThreads = 0;
+    accountFile = NULL;
+}
+
+//----------------------------------------------------------------------
+// Statistics::NewThread
+// 	Start keeping statistics for a new thread, and put them on the
+//	list to be printed at the end.
+//
+//	"threadName" is the name of the thread.
+//----------------------------------------------------------------------
+
+ThreadStatistics *
+Statistics::NewThread(char *threadName)
+{
+    ThreadStatistics *account = new ThreadStatistics(threadName);
+
+    if (threads == NULL)
+	threads = account;
+    else
+	lastThread->next = account;
+    lastThread = account;
+    account->id = ++numThreads;
+    return account;
 }
 
 //----------------------------------------------------------------------
@@ -43,4 +76,268 @@ Statistics::Print()
     printf("Paging: faults %d\n", numPageFaults);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    if ((numPacketsSent > 0) || (numPacketsRecvd > 0))
+	printf("Network rate: %.4f packets/tick sent, %.4f received, "
+		"%d send interrupts\n", (double)numPacketsSent / totalTicks,
+		(double)numPacketsRecvd / totalTicks, numSendInterrupts);
+    printf("Thread stacks: allocated %d, reused %d\n", numStacksAllocated,
+	numStacksReused);
+    printf("Context switches: %d, lock waits %d, lock handoffs %d\n",
+	numContextSwitches, numLockWaits, numLockHandoffs);
+    if (numInversions > 0)
+	cout << "Priority inversions: " << numInversions << ", ticks " <<
+	    inversionTicks << ", longest " << maxInversionTicks << endl;
+    if (numTimerInterrupts > 0)
+	printf("Timer: interrupts %d, stopped %d times\n", numTimerInterrupts,
+	    numTimerStops);
+    if (numTLBMisses > 0)
+	printf("TLB: misses %d\n", numTLBMisses);
+    PrintAccounts();
+}
+
+//----------------------------------------------------------------------
+// Statistics::PrintAccounts
+// 	Print each thread's statistics, then each user process's -- the
+//	sum over its threads.  If "accountFile" is set, write them there
+//	too, as CSV, with a header line naming the columns.
+//----------------------------------------------------------------------
+
+void
+Statistics::PrintAccounts()
+{
+    ThreadStatistics *t, *u, process("");
+    FILE *file = NULL;
+    bool seen;
+
+    if (accountFile != NULL) {
+	file = fopen(accountFile, "w");
+	if (file == NULL)
+	    printf("Can't write accounting to %s\n", accountFile);
+	else
+	    fprintf(file, "kind,name,pid,user_ticks,system_ticks,syscalls,"
+		"page_faults,tlb_misses,disk_reads,disk_writes,"
+		"context_switches,lock_waits,lock_wait_ticks,"
+		"syscalls_by_code\n");
+    }
+
+    printf("Per-thread accounting:\n");
+    for (t = threads; t != NULL; t = t->next) {
+	t->Print("thread");
+	if (file != NULL)
+	    t->Dump(file, "thread");
+    }
+
+    // Each process is totalled when we reach its first thread
+    for (t = threads; t != NULL; t = t->next) {
+	if (t->processID < 0)
+	    continue;
+	seen = FALSE;
+	for (u = threads; u != t; u = u->next)
+	    if (u->processID == t->processID)
+		seen = TRUE;
+	if (seen)
+	    continue;
+
+	process = ThreadStatistics("");
+	sprintf(process.name, "process %d", t->processID);
+	process.processID = t->processID;
+	for (u = t; u != NULL; u = u->next)
+	    if (u->processID == t->processID)
+		process.Add(u);
+	process.Print("process");
+	if (file != NULL)
+	    process.Dump(file, "process");
+    }
+
+    if (file != NULL)
+	fclose(file);
+}
+
+//----------------------------------------------------------------------
+// ThreadStatistics::ThreadStatistics
+// 	Initialize a thread's statistics to zero.
+//
+//	"threadName" is the name of the thread; only the first
+//		AccountNameLength - 1 characters are kept.
+//----------------------------------------------------------------------
+
+ThreadStatistics::ThreadStatistics(char *threadName)
+{
+    strncpy(name, threadName, AccountNameLength - 1);
+    name[AccountNameLength - 1] = '\0';
+    id = 0;
+    processID = -1;
+    systemTicks = userTicks = 0;
+    for (int i = 0; i < NumSyscallTypes; i++)
+	numSyscalls[i] = 0;
+    numPageFaults = numTLBMisses = 0;
+    numDiskReads = numDiskWrites = 0;
+    numContextSwitches = numLockWaits = 0;
+    lockWaitTicks = 0;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// ThreadStatistics::Add
+// 	Add another thread's counters into these.
+//----------------------------------------------------------------------
+
+void
+ThreadStatistics::Add(ThreadStatistics *other)
+{
+    systemTicks += other->systemTicks;
+    userTicks += other->userTicks;
+    for (int i = 0; i < NumSyscallTypes; i++)
+	numSyscalls[i] += other->numSyscalls[i];
+    numPageFaults += other->numPageFaults;
+    numTLBMisses += other->numTLBMisses;
+    numDiskReads += other->numDiskReads;
+    numDiskWrites += other->numDiskWrites;
+    numContextSwitches += other->numContextSwitches;
+    numLockWaits += other->numLockWaits;
+    lockWaitTicks += other->lockWaitTicks;
+}
+
+//----------------------------------------------------------------------
+// ThreadStatistics::TotalSyscalls
+// 	Return how many syscalls were made, of all codes.
+//----------------------------------------------------------------------
+
+int
+ThreadStatistics::TotalSyscalls()
+{
+    int total = 0;
+
+    for (int i = 0; i < NumSyscallTypes; i++)
+	total += numSyscalls[i];
+    return total;
+}
+
+//----------------------------------------------------------------------
+// ThreadStatistics::Print
+// 	Print the counters on one line, and the syscalls made, by code,
+//	on the next if there were any.
+//
+//	"kind" is what the counters are for, "thread" or "process".
+//----------------------------------------------------------------------
+
+void
+ThreadStatistics::Print(char *kind)
+{
+    printf("  %s %s (pid %d): ticks user %lld, system %lld; syscalls %d, "
+	"page faults %d, TLB misses %d, disk reads %d, writes %d, "
+	"switches %d, lock waits %d (%lld ticks)\n", kind, name, processID,
+	(long long) userTicks, (long long) systemTicks, TotalSyscalls(),
+	numPageFaults, numTLBMisses, numDiskReads, numDiskWrites,
+	numContextSwitches, numLockWaits, (long long) lockWaitTicks);
+    if (TotalSyscalls() == 0)
+	return;
+    printf("    syscalls by code:");
+    for (int i = 0; i < NumSyscallTypes; i++)
+	if (numSyscalls[i] > 0)
+	    printf(" %d:%d", i, numSyscalls[i]);
+    printf("\n");
+}
+
+//----------------------------------------------------------------------
+// ThreadStatistics::Dump
+// 	Write the counters to "file" as one line of CSV; the syscalls by
+//	code go in the last column, as "code:count" pairs separated by
+//	spaces.
+//
+//	"kind" is what the counters are for, "thread" or "process".
+//----------------------------------------------------------------------
+
+void
+ThreadStatistics::Dump(FILE *file, char *kind)
+{
+    fprintf(file, "%s,%s,%d,%lld,%lld,%d,%d,%d,%d,%d,%d,%d,%lld,", kind,
+	name, processID, (long long) userTicks, (long long) systemTicks,
+	TotalSyscalls(), numPageFaults, numTLBMisses, numDiskReads,
+	numDiskWrites, numContextSwitches, numLockWaits,
+	(long long) lockWaitTicks);
+    for (int i = 0, n = 0; i < NumSyscallTypes; i++)
+	if (numSyscalls[i] > 0)
+	    fprintf(file, "%s%d:%d", (n++ > 0) ? " " : "", i, numSyscalls[i]);
+    fprintf(file, "\n");
+}
+
+//----------------------------------------------------------------------
+// LatencyHistogram::LatencyHistogram
+// 	Initialize an empty histogram.
+//----------------------------------------------------------------------
+
+LatencyHistogram::LatencyHistogram()
+{
+    count = 0;
+    total = longest = 0;
+    for (int i = 0; i < NumLatencyBuckets; i++)
+	buckets[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// LatencyHistogram::Record
+// 	Count one time, in the bucket for its power of two.
+//
+//	"time" is how long it took, in whatever unit the histogram is in.
+//----------------------------------------------------------------------
+
+void
+LatencyHistogram::Record(int64_t time)
+{
+    int i = 0;
+
+    if (time < 0)
+	time = 0;
+    while ((i < NumLatencyBuckets - 1) && (time >= ((int64_t) 1 << i)))
+	i++;
+    buckets[i]++;
+    count++;
+    total += time;
+    if (time > longest)
+	longest = time;
+}
+
+//----------------------------------------------------------------------
+// LatencyHistogram::Percentile
+// 	Return a time that "percent" of the times recorded are below:
+//	the upper bound of the bucket where they run out, or the longest
+//	time if that is less.
+//----------------------------------------------------------------------
+
+int64_t
+LatencyHistogram::Percentile(int percent)
+{
+    int64_t wanted = ((int64_t) count * percent + 99) / 100;
+    int64_t seen = 0;
+
+    for (int i = 0; i < NumLatencyBuckets - 1; i++) {
+	seen += buckets[i];
+	if (seen >= wanted)
+	    return min((int64_t) 1 << i, longest);
+    }
+    return longest;
+}
+
+//----------------------------------------------------------------------
+// LatencyHistogram::Print
+// 	Print the non-empty buckets on one line, each as "<bound:count",
+//	the count of times below the bound and at or above the previous.
+//
+//	"unit" names the unit of the times.
+//----------------------------------------------------------------------
+
+void
+LatencyHistogram::Print(char *unit)
+{
+    printf("      %s:", unit);
+    for (int i = 0; i < NumLatencyBuckets; i++) {
+	if (buckets[i] == 0)
+	    continue;
+	if (i < NumLatencyBuckets - 1)
+	    printf(" <%lld:%d", (long long) 1 << i, buckets[i]);
+	else
+	    printf(" more:%d", buckets[i]);
+    }
+    printf("\n");
 }
@@ -12,6 +12,66 @@
 #define STATS_H
 
 #include "copyright.h"
+#include <stdio.h>
+
+#define NumSyscallTypes	64	// syscall codes counted one by one
+#define AccountNameLength	24	// thread names kept this long
+
+// The following class defines the statistics kept for each thread, so
+// we can tell which thread (and, adding up its threads, which user
+// process) is using the CPU, faulting, or waiting.  Statistics keeps
+// every thread's record on a list, so it outlives the thread and can
+// be printed at the end.
+
+class ThreadStatistics {
+  public:
+    ThreadStatistics(char *threadName);	// initialize everything to zero
+
+    char name[AccountNameLength];
+    int id;			// threads are numbered from 1, in the
+				// order they were created
+    int processID;		// user process, or -1 for a kernel thread
+    int64_t systemTicks;	// time spent executing system code
+    int64_t userTicks;		// time spent executing user code
+    int numSyscalls[NumSyscallTypes];	// syscalls made, by code
+    int numPageFaults;		// virtual memory page faults
+    int numTLBMisses;		// TLB misses
+    int numDiskReads;		// disk read requests
+    int numDiskWrites;		// disk write requests
+    int numContextSwitches;	// times switched to
+    int numLockWaits;		// Lock::Acquires that had to wait
+    int64_t lockWaitTicks;	// time spent waiting for Locks
+
+    ThreadStatistics *next;	// next thread on Statistics' list
+
+    void Add(ThreadStatistics *other);	// add in another's counters
+    int TotalSyscalls();
+    void Print(char *kind);	// print on one line
+    void Dump(FILE *file, char *kind);	// write as a line of CSV
+};
+
+// The following class defines a histogram of how long something took,
+// in buckets by powers of two: bucket 0 counts zeroes, and bucket i
+// counts times from 2^(i-1) up to 2^i, so a wide range of times fits
+// in a few buckets.  The last bucket takes everything too big for the
+// others.
+
+#define NumLatencyBuckets	40
+
+class LatencyHistogram {
+  public:
+    LatencyHistogram();		// initialize everything to zero
+
+    void Record(int64_t time);	// count one time
+    int64_t Percentile(int percent);	// upper bound of the bucket
+				// "percent" of the times are within
+    void Print(char *unit);	// print the non-empty buckets
+
+    int count;			// times recorded
+    int64_t total;		// their sum
+    int64_t longest;		// the longest of them
+    int buckets[NumLatencyBuckets];
+};
 
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
@@ -35,10 +95,36 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numSendInterrupts;	// network "sent" interrupts; each can
+				// cover several packets
+    int numStacksAllocated;	// thread stacks allocated from the host
+    int numStacksReused;	// thread stacks taken from the pool
+    int numContextSwitches;	// switches from one thread to another
+    int numLockWaits;		// Lock::Acquires that had to wait
+    int numLockHandoffs;	// Lock::Releases that handed the lock on
+    int numInversions;		// times a thread waited for a Lock held
+				// by a lower priority thread
+    int64_t inversionTicks;	// total time spent waiting like that
+    int64_t maxInversionTicks;	// longest such wait
+    int numTimerInterrupts;	// time slices ended by the timer
+    int numTimerStops;		// times an adaptive timer was stopped,
+				// for want of a thread to switch to
+    int numTLBMisses;		// TLB misses
+
+    ThreadStatistics *threads;	// every thread's statistics, oldest first
+    ThreadStatistics *lastThread;
+    int numThreads;		// how many are on the list
+    char *accountFile;		// where to write them as CSV, if anywhere
 
     Statistics(); 		// initialize everything to zero
 
+    ThreadStatistics *NewThread(char *threadName);
+				// start keeping statistics for a thread
     void Print();		// print collected statistics
+
+  private:
+    void PrintAccounts();	// print, and write, the per-thread and
+				// per-process statistics
 };
 
 // Constants used to reflect the relative time an operation would
@@ -34,6 +34,7 @@
 #include <signal.h>
 #include <errno.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/un.h>
 #include <sys/socket.h>
 #include <sys/mman.h>
@@ -80,6 +81,47 @@ PollFile(int fd)
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// WaitForFiles
+// 	Wait until at least one of the "numFds" open files or sockets in
+//	"fds" has something that can be read, or until "usec"
+//	microseconds have passed.  A negative "usec" means wait as long
+//	as it takes; 0 just checks.  One select covers all the files, so
+//	a Nachos with nothing to do costs the host nothing while it
+//	waits.
+//
+//	On return, "ready[i]" is TRUE if "fds[i]" can be read without
+//	waiting.  Returns the number of microseconds spent waiting.
+//----------------------------------------------------------------------
+
+int
+WaitForFiles(int *fds, bool *ready, int numFds, int usec)
+{
+    fd_set rfds;
+    struct timeval pollTime, start, end;
+    int i, maxFd = -1, retVal;
+
+    FD_ZERO(&rfds);
+    for (i = 0; i < numFds; i++) {
+	FD_SET(fds[i], &rfds);
+	if (fds[i] > maxFd)
+	    maxFd = fds[i];
+    }
+    pollTime.tv_sec = usec / 1000000;
+    pollTime.tv_usec = usec % 1000000;
+
+    gettimeofday(&start, NULL);
+    retVal = select(maxFd + 1, &rfds, NULL, NULL, 
+			(usec < 0) ? NULL : &pollTime);
+    gettimeofday(&end, NULL);
+
+    ASSERT((retVal >= 0) || (errno == EINTR));
+    for (i = 0; i < numFds; i++)
+	ready[i] = (retVal > 0) && FD_ISSET(fds[i], &rfds);
+    return (end.tv_sec - start.tv_sec) * 1000000 + 
+			(end.tv_usec - start.tv_usec);
+}
+
 //----------------------------------------------------------------------
 // OpenForWrite
 // 	Open a file for writing.  Create it if it doesn't exist; truncate it 
@@ -355,6 +397,36 @@ Delay(int seconds)
     (void) sleep((unsigned) seconds);
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the current wall-clock time on the host, in seconds, to
+//	the microsecond.  Only differences between two calls mean much.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+//----------------------------------------------------------------------
+// HostNanos
+// 	Return the host's monotonic clock, in nanoseconds.  HostTime is
+//	only good to the microsecond, too coarse for most syscalls.
+//----------------------------------------------------------------------
+
+int64_t
+HostNanos()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
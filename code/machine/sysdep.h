@@ -12,11 +12,16 @@
 #define SYSDEP_H
 
 #include "copyright.h"
+#include <stdint.h>
 
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
+// Wait (up to "usec" microseconds, or forever if negative) until any of
+// several files has something to read.  Returns the time spent waiting.
+extern int WaitForFiles(int *fds, bool *ready, int numFds, int usec);
+
 // File operations: open/read/write/lseek/close, and check for error
 // For simulating the disk and the console devices.
 extern int OpenForWrite(char *name);
@@ -43,6 +48,13 @@ extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 
+// Wall-clock time on the host, in seconds, for measuring real elapsed time
+extern double HostTime();
+
+// Time on the host's monotonic clock, in nanoseconds, for timing short
+// intervals
+extern int64_t HostNanos();
+
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(VoidNoArgFunctionPtr cleanUp);
 
@@ -39,15 +39,36 @@ static void TimerHandler(int arg)
 //      "callArg" is the parameter to be passed to the interrupt handler.
 //      "doRandom" -- if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
+//      "doAdapt" -- if true, fit the interval to the number of ready
+//		threads, and stop the timer while there are none.
 //----------------------------------------------------------------------
 
-Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom)
+Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom,
+		bool doAdapt)
 {
     randomize = doRandom;
+    adaptive = doAdapt;
     handler = timerHandler;
     arg = callArg; 
+    pending = FALSE;
 
     // schedule the first interrupt from the timer device
+    if (!adaptive || (scheduler->NumReady() > 0))
+	Start();
+}
+
+//----------------------------------------------------------------------
+// Timer::Start
+//      Schedule the next interrupt from the timer device, unless one
+//	is already on its way.
+//----------------------------------------------------------------------
+
+void
+Timer::Start()
+{
+    if (pending)
+	return;
+    pending = TRUE;
     interrupt->Schedule(TimerHandler, (int) this, TimeOfNextInterrupt(), 
 		TimerInt); 
 }
@@ -61,9 +82,14 @@ Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom)
 void 
 Timer::TimerExpired() 
 {
-    // schedule the next timer device interrupt
-    interrupt->Schedule(TimerHandler, (int) this, TimeOfNextInterrupt(), 
-		TimerInt);
+    // schedule the next timer device interrupt, unless nobody is
+    // waiting for the CPU
+    pending = FALSE;
+    stats->numTimerInterrupts++;
+    if (!adaptive || (scheduler->NumReady() > 0))
+	Start();
+    else
+	stats->numTimerStops++;
 
     // invoke the Nachos interrupt handler for this device
     (*handler)(arg);
@@ -72,14 +98,23 @@ Timer::TimerExpired()
 //----------------------------------------------------------------------
 // Timer::TimeOfNextInterrupt
 //      Return when the hardware timer device will next cause an interrupt.
-//	If randomize is turned on, make it a (pseudo-)random delay.
+//	If adaptive is turned on, the more threads are waiting to run,
+//	the sooner it comes.  If randomize is turned on, make it a
+//	(pseudo-)random delay around that.
 //----------------------------------------------------------------------
 
 int64_t 
 Timer::TimeOfNextInterrupt() 
 {
+    int64_t quantum = TimerTicks;
+
+    if (adaptive) {
+	quantum = MaxQuantum / max(scheduler->NumReady(), 1);
+	if (quantum < MinQuantum)
+	    quantum = MinQuantum;
+    }
     if (randomize)
-	return 1 + (Random() % (TimerTicks * 2));
+	return 1 + (Random() % (quantum * 2));
     else
-	return (int64_t)TimerTicks; 
+	return quantum; 
 }
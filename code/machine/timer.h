@@ -11,6 +11,13 @@
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
 //
+//	If "doAdapt" is set, the time slice shrinks as more threads wait
+//	on the ready list, and the timer stops altogether while none is
+//	waiting, since there is nobody to switch to; the scheduler starts
+//	it again when a thread becomes ready.  An idle machine then goes
+//	straight on to its next I/O interrupt, instead of stepping through
+//	timer interrupts that have nothing to do.
+//
 //  DO NOT CHANGE -- part of the machine emulation
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -23,14 +30,24 @@
 #include "copyright.h"
 #include "utility.h"
 
+// Bounds on the time slice of an adaptive timer: the longest, with
+// one thread waiting to run, and the shortest, with many.
+#define MaxQuantum	(TimerTicks * 4)
+#define MinQuantum	(TimerTicks / 4)
+
 // The following class defines a hardware timer. 
 class Timer {
   public:
-    Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom);
+    Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom,
+		bool doAdapt);
 				// Initialize the timer, to call the interrupt
 				// handler "timerHandler" every time slice.
     ~Timer() {}
 
+    void Start();		// make sure an interrupt is coming; for
+				// an adaptive timer, when a thread
+				// becomes ready
+
 // Internal routines to the timer emulation -- DO NOT call these
 
     void TimerExpired();	// called internally when the hardware
@@ -41,6 +58,8 @@ class Timer {
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
+    bool adaptive;		// set if the time slice follows the load
+    bool pending;		// set if an interrupt is scheduled
     VoidFunctionPtr handler;	// timer interrupt handler 
     int arg;			// argument to pass to interrupt handler
 
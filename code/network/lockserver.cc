@@ -0,0 +1,581 @@
+// lockserver.cc 
+//	Routines for the lock server, and for the client side of its
+//	protocol.
+//
+//	The server runs on the RPC layer: requests from different
+//	clients are handled by different worker threads, which take
+//	turns with the server's tables.  A request that has to block (an
+//	Acquire, or a Wait) isn't answered right away; its reply is sent
+//	when the lock is granted, by whichever worker grants it.
+//
+//	On the client, every user thread making a syscall makes its own
+//	call and sleeps until the reply comes, so one client can have
+//	many requests outstanding at once.  Requests that need no reply
+//	(SetMV) are Posted, and go out in the same message as the next
+//	request that does.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "lockserver.h"
+
+#define Deferred	(-2)		// reply will be sent later
+
+//----------------------------------------------------------------------
+// LockHandler
+// 	Dummy function because C++ can't indirectly invoke member
+//	functions.  It serves every LockOp.
+//----------------------------------------------------------------------
+
+static bool LockHandler(int arg, RpcRequest *req, RpcArgs *results)
+{ LockServer *s = (LockServer *) arg; return s->Handle(req, results); }
+
+//----------------------------------------------------------------------
+// LockServer::LockServer
+// 	Set up an empty lock server, listening on LockServerBox.
+//----------------------------------------------------------------------
+
+LockServer::LockServer()
+{
+    rpc = new RpcServer(LockServerBox, RpcWorkers);
+    for (int op = 0; op < NumLockOps; op++)
+	rpc->Register(op, LockHandler, (int) this);
+    lock = new Lock("lock server");
+    numRequests = 0;
+}
+
+//----------------------------------------------------------------------
+// LockServer::~LockServer
+//----------------------------------------------------------------------
+
+LockServer::~LockServer()
+{
+    delete rpc;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// LockServer::Run
+// 	Serve requests forever.
+//----------------------------------------------------------------------
+
+void
+LockServer::Run()
+{
+    printf("Lock server running on mail box %d\n", LockServerBox);
+    rpc->Run();
+}
+
+//----------------------------------------------------------------------
+// LockServer::Handle
+// 	Carry out one request, and return TRUE with its result in
+//	"results" -- unless the request blocks, in which case we return
+//	FALSE, and it is answered when it wakes up.
+//
+//	Called by the RPC server's worker threads.  The routines below
+//	are only called from here, with "lock" held.
+//----------------------------------------------------------------------
+
+bool
+LockServer::Handle(RpcRequest *req, RpcArgs *results)
+{
+    char name[MaxLockName + 1];
+    int lockId, cv, value, result;
+    ServerMV *mv;
+
+    if (!req->args.GetInt(&lockId) || !req->args.GetInt(&cv) ||
+		!req->args.GetInt(&value)) {
+	results->PutInt(-1);		// garbled
+	return TRUE;
+    }
+    if (!req->args.GetString(name, sizeof(name)))
+	name[0] = '\0';
+
+    lock->Acquire();
+    numRequests++;
+    DEBUG('n', "Lock server: op %d from (%d, thread %d), lock %d cv %d\n",
+		req->proc, req->machine, req->thread, lockId, cv);
+
+    switch (req->proc) {
+      case CreateLockOp:
+      case CreateCVOp:
+	result = Create(name, req->proc == CreateCVOp);
+	break;
+      case AcquireOp:
+	result = Acquire(req, lockId);
+	break;
+      case ReleaseOp:
+	result = Release(req->machine, req->thread, lockId);
+	break;
+      case DestroyLockOp:
+	result = -1;
+	if ((lockId >= 0) && (lockId < (int)locks.size()) &&
+		(locks[lockId] != NULL)) {
+	    ServerLock *l = locks[lockId];
+	    if (!l->busy && l->waiters->IsEmpty()) {
+		delete l->waiters;
+		delete l;
+		locks[lockId] = NULL;
+		result = 0;
+	    } else
+		l->toDelete = TRUE;
+	}
+	break;
+      case WaitOp:
+	result = Wait(req, cv, lockId);
+	break;
+      case SignalOp:
+      case BroadcastOp:
+	result = Signal(req->machine, req->thread, cv, lockId,
+			req->proc == BroadcastOp);
+	break;
+      case DestroyCVOp:
+	result = -1;
+	if ((cv >= 0) && (cv < (int)conditions.size()) &&
+		(conditions[cv] != NULL)) {
+	    ServerCV *c = conditions[cv];
+	    if (c->waiters->IsEmpty()) {
+		delete c->waiters;
+		delete c;
+		conditions[cv] = NULL;
+		result = 0;
+	    } else
+		c->toDelete = TRUE;
+	}
+	break;
+      case CreateMVOp:
+	result = CreateMV(name, value);
+	break;
+      case GetMVOp:
+	mv = FindMV(lockId, cv);
+	result = (mv == NULL) ? -1 : mv->values[cv];
+	break;
+      case SetMVOp:
+	mv = FindMV(lockId, cv);
+	result = -1;
+	if (mv != NULL)
+	    result = mv->values[cv] = value;
+	break;
+      case DestroyMVOp:
+	result = -1;
+	if (FindMV(lockId, 0) != NULL) {
+	    delete [] mvs[lockId]->values;
+	    delete mvs[lockId];
+	    mvs[lockId] = NULL;
+	    result = 0;
+	}
+	break;
+      default:
+	result = -1;
+	break;
+    }
+    lock->Release();
+
+    if (result == Deferred)
+	return FALSE;
+    results->PutInt(result);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// LockServer::Reply
+// 	Answer a request that had to wait, now that it has the lock.
+//----------------------------------------------------------------------
+
+void
+LockServer::Reply(LockWaiter *w)
+{
+    RpcArgs results;
+
+    results.PutInt(w->result);
+    rpc->Reply(w->machine, w->box, w->reqId, &results);
+}
+
+//----------------------------------------------------------------------
+// LockServer::Create
+// 	Return the index of the lock (or condition) called "name",
+//	creating it if it doesn't exist yet.  Sharing by name is what
+//	lets processes on different machines use the same lock.
+//----------------------------------------------------------------------
+
+int
+LockServer::Create(char *name, bool isCV)
+{
+    int i;
+
+    if (isCV) {
+	ServerCV *c;
+	for (i = 0; i < (int)conditions.size(); i++)
+	    if ((conditions[i] != NULL) && !conditions[i]->toDelete &&
+		    !strcmp(conditions[i]->name, name))
+		return i;
+	c = new ServerCV;
+	strcpy(c->name, name);
+	c->lock = -1;
+	c->waiters = new List;
+	c->toDelete = FALSE;
+	conditions.push_back(c);
+	return conditions.size() - 1;
+    }
+
+    ServerLock *l;
+    for (i = 0; i < (int)locks.size(); i++)
+	if ((locks[i] != NULL) && !locks[i]->toDelete &&
+		!strcmp(locks[i]->name, name))
+	    return i;
+    l = new ServerLock;
+    strcpy(l->name, name);
+    l->busy = FALSE;
+    l->waiters = new List;
+    l->toDelete = FALSE;
+    locks.push_back(l);
+    return locks.size() - 1;
+}
+
+//----------------------------------------------------------------------
+// LockServer::CreateMV
+// 	Return the index of the monitor variable called "name", creating
+//	it, with "size" elements all 0, if it doesn't exist yet.  An
+//	existing MV keeps the size it was created with.
+//----------------------------------------------------------------------
+
+int
+LockServer::CreateMV(char *name, int size)
+{
+    ServerMV *mv;
+    int i;
+
+    for (i = 0; i < (int)mvs.size(); i++)
+	if ((mvs[i] != NULL) && !strcmp(mvs[i]->name, name))
+	    return i;
+    if ((size <= 0) || (size > MaxMVSize))
+	return -1;
+    mv = new ServerMV;
+    strcpy(mv->name, name);
+    mv->size = size;
+    mv->values = new int[size];
+    for (i = 0; i < size; i++)
+	mv->values[i] = 0;
+    mvs.push_back(mv);
+    return mvs.size() - 1;
+}
+
+//----------------------------------------------------------------------
+// LockServer::FindMV
+// 	Return monitor variable "mv", if it exists and has an element
+//	"index"; otherwise NULL.
+//----------------------------------------------------------------------
+
+ServerMV *
+LockServer::FindMV(int mv, int index)
+{
+    if ((mv < 0) || (mv >= (int)mvs.size()) || (mvs[mv] == NULL) ||
+		(index < 0) || (index >= mvs[mv]->size))
+	return NULL;
+    return mvs[mv];
+}
+
+//----------------------------------------------------------------------
+// LockServer::Holds
+// 	Does "thread" on "from" hold lock "lockId"?
+//----------------------------------------------------------------------
+
+bool
+LockServer::Holds(NetworkAddress from, int thread, int lockId)
+{
+    return (lockId >= 0) && (lockId < (int)locks.size()) &&
+	    (locks[lockId] != NULL) && locks[lockId]->busy &&
+	    (locks[lockId]->ownerMachine == from) &&
+	    (locks[lockId]->ownerThread == thread);
+}
+
+//----------------------------------------------------------------------
+// LockServer::Acquire
+// 	Give "thread" the lock, or put it in line for it.  Like the
+//	kernel's Lock, acquiring a lock you already hold succeeds.
+//----------------------------------------------------------------------
+
+int
+LockServer::Acquire(RpcRequest *req, int lockId)
+{
+    ServerLock *l;
+    LockWaiter *w;
+
+    if ((lockId < 0) || (lockId >= (int)locks.size()) ||
+		(locks[lockId] == NULL) || locks[lockId]->toDelete)
+	return -1;
+    if (Holds(req->machine, req->thread, lockId))
+	return lockId;
+
+    l = locks[lockId];
+    w = new LockWaiter;
+    w->machine = req->machine;
+    w->box = req->box;
+    w->thread = req->thread;
+    w->reqId = req->reqId;
+    w->result = lockId;
+    l->waiters->Append((void *)w);
+    Grant(lockId);
+    return Deferred;
+}
+
+//----------------------------------------------------------------------
+// LockServer::Grant
+// 	If "lockId" is free, hand it to the first thread waiting for it,
+//	and queue the reply that thread has been waiting for.  A free
+//	lock that nobody wants and that has been destroyed goes away.
+//----------------------------------------------------------------------
+
+void
+LockServer::Grant(int lockId)
+{
+    ServerLock *l = locks[lockId];
+    LockWaiter *w;
+
+    if (l->busy)
+	return;
+    if (l->waiters->IsEmpty()) {
+	if (l->toDelete) {
+	    delete l->waiters;
+	    delete l;
+	    locks[lockId] = NULL;
+	}
+	return;
+    }
+    w = (LockWaiter *) l->waiters->Remove();
+    l->busy = TRUE;
+    l->ownerMachine = w->machine;
+    l->ownerThread = w->thread;
+    Reply(w);
+    delete w;
+}
+
+//----------------------------------------------------------------------
+// LockServer::Release
+// 	Release a lock held by "thread", and pass it on.
+//----------------------------------------------------------------------
+
+int
+LockServer::Release(NetworkAddress from, int thread, int lockId)
+{
+    if (!Holds(from, thread, lockId))
+	return -1;
+    locks[lockId]->busy = FALSE;
+    Grant(lockId);
+    return lockId;
+}
+
+//----------------------------------------------------------------------
+// LockServer::Wait
+// 	Release "lockId" and wait on condition "cv".  The reply is sent
+//	once the thread has been signalled and has the lock back.
+//----------------------------------------------------------------------
+
+int
+LockServer::Wait(RpcRequest *req, int cv, int lockId)
+{
+    ServerCV *c;
+    LockWaiter *w;
+
+    if ((cv < 0) || (cv >= (int)conditions.size()) ||
+		(conditions[cv] == NULL) || conditions[cv]->toDelete ||
+		!Holds(req->machine, req->thread, lockId))
+	return -1;
+    c = conditions[cv];
+    if (c->lock == -1)
+	c->lock = lockId;
+    else if (c->lock != lockId)
+	return -1;
+
+    w = new LockWaiter;
+    w->machine = req->machine;
+    w->box = req->box;
+    w->thread = req->thread;
+    w->reqId = req->reqId;
+    w->result = cv;
+    c->waiters->Append((void *)w);
+    Release(req->machine, req->thread, lockId);
+    return Deferred;
+}
+
+//----------------------------------------------------------------------
+// LockServer::Signal
+// 	Wake up one (or, if "all", every) thread waiting on "cv".  Woken
+//	threads line up for the lock; the signaller still holds it.
+//----------------------------------------------------------------------
+
+int
+LockServer::Signal(NetworkAddress from, int thread, int cv, int lockId,
+			bool all)
+{
+    ServerCV *c;
+
+    if ((cv < 0) || (cv >= (int)conditions.size()) ||
+		(conditions[cv] == NULL) || !Holds(from, thread, lockId))
+	return -1;
+    c = conditions[cv];
+    if (c->waiters->IsEmpty())
+	return cv;
+    if (c->lock != lockId)
+	return -1;
+
+    do {
+	locks[lockId]->waiters->Append(c->waiters->Remove());
+    } while (all && !c->waiters->IsEmpty());
+
+    if (c->toDelete && c->waiters->IsEmpty()) {
+	delete c->waiters;
+	delete c;
+	conditions[cv] = NULL;
+    }
+    return cv;
+}
+
+//----------------------------------------------------------------------
+// LockServer::Print
+// 	Print how much work the server has done.
+//----------------------------------------------------------------------
+
+void
+LockServer::Print()
+{
+    int i, held = 0;
+
+    for (i = 0; i < (int)locks.size(); i++)
+	if ((locks[i] != NULL) && locks[i]->busy)
+	    held++;
+    printf("Lock server: %d requests, %d locks (%d held), %d conditions, "
+		"%d MVs\n", numRequests, (int)locks.size(), held,
+		(int)conditions.size(), (int)mvs.size());
+    rpc->Print();
+}
+
+//----------------------------------------------------------------------
+// LockClient::LockClient
+// 	Get ready to send lock requests to the server on machine
+//	"server".
+//----------------------------------------------------------------------
+
+LockClient::LockClient(NetworkAddress server)
+{
+    rpc = new RpcClient(server, LockServerBox, LockClientBox);
+}
+
+//----------------------------------------------------------------------
+// LockClient::~LockClient
+//----------------------------------------------------------------------
+
+LockClient::~LockClient()
+{
+    delete rpc;
+}
+
+//----------------------------------------------------------------------
+// LockClient::Encode
+// 	Put a request's arguments in the order the server expects them.
+//	The name is only sent if there is one.
+//----------------------------------------------------------------------
+
+void
+LockClient::Encode(RpcArgs *args, int lock, int cv, int value, char *name)
+{
+    char buf[MaxLockName + 1];
+
+    args->PutInt(lock);
+    args->PutInt(cv);
+    args->PutInt(value);
+    if (name != NULL) {
+	strncpy(buf, name, MaxLockName);	// longer names are cut short
+	buf[MaxLockName] = '\0';
+	args->PutString(buf);
+    }
+}
+
+//----------------------------------------------------------------------
+// LockClient::Start
+// 	Queue a request to the server, on behalf of the current thread,
+//	and return a handle to Finish it with.  It is sent along with
+//	anything else queued when someone Finishes a request.
+//
+//	"op" -- a LockOp
+//	"lock", "cv" -- indices the request is about, if any
+//	"value" -- for CreateMVOp, the size of the MV
+//	"name" -- for the Create ops, the name; else NULL
+//----------------------------------------------------------------------
+
+int
+LockClient::Start(int op, int lock, int cv, int value, char *name)
+{
+    RpcArgs args;
+
+    Encode(&args, lock, cv, value, name);
+    return rpc->Start(op, &args);
+}
+
+//----------------------------------------------------------------------
+// LockClient::Finish
+// 	Send whatever is queued, wait for the reply to a request Started
+//	earlier, and return its result.
+//----------------------------------------------------------------------
+
+int
+LockClient::Finish(int call)
+{
+    RpcArgs results;
+
+    rpc->Finish(call, &results);
+    return results.GetIntOr(-1);
+}
+
+//----------------------------------------------------------------------
+// LockClient::Call
+// 	Send one request to the server, along with any requests queued
+//	before it, and wait for the reply.  Returns the reply's result.
+//----------------------------------------------------------------------
+
+int
+LockClient::Call(int op, int lock, int cv, int value, char *name)
+{
+    return Finish(Start(op, lock, cv, value, name));
+}
+
+//----------------------------------------------------------------------
+// LockClient::Post
+// 	Queue a request the caller doesn't need an answer to.  It is sent
+//	with the next Call (or Flush), or when the batch fills up.  The
+//	server handles it before anything this client asks for later.
+//----------------------------------------------------------------------
+
+void
+LockClient::Post(int op, int lock, int cv, int value)
+{
+    RpcArgs args;
+
+    Encode(&args, lock, cv, value, NULL);
+    rpc->Post(op, &args);
+}
+
+//----------------------------------------------------------------------
+// LockClient::Flush
+// 	Send any Posted requests that are still waiting.
+//----------------------------------------------------------------------
+
+void
+LockClient::Flush()
+{
+    rpc->Flush();
+}
+
+//----------------------------------------------------------------------
+// LockClient::Print
+// 	Print how many requests were sent, and in how many messages.
+//----------------------------------------------------------------------
+
+void
+LockClient::Print()
+{
+    rpc->Print();
+}
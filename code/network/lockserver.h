@@ -0,0 +1,151 @@
+// lockserver.h 
+//	Data structures for locks and condition variables shared by user
+//	programs running on different Nachos machines.
+//
+//	One Nachos runs a LockServer (nachos -server), which owns every
+//	lock and condition.  Other Nachos machines started with
+//	"-ls <server id>" create a LockClient, and their Lock and
+//	Condition syscalls turn into requests to the server.  Since the
+//	locks live on the server, processes on different machines (or
+//	different processes on one machine) share a lock just by
+//	creating it with the same name.
+//
+//	Requests and replies are remote procedure calls (see rpc.h), one
+//	procedure per LockOp.  Every request has the same arguments: the
+//	lock (or MV), the condition (or MV element), a value, and, for
+//	the Create ops, a name.  The result is a single int, what the
+//	syscall returns.  Replies to blocking requests (Acquire, Wait)
+//	are only sent when the lock is granted.
+//
+//	The server also keeps "monitor variables" (MVs): named arrays of
+//	ints that give processes on different machines shared state to
+//	protect with the shared locks.  A client doesn't wait for SetMV;
+//	it Posts it, and it goes out ahead of its next request, so an
+//	update is visible to others once the setter's next call (say,
+//	the Release of the lock protecting the MV) reaches the server.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef LOCKSERVER_H
+#define LOCKSERVER_H
+
+#include "rpc.h"
+#include "list.h"
+#include <vector>
+
+#define LockServerBox		3	// mail box of the server
+#define LockClientBox		4	// mail box of each client
+#define MaxLockName		32	// longest lock or condition name
+#define MaxMVSize		256	// most ints in one monitor variable
+
+enum LockOp { CreateLockOp, AcquireOp, ReleaseOp, DestroyLockOp,
+	      CreateCVOp, WaitOp, SignalOp, BroadcastOp, DestroyCVOp,
+	      CreateMVOp, GetMVOp, SetMVOp, DestroyMVOp, NumLockOps };
+
+// A thread, on some client, waiting for a lock or a condition.  A lock
+// is held by a thread on a machine; "thread" is the client's id for
+// it.  Ids aren't reused, so a thread that has died and another
+// created in its place can't be taken for each other.
+
+class LockWaiter {
+  public:
+    NetworkAddress machine;
+    MailBoxAddress box;
+    int thread;
+    int reqId;				// Request to answer once it's woken
+    int result;				// What to answer it with
+};
+
+class ServerLock {
+  public:
+    char name[MaxLockName + 1];
+    bool busy;
+    NetworkAddress ownerMachine;	// Who holds the lock
+    int ownerThread;
+    List *waiters;			// LockWaiters for Acquire (or for
+					// re-acquiring after a Wait)
+    bool toDelete;
+};
+
+class ServerCV {
+  public:
+    char name[MaxLockName + 1];
+    int lock;				// Lock used with it, or -1
+    List *waiters;			// LockWaiters in Wait
+    bool toDelete;
+};
+
+class ServerMV {
+  public:
+    char name[MaxLockName + 1];
+    int size;
+    int *values;
+};
+
+class LockServer {
+  public:
+    LockServer();
+    ~LockServer();
+
+    void Run();				// Serve requests forever
+    void Print();			// Print statistics
+
+    bool Handle(RpcRequest *req, RpcArgs *results);
+					// Carry out one request
+
+  private:
+    RpcServer *rpc;
+    Lock *lock;				// The worker threads take turns
+					// with everything below
+    vector<ServerLock*> locks;
+    vector<ServerCV*> conditions;
+    vector<ServerMV*> mvs;
+    int numRequests;
+
+    void Reply(LockWaiter *w);		// Answer a request that waited
+
+    int Create(char *name, bool isCV);
+    int CreateMV(char *name, int size);
+    ServerMV *FindMV(int mv, int index); // NULL unless "index" is in
+					// a valid MV
+    int Acquire(RpcRequest *req, int lockId);
+    int Release(NetworkAddress from, int thread, int lockId);
+    void Grant(int lockId);		// Give a free lock to its next waiter
+    int Wait(RpcRequest *req, int cv, int lockId);
+    int Signal(NetworkAddress from, int thread, int cv, int lockId,
+		bool all);
+    bool Holds(NetworkAddress from, int thread, int lockId);
+};
+
+// The client side: turns lock operations into calls to the server.
+
+class LockClient {
+  public:
+    LockClient(NetworkAddress server);
+    ~LockClient();
+
+    int Call(int op, int lock, int cv, int value, char *name);
+					// Send a request to the server, and
+					// wait for its reply
+    int Start(int op, int lock, int cv, int value, char *name);
+    int Finish(int call);		// The same, in two halves, so that
+					// independent requests can be sent
+					// together; Start returns a handle
+					// for Finish
+    void Post(int op, int lock, int cv, int value);
+					// Queue a request that needs no
+					// reply, to go with the next Call
+    void Flush();			// Send queued requests now
+    void Print();			// Print statistics
+
+  private:
+    RpcClient *rpc;
+
+    void Encode(RpcArgs *args, int lock, int cv, int value, char *name);
+};
+
+#endif // LOCKSERVER_H
@@ -0,0 +1,42 @@
+#!/bin/sh
+# netbench.sh
+#	Run the Nachos network benchmark (nachos -nb) over a range of
+#	configurations.  For each one, start a ring of Nachos processes
+#	on this host, machine ID's 0 through nodes-1, wait for all of
+#	them to finish, and print what each one reports.
+#
+#	Run from the directory holding the nachos built with NETWORK.
+#	The lists below can be overridden from the environment, e.g.
+#		NODES="2 4" SIZES=100 WINDOWS="4 8" LOSS="1 .9" ./netbench.sh
+#
+# Copyright (c) 1992-1993 The Regents of the University of California.
+# All rights reserved.  See copyright.h for copyright notice and limitation
+# of liability and disclaimer of warranty provisions.
+
+NODES=${NODES:-"2 4"}
+SIZES=${SIZES:-"32 300 1000"}
+WINDOWS=${WINDOWS:-"1 8 32"}
+LOSS=${LOSS:-"1 .95"}		# network reliability, as for -l
+
+for nodes in $NODES; do
+  for size in $SIZES; do
+    for window in $WINDOWS; do
+      for rely in $LOSS; do
+	echo "=== nodes $nodes size $size window $window reliability $rely"
+	id=0
+	while [ $id -lt $nodes ]; do
+	  ./nachos -m $id -l $rely -nb $nodes $size $window \
+		> netbench.$id.out 2>&1 &
+	  id=`expr $id + 1`
+	done
+	wait
+	id=0
+	while [ $id -lt $nodes ]; do
+	  grep -e "^NetBench" -e "^Transport" netbench.$id.out
+	  rm -f netbench.$id.out
+	  id=`expr $id + 1`
+	done
+      done
+    done
+  done
+done
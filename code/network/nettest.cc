@@ -22,6 +22,7 @@
 #include "network.h"
 #include "post.h"
 #include "interrupt.h"
+#include "transport.h"
 
 // Test out message delivery, by doing the following:
 //	1. send a message to the machine with ID "farAddr", at mail box #0
@@ -80,3 +81,323 @@ MailTest(int farAddr)
     // Then we're done!
     interrupt->Halt();
 }
+
+// Test out the reliable transport, by doing the following (both
+// machines do the same thing, over a Transport on mail box #2):
+//	1. send TransportTestMessages messages of TransportTestSize bytes
+//	    to the machine with ID "farAddr"
+//	2. receive as many from it, checking that each arrived intact
+//	    and in order
+//	3. wait for all of our messages to be acknowledged, then hang
+//	    around a while, in case the other machine didn't get our acks
+//
+// Run with a reliability below 1 (-l) to see retransmission at work.
+
+#define TransportTestBox	2
+#define TransportTestMessages	10
+#define TransportTestSize	300
+
+static Semaphore *lingerDone;
+static void LingerDone(int arg) { lingerDone->V(); }
+
+void
+TransportTest(int farAddr)
+{
+    Transport *transport = new Transport(TransportTestBox, WindowSize);
+    char *out = new char[TransportTestSize];
+    char *in = new char[TransportTestSize];
+    NetworkAddress from;
+    MailBoxAddress fromBox;
+    int64_t start = stats->totalTicks;
+    int i, j, length, errors = 0;
+
+    for (i = 0; i < TransportTestMessages; i++) {
+	for (j = 0; j < TransportTestSize; j++)
+	    out[j] = (char)(i + j);
+	transport->Send(farAddr, TransportTestBox, out, TransportTestSize);
+    }
+
+    for (i = 0; i < TransportTestMessages; i++) {
+	length = transport->Receive(&from, &fromBox, in, TransportTestSize);
+	if (length != TransportTestSize)
+	    errors++;
+	else
+	    for (j = 0; j < TransportTestSize; j++)
+		if (in[j] != (char)(i + j)) {
+		    errors++;
+		    break;
+		}
+    }
+    transport->Flush();
+
+    printf("Transport test: %d messages each way, %d bad, %d ticks\n",
+	    TransportTestMessages, errors, (int)(stats->totalTicks - start));
+    printf("Transport test: goodput %d bytes per 1000 ticks\n",
+	    (int)((int64_t)TransportTestMessages * TransportTestSize * 1000 /
+		(stats->totalTicks - start)));
+    transport->Print();
+    postOffice->Print();
+    fflush(stdout);
+
+    lingerDone = new Semaphore("transport linger", 0);
+    interrupt->Schedule(LingerDone, 0, 4 * RetransmitTimeout(WindowSize),
+			NetworkTimerInt);
+    lingerDone->P();
+    interrupt->Halt();
+}
+
+// Measure the lock server, by having "numThreads" threads each do
+// MVBenchOps critical sections of the form
+//	AcquireLock; GetMV; SetMV(+1); ReleaseLock
+// on a shared counter.  Each section is two round trips to the
+// server: nobody waits for the SetMV or the Release, so they ride along
+// with the next Acquire.  Run it on several
+// machines at once against one server to see how it holds up:
+//	./nachos -m 0 -server &
+//	./nachos -m 1 -ls 0 -mvb 4 &
+//	./nachos -m 2 -ls 0 -mvb 4 &
+// The last machine to finish should see the counter at the total
+// number of sections run everywhere.
+
+#define MVBenchOps		50
+
+static Semaphore *benchDone;
+static int benchLock, benchMV;
+static int64_t benchTotal, benchMax;
+
+static void
+MVBenchThread(int arg)
+{
+    int64_t start, latency;
+    int i, value;
+
+    for (i = 0; i < MVBenchOps; i++) {
+	start = stats->totalTicks;
+	lockClient->Call(AcquireOp, benchLock, -1, 0, NULL);
+	value = lockClient->Call(GetMVOp, benchMV, 0, 0, NULL);
+	lockClient->Post(SetMVOp, benchMV, 0, value + 1);
+	lockClient->Post(ReleaseOp, benchLock, -1, 0);
+	latency = stats->totalTicks - start;
+	benchTotal += latency;
+	if (latency > benchMax)
+	    benchMax = latency;
+    }
+    lockClient->Flush();		// others may be waiting for our
+					// last Release
+    benchDone->V();
+}
+
+void
+MVBenchmark(int numThreads)
+{
+    Thread *t;
+    int64_t start;
+    int i, ops = numThreads * MVBenchOps;
+
+    if (lockClient == NULL) {
+	printf("MV benchmark: no lock server, start Nachos with -ls\n");
+	return;
+    }
+    benchDone = new Semaphore("mv bench done", 0);
+    benchLock = lockClient->Start(CreateLockOp, -1, -1, 0, "mv bench lock");
+    benchMV = lockClient->Start(CreateMVOp, -1, -1, 1, "mv bench counter");
+    benchLock = lockClient->Finish(benchLock);	// both go in one message
+    benchMV = lockClient->Finish(benchMV);
+    benchTotal = benchMax = 0;
+
+    start = stats->totalTicks;
+    for (i = 0; i < numThreads; i++) {
+	t = new Thread("mv bench");
+	t->Fork(MVBenchThread, 0);
+    }
+    for (i = 0; i < numThreads; i++)
+	benchDone->P();
+    start = stats->totalTicks - start;
+
+    printf("MV benchmark: %d threads, %d critical sections in %d ticks\n",
+	    numThreads, ops, (int)start);
+    printf("MV benchmark: %d remote ops per 1000 ticks, latency per "
+	    "section avg %d max %d ticks\n", (int)(4 * ops * 1000 / start),
+	    (int)(benchTotal / ops), (int)benchMax);
+    printf("MV benchmark: counter is now %d\n",
+	    lockClient->Call(GetMVOp, benchMV, 0, 0, NULL));
+    lockClient->Print();
+    fflush(stdout);
+
+    lingerDone = new Semaphore("transport linger", 0);
+    interrupt->Schedule(LingerDone, 0, 4 * RetransmitTimeout(WindowSize),
+			NetworkTimerInt);
+    lingerDone->P();
+    interrupt->Halt();
+}
+
+// Benchmark the network, with "numNodes" copies of Nachos, machine ID's
+// 0 through numNodes-1, each running
+//	./nachos -m <id> -l <reliability> -nb <numNodes> <size> <window>
+// (netbench.sh starts them).  The nodes form a ring: each one sends
+// NetBenchMessages requests of "size" bytes to the next one, over a
+// Transport with the given window, and the next one echoes them back.
+// NetBenchInFlight requests are kept outstanding at once.
+//
+// Each request carries the time it was sent, in ticks and in host
+// time, so the sender can time the round trip when the echo comes
+// back without the nodes' clocks having to agree.  Each node prints
+// the latency percentiles of its own requests, its goodput (request
+// bytes echoed per unit of time), and the fraction of the fragments
+// its Transport sent that were retransmissions.
+//
+// Each node has at most NetBenchInFlight requests from its neighbor and
+// as many echoes of its own waiting at once, well within the
+// Transport's ReceiveQueueSize, so two nodes blocked sending to each
+// other always have room to take what the other is sending.
+
+#define NetBenchBox		5
+#define NetBenchMessages	200
+#define NetBenchInFlight	4
+
+enum NetBenchType { NetBenchRequest, NetBenchEcho, NetBenchDone };
+
+class NetBenchHeader {
+  public:
+    int type;			// NetBenchType
+    int seq;
+    int64_t sentTicks;		// When the request was sent
+    double sentHost;
+};
+
+static Transport *benchTransport;
+static Semaphore *benchSlots;		// Requests we may still send
+static Semaphore *benchEchoed;		// V'ed when our last echo is back
+static Semaphore *benchReleased;	// V'ed when our neighbor is done
+					// with us
+static double *benchTicks, *benchHost;	// Round trip of each request
+static int benchReplies;
+
+// Sort "n" doubles into increasing order.
+static void
+SortTimes(double *times, int n)
+{
+    double t;
+    int i, j;
+
+    for (i = 1; i < n; i++) {
+	t = times[i];
+	for (j = i; (j > 0) && (times[j - 1] > t); j--)
+	    times[j] = times[j - 1];
+	times[j] = t;
+    }
+}
+
+// Return the "pct"th percentile of "n" sorted times.
+static double
+Percentile(double *times, int n, int pct)
+{
+    return times[min(n - 1, n * pct / 100)];
+}
+
+// Body of the thread that takes every message out of the benchmark's
+// Transport: requests are echoed back, echoes are timed.
+static void
+NetBenchServer(int arg)
+{
+    char *buffer = new char[MaxMessageSize];
+    NetBenchHeader *hdr = (NetBenchHeader *)buffer;
+    NetworkAddress from;
+    MailBoxAddress fromBox;
+    int length;
+
+    for (;;) {
+	length = benchTransport->Receive(&from, &fromBox, buffer,
+			MaxMessageSize);
+	switch (hdr->type) {
+	  case NetBenchRequest:
+	    hdr->type = NetBenchEcho;
+	    benchTransport->Send(from, fromBox, buffer, length);
+	    break;
+	  case NetBenchEcho:
+	    benchTicks[benchReplies] = stats->totalTicks - hdr->sentTicks;
+	    benchHost[benchReplies] = HostTime() - hdr->sentHost;
+	    if (++benchReplies == NetBenchMessages)
+		benchEchoed->V();
+	    benchSlots->V();
+	    break;
+	  case NetBenchDone:
+	    benchReleased->V();
+	    break;
+	}
+    }
+}
+
+void
+NetBenchmark(int numNodes, int size, int window)
+{
+    char *buffer;
+    NetBenchHeader *hdr;
+    NetworkAddress me = postOffice->Address();
+    NetworkAddress next = (me + 1) % numNodes;
+    int64_t startTicks, ticks;
+    double startHost, host;
+    int i, sent, retransmits;
+
+    ASSERT((numNodes > 1) && (me < numNodes));
+    ASSERT((size >= (int)sizeof(NetBenchHeader)) && (size <= MaxMessageSize));
+    benchTransport = new Transport(NetBenchBox, window);
+    benchSlots = new Semaphore("net bench slots", NetBenchInFlight);
+    benchEchoed = new Semaphore("net bench echoed", 0);
+    benchReleased = new Semaphore("net bench released", 0);
+    benchTicks = new double[NetBenchMessages];
+    benchHost = new double[NetBenchMessages];
+    benchReplies = 0;
+    (new Thread("net bench server"))->Fork(NetBenchServer, 0);
+
+    buffer = new char[size];
+    memset(buffer, 0, size);
+    hdr = (NetBenchHeader *)buffer;
+    startTicks = stats->totalTicks;
+    startHost = HostTime();
+    for (i = 0; i < NetBenchMessages; i++) {
+	benchSlots->P();
+	hdr->type = NetBenchRequest;
+	hdr->seq = i;
+	hdr->sentTicks = stats->totalTicks;
+	hdr->sentHost = HostTime();
+	benchTransport->Send(next, NetBenchBox, buffer, size);
+    }
+    benchEchoed->P();			// all of our echoes are back
+    ticks = stats->totalTicks - startTicks;
+    host = HostTime() - startHost;
+    hdr->type = NetBenchDone;
+    benchTransport->Send(next, NetBenchBox, buffer, sizeof(NetBenchHeader));
+    benchReleased->P();			// our neighbor is done with us
+    benchTransport->Flush();
+
+    SortTimes(benchTicks, NetBenchMessages);
+    SortTimes(benchHost, NetBenchMessages);
+    sent = benchTransport->FragmentsSent();
+    retransmits = benchTransport->Retransmits();
+    printf("NetBench: node %d of %d, %d messages of %d bytes, window %d\n",
+	    me, numNodes, NetBenchMessages, size, window);
+    printf("NetBench: latency ticks p50 %d p90 %d p99 %d max %d\n",
+	    (int)Percentile(benchTicks, NetBenchMessages, 50),
+	    (int)Percentile(benchTicks, NetBenchMessages, 90),
+	    (int)Percentile(benchTicks, NetBenchMessages, 99),
+	    (int)benchTicks[NetBenchMessages - 1]);
+    printf("NetBench: latency host usec p50 %d p90 %d p99 %d max %d\n",
+	    (int)(Percentile(benchHost, NetBenchMessages, 50) * 1000000),
+	    (int)(Percentile(benchHost, NetBenchMessages, 90) * 1000000),
+	    (int)(Percentile(benchHost, NetBenchMessages, 99) * 1000000),
+	    (int)(benchHost[NetBenchMessages - 1] * 1000000));
+    printf("NetBench: goodput %d bytes per 1000 ticks, %d bytes per host "
+	    "second\n", (int)((int64_t)NetBenchMessages * size * 1000 / ticks),
+	    (int)(NetBenchMessages * size / host));
+    printf("NetBench: %d fragments sent, %d retransmitted (ratio %.4f)\n",
+	    sent, retransmits, (sent > 0) ? (double)retransmits / sent : 0.0);
+    benchTransport->Print();
+    fflush(stdout);
+
+    lingerDone = new Semaphore("transport linger", 0);
+    interrupt->Schedule(LingerDone, 0, 4 * RetransmitTimeout(window),
+			NetworkTimerInt);
+    lingerDone->P();
+    interrupt->Halt();
+}
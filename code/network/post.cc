@@ -17,6 +17,7 @@
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "system.h"
 #include "post.h"
 
 extern "C" {
@@ -40,6 +41,88 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
     pktHdr = pktH;
     mailHdr = mailH;
     bcopy(msgData, data, mailHdr.length);
+    refCount = 1;
+    next = NULL;
+}
+
+Mail *Mail::freeList = NULL;
+
+//----------------------------------------------------------------------
+// Mail::Mail
+//      Initialize an empty Mail, to be filled in straight from the
+//	network.
+//----------------------------------------------------------------------
+
+Mail::Mail()
+{
+    // The network copies MailHeader and data in one piece
+    ASSERT(data == (char *)&mailHdr + sizeof(MailHeader));
+    refCount = 0;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// Mail::Alloc
+//      Take a Mail from the pool, allocating MailPoolSize of them the
+//	first time, and another one whenever the pool runs dry.  The
+//	pool only grows; Mail never goes back to the heap.
+//
+//	Interrupts are turned off only to keep the free list consistent.
+//----------------------------------------------------------------------
+
+Mail *
+Mail::Alloc()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Mail *mail;
+
+    if (freeList == NULL) {
+	Mail *arena = new Mail[MailPoolSize];
+	for (int i = 0; i < MailPoolSize; i++) {
+	    arena[i].next = freeList;
+	    freeList = &arena[i];
+	}
+    }
+    mail = freeList;
+    freeList = mail->next;
+    mail->refCount = 1;
+    (void) interrupt->SetLevel(oldLevel);
+    return mail;
+}
+
+//----------------------------------------------------------------------
+// Mail::Hold
+//      Add a reference to the Mail, for instance to keep its data
+//	around after handing it to someone else.
+//----------------------------------------------------------------------
+
+void
+Mail::Hold()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(refCount > 0);
+    refCount++;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Mail::Release
+//      Drop a reference to the Mail.  When the last reference goes, the
+//	Mail is returned to the pool.
+//----------------------------------------------------------------------
+
+void
+Mail::Release()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(refCount > 0);
+    if (--refCount == 0) {
+	next = freeList;
+	freeList = this;
+    }
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -47,13 +130,16 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 //      Initialize a single mail box within the post office, so that it
 //	can receive incoming messages.
 //
-//	Just initialize a list of messages, representing the mailbox.
+//	Just initialize a ring of messages, representing the mailbox.
 //----------------------------------------------------------------------
 
 
 MailBox::MailBox()
 { 
-    messages = new SynchList(); 
+    messages = new SynchRing("mailbox", MailBoxCapacity); 
+    capacity = MailBoxCapacity;
+    maxQueued = 0;
+    numDelivered = numDropped = 0;
 }
 
 //----------------------------------------------------------------------
@@ -66,9 +152,42 @@ MailBox::MailBox()
 
 MailBox::~MailBox()
 { 
+    while (messages->Count() > 0)
+	((Mail *) messages->Remove())->Release();
     delete messages; 
 }
 
+//----------------------------------------------------------------------
+// MailBox::SetCapacity
+// 	Change how many messages the box can hold.  Mail already in the
+//	box is moved to the new ring; whatever doesn't fit is dropped.
+//
+//	Nobody may be waiting to get mail out of the box.  Interrupts
+//	are turned off so the postal worker can't put mail in meanwhile.
+//
+//	"n" -- the new capacity
+//----------------------------------------------------------------------
+
+void
+MailBox::SetCapacity(int n)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    SynchRing *old = messages;
+
+    messages = new SynchRing("mailbox", n);
+    capacity = n;
+    while (old->Count() > 0) {
+	Mail *mail = (Mail *) old->Remove();
+
+	if (!messages->Append((void *)mail)) {
+	    numDropped++;
+	    mail->Release();
+	}
+    }
+    delete old;
+    (void) interrupt->SetLevel(oldLevel);
+}
+
 //----------------------------------------------------------------------
 // PrintHeader
 // 	Print the message header -- the destination machine ID and mailbox
@@ -90,22 +209,26 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 // 	Add a message to the mailbox.  If anyone is waiting for message
 //	arrival, wake them up!
 //
-//	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	The Mail is queued as is, without copying.  If the box is already
+//	full, the message is dropped instead, and we return FALSE.
 //
-//	"pktHdr" -- source, destination machine ID's
-//	"mailHdr" -- source, destination mailbox ID's
-//	"data" -- payload message data
+//	"mail" -- the message, with its headers
 //----------------------------------------------------------------------
 
-void 
-MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
+bool 
+MailBox::Put(Mail *mail)
 { 
-    Mail *mail = new Mail(pktHdr, mailHdr, data); 
-
-    messages->Append((void *)mail);	// put on the end of the list of 
-					// arrived messages, and wake up 
-					// any waiters
+    if (!messages->Append((void *)mail)) {	// put on the end of the
+						// ring of arrived messages,
+						// and wake up any waiter
+	numDropped++;			// full
+	mail->Release();
+	return FALSE;
+    }
+    numDelivered++;
+    if (messages->Count() > maxQueued)
+	maxQueued = messages->Count();
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -124,8 +247,8 @@ void
 MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
 { 
     DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = (Mail *) messages->Remove();	// remove message from list;
-						// will wait if list is empty
+    Mail *mail = (Mail *) messages->Remove();	// remove message from ring;
+						// will wait if ring is empty
 
     *pktHdr = mail->pktHdr;
     *mailHdr = mail->mailHdr;
@@ -136,10 +259,50 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data)
     bcopy(mail->data, data, mail->mailHdr.length);
 					// copy the message data into
 					// the caller's buffer
-    delete mail;			// we've copied out the stuff we
+    mail->Release();			// we've copied out the stuff we
 					// need, we can now discard the message
 }
 
+//----------------------------------------------------------------------
+// MailBox::Get
+// 	Get a message from a mailbox, without copying it.  The calling
+//	thread waits if there are no messages in the mailbox.
+//
+//	Returns the Mail; the caller must Release it when done with it.
+//----------------------------------------------------------------------
+
+Mail *
+MailBox::Get() 
+{ 
+    DEBUG('n', "Waiting for mail in mailbox\n");
+    Mail *mail = (Mail *) messages->Remove();
+
+    if (DebugIsEnabled('n')) {
+	printf("Got mail from mailbox: ");
+	PrintHeader(mail->pktHdr, mail->mailHdr);
+    }
+    return mail;
+}
+
+//----------------------------------------------------------------------
+// MailBox::Print
+// 	Print how much mail has gone through the box, and how much was
+//	dropped because the box was full.  Boxes that were never used
+//	are skipped.
+//
+//	"box" -- which box this is, for the printout
+//----------------------------------------------------------------------
+
+void
+MailBox::Print(int box)
+{
+    if ((numDelivered == 0) && (numDropped == 0))
+	return;
+    printf("Mailbox %d: %d delivered, %d dropped (full), %d queued, "
+		"at most %d of %d\n", box, numDelivered, numDropped,
+		messages->Count(), maxQueued, capacity);
+}
+
 //----------------------------------------------------------------------
 // PostalHelper, ReadAvail, WriteDone
 // 	Dummy functions because C++ can't indirectly invoke member functions
@@ -173,23 +336,26 @@ static void WriteDone(int arg)
 //	  drops any packets; reliability = 0 means the network never
 //	  delivers any packets)
 //	"nBoxes" is the number of mail boxes in this Post Office
+//	"txDepth" is how many packets the network can be sending at once
 //----------------------------------------------------------------------
 
-PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
+PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes,
+			int txDepth)
 {
-// First, initialize the synchronization with the interrupt handlers
+// First, initialize the network; tell it which interrupt handlers to call
+    network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this,
+			txDepth);
+
+// Second, initialize the synchronization with the interrupt handlers
     messageAvailable = new Semaphore("message available", 0);
-    messageSent = new Semaphore("message sent", 0);
+    messageSent = new Semaphore("message sent", network->TxDepth());
     sendLock = new Lock("message send lock");
 
-// Second, initialize the mailboxes
+// Third, initialize the mailboxes
     netAddr = addr; 
     numBoxes = nBoxes;
     boxes = new MailBox[nBoxes];
 
-// Third, initialize the network; tell it which interrupt handlers to call
-    network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this);
-
 
 // Finally, create a thread whose sole job is to wait for incoming messages,
 //   and put them in the right mailbox. 
@@ -218,53 +384,63 @@ PostOffice::~PostOffice()
 //
 //      Incoming messages have had the PacketHeader stripped off,
 //	but the MailHeader is still tacked on the front of the data.
+//	The network copies each one straight into a Mail from the pool,
+//	which is then queued in the mailbox as is -- this is the only
+//	copy made of the packet on its way to the receiver.
 //----------------------------------------------------------------------
 
 void
 PostOffice::PostalDelivery()
 {
-    PacketHeader pktHdr;
-    MailHeader mailHdr;
-    char *buffer = new char[MaxPacketSize];
+    Mail *mail;
+    int box;
 
     for (;;) {
         // first, wait for a message
         messageAvailable->P();	
-        pktHdr = network->Receive(buffer);
+	mail = Mail::Alloc();
+        mail->pktHdr = network->Receive((char *)&mail->mailHdr);
 
-        mailHdr = *(MailHeader *)buffer;
         if (DebugIsEnabled('n')) {
 	    printf("Putting mail into mailbox: ");
-	    PrintHeader(pktHdr, mailHdr);
+	    PrintHeader(mail->pktHdr, mail->mailHdr);
         }
 
 	// check that arriving message is legal!
-	ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
-	ASSERT(mailHdr.length <= MaxMailSize);
-
-	// put into mailbox
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
+	ASSERT(0 <= mail->mailHdr.to && mail->mailHdr.to < numBoxes);
+	ASSERT(mail->mailHdr.length <= MaxMailSize);
+
+	// put into mailbox; if it is full, the mail is dropped -- we
+	// can't wait for room, or one slow receiver would hold up the
+	// mail for every other box
+	box = mail->mailHdr.to;
+        if (!boxes[box].Put(mail))
+	    DEBUG('n', "Mailbox %d full, dropping mail\n", box);
     }
 }
 
 //----------------------------------------------------------------------
-// PostOffice::Send
+// PostOffice::Transmit
 // 	Concatenate the MailHeader to the front of the data, and pass 
 //	the result to the Network for delivery to the destination machine.
+//	If the network's transmit queue is full, wait for a slot.  We
+//	don't wait for the packet to be sent.
 //
 //	Note that the MailHeader + data looks just like normal payload
 //	data to the Network.
 //
+//	Assumes "sendLock" is held.
+//
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
 //	"data" -- payload message data
 //----------------------------------------------------------------------
 
 bool
-PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
+PostOffice::Transmit(PacketHeader pktHdr, MailHeader mailHdr, char* data)
 {
-    char* buffer = new char[MaxPacketSize];	// space to hold concatenated
-						// mailHdr + data
+    char buffer[MaxPacketSize];		// space to hold concatenated
+					// mailHdr + data
 
     if (DebugIsEnabled('n')) {
 	printf("Post send: ");
@@ -282,15 +458,56 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
     bcopy((char *) &mailHdr, buffer, sizeof(MailHeader));
     bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
 
-    sendLock->Acquire();   		// only one message can be sent
-					// to the network at any one time
-    bool success = network->Send(pktHdr, buffer);
-    messageSent->P();			// wait for interrupt to tell us
-					// ok to send the next message
+    messageSent->P();			// wait for room in the transmit
+					// queue
+    return network->Send(pktHdr, buffer);
+}
+
+//----------------------------------------------------------------------
+// PostOffice::Send
+// 	Send a message to a mailbox on a remote machine.  Returns once
+//	the network has taken the message, which may be before it has
+//	gone out on the wire.
+//
+//	"pktHdr" -- source, destination machine ID's
+//	"mailHdr" -- source, destination mailbox ID's
+//	"data" -- payload message data
+//----------------------------------------------------------------------
+
+bool
+PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
+{
+    sendLock->Acquire();   		// keep other senders from cutting
+					// into a batch
+    bool success = Transmit(pktHdr, mailHdr, data);
     sendLock->Release();
+    return success;
+}
 
-    delete [] buffer;			// we've sent the message, so
-					// we can delete our buffer
+//----------------------------------------------------------------------
+// PostOffice::SendBatch
+// 	Send several messages, back to back.  They go into the network's
+//	transmit queue together, so that sending them costs about one
+//	"sent" interrupt rather than one per message.
+//
+//	Returns FALSE if any of the messages couldn't be sent.
+//
+//	"count" -- how many messages
+//	"pktHdrs", "mailHdrs", "data" -- arrays of "count" headers and
+//		payloads, as for Send
+//----------------------------------------------------------------------
+
+bool
+PostOffice::SendBatch(int count, PacketHeader *pktHdrs, MailHeader *mailHdrs,
+			char **data)
+{
+    bool success = TRUE;
+
+    sendLock->Acquire();
+    for (int i = 0; i < count; i++)
+	if (!Transmit(pktHdrs[i], mailHdrs[i], data[i]))
+	    success = FALSE;
+    sendLock->Release();
     return success;
 }
 
@@ -319,6 +536,66 @@ PostOffice::Receive(int box, PacketHeader *pktHdr,
     ASSERT(mailHdr->length <= MaxMailSize);
 }
 
+//----------------------------------------------------------------------
+// PostOffice::Receive
+// 	Retrieve a message from a specific box, waiting for one to arrive
+//	if need be, and lend it to the caller rather than copying it.
+//
+//	Returns the Mail; the caller must Release it when done with it.
+//
+//	"box" -- mailbox ID in which to look for message
+//----------------------------------------------------------------------
+
+Mail *
+PostOffice::Receive(int box)
+{
+    ASSERT((box >= 0) && (box < numBoxes));
+
+    return boxes[box].Get();
+}
+
+//----------------------------------------------------------------------
+// PostOffice::SetCapacity
+// 	Change how many messages a mailbox can hold before mail to it is
+//	dropped.  Mail already in the box stays there, as much as fits.
+//
+//	"box" -- mailbox ID
+//	"n" -- its new capacity
+//----------------------------------------------------------------------
+
+void
+PostOffice::SetCapacity(int box, int n)
+{
+    ASSERT((box >= 0) && (box < numBoxes) && (n > 0));
+
+    boxes[box].SetCapacity(n);
+}
+
+//----------------------------------------------------------------------
+// PostOffice::FreeSpace
+// 	Return how many more messages "box" can take before it is full.
+//----------------------------------------------------------------------
+
+int
+PostOffice::FreeSpace(int box)
+{
+    ASSERT((box >= 0) && (box < numBoxes));
+
+    return boxes[box].FreeSpace();
+}
+
+//----------------------------------------------------------------------
+// PostOffice::Print
+// 	Print the counters of every mailbox that has seen any mail.
+//----------------------------------------------------------------------
+
+void
+PostOffice::Print()
+{
+    for (int i = 0; i < numBoxes; i++)
+	boxes[i].Print(i);
+}
+
 //----------------------------------------------------------------------
 // PostOffice::IncomingPacket
 // 	Interrupt handler, called when a packet arrives from the network.
@@ -334,8 +611,9 @@ PostOffice::IncomingPacket()
 
 //----------------------------------------------------------------------
 // PostOffice::PacketSent
-// 	Interrupt handler, called when the next packet can be put onto the 
-//	network.
+// 	Interrupt handler, called when packets have been put onto the 
+//	network.  Each one frees a slot in the transmit queue; one
+//	interrupt can cover several packets.
 //
 //	The name of this routine is a misnomer; if "reliability < 1",
 //	the packet could have been dropped by the network, so it won't get
@@ -345,6 +623,7 @@ PostOffice::IncomingPacket()
 void 
 PostOffice::PacketSent()
 { 
-    messageSent->V();
+    for (int n = network->SendsCompleted(); n > 0; n--)
+	messageSent->V();		// a slot for each packet sent
 }
 
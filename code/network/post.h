@@ -29,7 +29,7 @@
 #define POST_H
 
 #include "network.h"
-#include "synchlist.h"
+#include "synchring.h"
 
 // Mailbox address -- uniquely identifies a mailbox on a given machine.
 // A mailbox is just a place for temporary storage for messages.
@@ -58,9 +58,20 @@ class MailHeader {
 //	network header (PacketHeader) 
 //	post office header (MailHeader) 
 //	data
+//
+// Incoming Mail comes from a pool, so that delivering a packet doesn't
+// call "new".  The network copies each packet straight into a Mail
+// (mailHdr and data are laid out just as on the wire), and the Mail
+// itself is what goes into the mailbox.  A Mail is reference counted:
+// whoever ends up with it calls Release when done, and it goes back to
+// the pool once nobody holds it.
+
+#define MailPoolSize	64	// Mail allocated up front; more are
+				// added to the pool as needed
 
 class Mail {
   public:
+     Mail();			// An empty Mail, for the pool
      Mail(PacketHeader pktH, MailHeader mailH, char *msgData);
 				// Initialize a mail message by
 				// concatenating the headers to the data
@@ -68,26 +79,64 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+
+     static Mail *Alloc();	// Take a Mail from the pool, with one
+				// reference
+     void Hold();		// Add a reference
+     void Release();		// Drop a reference; back to the pool
+				// when the last one goes
+
+  private:
+     int refCount;
+     Mail *next;		// Next free Mail in the pool
+
+     static Mail *freeList;
 };
 
 // The following class defines a single mailbox, or temporary storage
 // for messages.   Incoming messages are put by the PostOffice into the 
 // appropriate mailbox, and these messages can then be retrieved by
 // threads on this machine.
+//
+// A mailbox holds at most "capacity" messages.  Mail that arrives at
+// a full box is dropped, just as if the network had lost it, so that
+// a receiver that falls behind can't make the Post Office use up
+// memory without limit.
+//
+// The postal worker is the only thread that puts mail in a box, and
+// only one thread at a time may wait to get mail out of it, so a box
+// is a SynchRing rather than a SynchList: no Lock is taken on the way
+// through.
+
+#define MailBoxCapacity	32	// default messages a mailbox can hold
 
 class MailBox {
   public: 
     MailBox();			// Allocate and initialize mail box
     ~MailBox();			// De-allocate mail box
 
-    void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
+    bool Put(Mail *mail);	// Atomically put a message into the
+				// mailbox; the mailbox takes over the
+				// caller's reference.  Returns FALSE,
+				// and drops the message, if the box
+				// is full
     void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
 				// to get!)
+    Mail *Get();		// Same, but hand over the Mail itself;
+				// the caller must Release it
+
+    void SetCapacity(int n);	// Nobody may be waiting in the box
+    int FreeSpace() { return messages->Free(); }
+    void Print(int box);	// Print the box's counters
+
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    SynchRing *messages;	// A mailbox is just a ring of arrived messages
+    int capacity;		// Most messages the box will hold
+    int maxQueued;		// Most that have ever been in the box
+    int numDelivered;		// Messages put in the box
+    int numDropped;		// Messages dropped because it was full
 };
 
 // The following class defines a "Post Office", or a collection of 
@@ -101,28 +150,43 @@ class MailBox {
 
 class PostOffice {
   public:
-    PostOffice(NetworkAddress addr, double reliability, int nBoxes);
+    PostOffice(NetworkAddress addr, double reliability, int nBoxes,
+		int txDepth);
 				// Allocate and initialize Post Office
 				//   "reliability" is how many packets
 				//   get dropped by the underlying network
+				//   "txDepth" is how many packets can
+				//   be on the wire at once
     ~PostOffice();		// De-allocate Post Office data
     
     bool Send(PacketHeader pktHdr, MailHeader mailHdr, char *data);
     				// Send a message to a mailbox on a remote 
 				// machine.  The fromBox in the MailHeader is 
 				// the return box for ack's.
+    bool SendBatch(int count, PacketHeader *pktHdrs, MailHeader *mailHdrs,
+		char **data);	// Send "count" messages, back to back
     
     void Receive(int box, PacketHeader *pktHdr, 
 		MailHeader *mailHdr, char *data);
     				// Retrieve a message from "box".  Wait if
 				// there is no message in the box.
+    Mail *Receive(int box);	// Same, but lend the caller the Mail
+				// instead of copying it out; the caller
+				// must Release it
+
+    void SetCapacity(int box, int n);
+				// Let "box" hold "n" messages
+    int FreeSpace(int box);	// Room left in "box"
+    void Print();		// Print mailbox counters
+    NetworkAddress Address() { return netAddr; }
+				// This machine's network address
 
     void PostalDelivery();	// Wait for incoming messages, 
 				// and then put them in the correct mailbox
 
     void PacketSent();		// Interrupt handler, called when outgoing 
-				// packet has been put on network; next 
-				// packet can now be sent
+				// packets have been put on network; more
+				// packets can now be sent
     void IncomingPacket();	// Interrupt handler, called when incoming
    				// packet has arrived and can be pulled
 				// off of network (i.e., time to call 
@@ -134,8 +198,12 @@ class PostOffice {
     MailBox *boxes;		// Table of mail boxes to hold incoming mail
     int numBoxes;		// Number of mail boxes
     Semaphore *messageAvailable;// V'ed when message has arrived from network
-    Semaphore *messageSent;	// V'ed when next message can be sent to network
-    Lock *sendLock;		// Only one outgoing message at a time
+    Semaphore *messageSent;	// Counts free slots in the network's
+				// transmit queue
+    Lock *sendLock;		// Keeps each Send or SendBatch together
+
+    bool Transmit(PacketHeader pktHdr, MailHeader mailHdr, char *data);
+				// Hand one message to the network
 };
 
 #endif
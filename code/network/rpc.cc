@@ -0,0 +1,727 @@
+// rpc.cc
+//	Routines for remote procedure calls: encoding arguments, the
+//	server's receiver and worker threads, and the client's batching
+//	of calls and matching of replies to them.
+//
+//	A message, either way, is a series of requests (or replies), each
+//	an RpcHeader followed by its encoded arguments (or results).
+//
+//	On the client, a thread that Starts a call gets a slot in
+//	"calls", and adds its request to the batch.  Nothing is sent
+//	until someone needs an answer: Finish sends the batch, then
+//	sleeps on the call's semaphore until the dispatcher thread finds
+//	the reply with the call's reqId.  While one thread is sending,
+//	others keep adding to a second buffer, which the sender sends
+//	next, so a burst of calls from many threads goes out in a few
+//	messages.
+//
+//	On the server, the thread calling Run takes messages off the
+//	Transport, and queues each one on the client that sent it.  A
+//	client with messages is put on the "ready" list; a worker takes
+//	it, handles all of its messages in order, and then sends every
+//	client the replies that have built up for it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "rpc.h"
+
+// A message waiting on the server to be handled.
+
+class RpcMessage {
+  public:
+    int length;
+    char *data;
+};
+
+//----------------------------------------------------------------------
+// RpcArgs::RpcArgs
+// 	Initialize an empty argument list.
+//----------------------------------------------------------------------
+
+RpcArgs::RpcArgs()
+{
+    length = pos = 0;
+}
+
+//----------------------------------------------------------------------
+// RpcArgs::PutInt
+// 	Add an int to the end of the list.
+//----------------------------------------------------------------------
+
+void
+RpcArgs::PutInt(int value)
+{
+    ASSERT(length + 2 * (int)sizeof(int) <= MaxRpcData);
+    ((int *)(data + length))[0] = RpcTag(RpcInt, sizeof(int));
+    ((int *)(data + length))[1] = value;
+    length += 2 * sizeof(int);
+}
+
+//----------------------------------------------------------------------
+// RpcArgs::PutString
+// 	Add a string to the end of the list.  It must fit.
+//----------------------------------------------------------------------
+
+void
+RpcArgs::PutString(char *s)
+{
+    int n = strlen(s);
+    int padded = divRoundUp(n, sizeof(int)) * sizeof(int);
+
+    ASSERT(length + (int)sizeof(int) + padded <= MaxRpcData);
+    ((int *)(data + length))[0] = RpcTag(RpcString, n);
+    memset(data + length + sizeof(int), 0, padded);
+    memcpy(data + length + sizeof(int), s, n);
+    length += sizeof(int) + padded;
+}
+
+//----------------------------------------------------------------------
+// RpcArgs::GetInt
+// 	Take the next item off the list, which should be an int.
+//	Returns FALSE, leaving the item there, if it is something else,
+//	or if there are no more items.
+//----------------------------------------------------------------------
+
+bool
+RpcArgs::GetInt(int *value)
+{
+    int tag;
+
+    if (pos + 2 * (int)sizeof(int) > length)
+	return FALSE;
+    tag = ((int *)(data + pos))[0];
+    if ((RpcTagType(tag) != RpcInt) || (RpcTagLength(tag) != sizeof(int)))
+	return FALSE;
+    *value = ((int *)(data + pos))[1];
+    pos += 2 * sizeof(int);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RpcArgs::GetIntOr
+// 	Take the next int off the list, or return "fail" if there isn't
+//	one.
+//----------------------------------------------------------------------
+
+int
+RpcArgs::GetIntOr(int fail)
+{
+    int value;
+
+    return GetInt(&value) ? value : fail;
+}
+
+//----------------------------------------------------------------------
+// RpcArgs::GetString
+// 	Take the next item off the list, which should be a string, and
+//	copy it to "s" ('\0' terminated), cutting it short if it is
+//	longer than "size" - 1.  Returns FALSE if the next item isn't a
+//	string.
+//----------------------------------------------------------------------
+
+bool
+RpcArgs::GetString(char *s, int size)
+{
+    int tag, n, padded;
+
+    if (pos + (int)sizeof(int) > length)
+	return FALSE;
+    tag = ((int *)(data + pos))[0];
+    n = RpcTagLength(tag);
+    padded = divRoundUp(n, sizeof(int)) * sizeof(int);
+    if ((RpcTagType(tag) != RpcString) ||
+		(pos + (int)sizeof(int) + padded > length))
+	return FALSE;
+    memcpy(s, data + pos + sizeof(int), min(n, size - 1));
+    s[min(n, size - 1)] = '\0';
+    pos += sizeof(int) + padded;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RpcArgs::Load
+// 	Replace the list with "numBytes" bytes of encoded items from a
+//	message, ready to be taken apart with the Get's.
+//----------------------------------------------------------------------
+
+void
+RpcArgs::Load(char *from, int numBytes)
+{
+    length = min(numBytes, MaxRpcData);
+    memcpy(data, from, length);
+    pos = 0;
+}
+
+//----------------------------------------------------------------------
+// RpcWorker, RpcDispatcher
+// 	Dummy functions because C++ can't indirectly invoke member
+//	functions.  They are forked as the server's worker threads, and
+//	the client's dispatcher thread.
+//----------------------------------------------------------------------
+
+static void RpcWorker(int arg)
+{ RpcServer *s = (RpcServer *) arg; s->Work(); }
+static void RpcDispatcher(int arg)
+{ RpcClient *c = (RpcClient *) arg; c->Dispatch(); }
+
+//----------------------------------------------------------------------
+// RpcServer::RpcServer
+// 	Set up a server on mailbox "box", with no procedures yet, and
+//	start its worker threads.  Nothing is received until Run.
+//
+//	"workers" -- how many requests can be handled at once
+//----------------------------------------------------------------------
+
+RpcServer::RpcServer(MailBoxAddress box, int workers)
+{
+    int i;
+
+    transport = new Transport(box, WindowSize);
+    for (i = 0; i < MaxRpcProcs; i++)
+	handlers[i] = NULL;
+    for (i = 0; i < MaxRpcClients; i++)
+	clients[i] = NULL;
+    lock = new Lock("rpc server");
+    ready = new SynchList;
+    replyLock = new Lock("rpc replies");
+    numWorkers = workers;
+    numRequests = numMessages = numReplyMessages = 0;
+
+    for (i = 0; i < numWorkers; i++)
+	(new Thread("rpc worker"))->Fork(RpcWorker, (int) this);
+}
+
+//----------------------------------------------------------------------
+// RpcServer::~RpcServer
+// 	The worker threads are still blocked, so only do this when
+//	Nachos is shutting down.
+//----------------------------------------------------------------------
+
+RpcServer::~RpcServer()
+{
+    for (int i = 0; i < MaxRpcClients; i++)
+	if (clients[i] != NULL) {
+	    delete clients[i]->messages;
+	    delete clients[i];
+	}
+    delete lock;
+    delete ready;
+    delete replyLock;
+    delete transport;
+}
+
+//----------------------------------------------------------------------
+// RpcServer::Register
+// 	Have "handler" serve calls to procedure "proc".  Calls to a
+//	procedure nobody registered get a reply with no results.
+//----------------------------------------------------------------------
+
+void
+RpcServer::Register(int proc, RpcHandler handler, int arg)
+{
+    ASSERT((proc >= 0) && (proc < MaxRpcProcs));
+    handlers[proc] = handler;
+    handlerArgs[proc] = arg;
+}
+
+//----------------------------------------------------------------------
+// RpcServer::FindClient
+// 	Return what we know about the client at "from", "box",
+//	starting a new record if this is the first we've heard from it.
+//	Returns NULL if we already have MaxRpcClients.
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+RpcClientState *
+RpcServer::FindClient(NetworkAddress from, MailBoxAddress box)
+{
+    RpcClientState *client;
+    int i, free = -1;
+
+    for (i = 0; i < MaxRpcClients; i++) {
+	if ((clients[i] != NULL) && (clients[i]->machine == from) &&
+		(clients[i]->box == box))
+	    return clients[i];
+	if ((clients[i] == NULL) && (free == -1))
+	    free = i;
+    }
+    if (free == -1)
+	return NULL;
+    client = new RpcClientState;
+    client->machine = from;
+    client->box = box;
+    client->messages = new List;
+    client->busy = FALSE;
+    client->replyLength = 0;
+    client->numRequests = 0;
+    clients[free] = client;
+    return client;
+}
+
+//----------------------------------------------------------------------
+// RpcServer::Run
+// 	Take messages off the Transport forever, queueing each on the
+//	client that sent it.  If no worker is busy with that client, the
+//	client goes on the "ready" list for the next free worker.
+//----------------------------------------------------------------------
+
+void
+RpcServer::Run()
+{
+    char *buffer = new char[MaxMessageSize];
+    NetworkAddress from;
+    MailBoxAddress fromBox;
+    RpcClientState *client;
+    RpcMessage *m;
+    int length;
+
+    for (;;) {
+	length = transport->Receive(&from, &fromBox, buffer, MaxMessageSize);
+	numMessages++;
+
+	lock->Acquire();
+	client = FindClient(from, fromBox);
+	if (client == NULL) {
+	    lock->Release();
+	    DEBUG('n', "RPC server: too many clients, dropping message\n");
+	    continue;
+	}
+	m = new RpcMessage;
+	m->length = length;
+	m->data = new char[length];
+	memcpy(m->data, buffer, length);
+	client->messages->Append((void *)m);
+	if (!client->busy) {
+	    client->busy = TRUE;
+	    ready->Append((void *)client);
+	}
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// RpcServer::Work
+// 	Loop forever: take a client off the "ready" list, handle all of
+//	its messages in order, then send out the replies that have been
+//	collected.
+//----------------------------------------------------------------------
+
+void
+RpcServer::Work()
+{
+    RpcClientState *client;
+    RpcMessage *m;
+
+    for (;;) {
+	client = (RpcClientState *) ready->Remove();
+
+	lock->Acquire();
+	while (!client->messages->IsEmpty()) {
+	    m = (RpcMessage *) client->messages->Remove();
+	    lock->Release();
+	    Handle(client, m->data, m->length);
+	    delete [] m->data;
+	    delete m;
+	    lock->Acquire();
+	}
+	client->busy = FALSE;
+	lock->Release();
+
+	SendReplies();
+    }
+}
+
+//----------------------------------------------------------------------
+// RpcServer::Handle
+// 	Run the handler for each request in a message from "client", and
+//	queue the replies that are ready.
+//----------------------------------------------------------------------
+
+void
+RpcServer::Handle(RpcClientState *client, char *message, int length)
+{
+    RpcHeader *hdr;
+    RpcRequest req;
+    RpcArgs results;
+    bool answer;
+    int pos;
+
+    for (pos = 0; pos + (int)sizeof(RpcHeader) <= length;
+		pos += sizeof(RpcHeader) + hdr->length) {
+	hdr = (RpcHeader *)(message + pos);
+	if ((hdr->length < 0) || (hdr->length > MaxRpcData) ||
+		(pos + (int)sizeof(RpcHeader) + hdr->length > length))
+	    break;			// garbled
+	req.machine = client->machine;
+	req.box = client->box;
+	req.proc = hdr->proc;
+	req.reqId = hdr->reqId;
+	req.thread = hdr->thread;
+	req.args.Load(message + pos + sizeof(RpcHeader), hdr->length);
+	results = RpcArgs();
+	numRequests++;
+	client->numRequests++;
+
+	DEBUG('n', "RPC server: proc %d, request %d from (%d, %d)\n",
+		req.proc, req.reqId, req.machine, req.box);
+	answer = TRUE;
+	if ((req.proc >= 0) && (req.proc < MaxRpcProcs) &&
+		(handlers[req.proc] != NULL))
+	    answer = (*handlers[req.proc])(handlerArgs[req.proc], &req,
+			&results);
+	if (answer && (req.reqId != NoReply))
+	    Reply(req.machine, req.box, req.reqId, &results);
+    }
+}
+
+//----------------------------------------------------------------------
+// RpcServer::Reply
+// 	Queue a reply for the client at "to", "box".  If its batch
+//	is full, send the batch now.  Handlers that put off answering a
+//	request call this once they have the answer.
+//----------------------------------------------------------------------
+
+void
+RpcServer::Reply(NetworkAddress to, MailBoxAddress box, int reqId,
+		RpcArgs *results)
+{
+    RpcClientState *client;
+    RpcHeader hdr;
+    int length = sizeof(RpcHeader) + results->Length();
+
+    lock->Acquire();
+    client = FindClient(to, box);
+    lock->Release();
+    if (client == NULL)
+	return;
+
+    replyLock->Acquire();
+    if (client->replyLength + length > MaxMessageSize) {
+	transport->Send(to, box, client->replies, client->replyLength);
+	numReplyMessages++;
+	client->replyLength = 0;
+    }
+    hdr.proc = -1;
+    hdr.reqId = reqId;
+    hdr.thread = 0;
+    hdr.length = results->Length();
+    memcpy(client->replies + client->replyLength, (char *)&hdr,
+		sizeof(RpcHeader));
+    memcpy(client->replies + client->replyLength + sizeof(RpcHeader),
+		results->Data(), results->Length());
+    client->replyLength += length;
+    replyLock->Release();
+}
+
+//----------------------------------------------------------------------
+// RpcServer::SendReplies
+// 	Send each client the replies that have built up for it.  We
+//	don't wait for them to be acknowledged.
+//----------------------------------------------------------------------
+
+void
+RpcServer::SendReplies()
+{
+    RpcClientState *client;
+
+    replyLock->Acquire();
+    for (int i = 0; i < MaxRpcClients; i++) {
+	client = clients[i];
+	if ((client != NULL) && (client->replyLength > 0)) {
+	    transport->Send(client->machine, client->box, client->replies,
+			client->replyLength);
+	    numReplyMessages++;
+	    client->replyLength = 0;
+	}
+    }
+    replyLock->Release();
+}
+
+//----------------------------------------------------------------------
+// RpcServer::Print
+// 	Print how much work the server has done.
+//----------------------------------------------------------------------
+
+void
+RpcServer::Print()
+{
+    printf("RPC server: %d workers, %d requests in %d messages, "
+		"%d reply messages\n", numWorkers, numRequests, numMessages,
+		numReplyMessages);
+    for (int i = 0; i < MaxRpcClients; i++)
+	if (clients[i] != NULL)
+	    printf("  client (%d, %d): %d requests\n", clients[i]->machine,
+		clients[i]->box, clients[i]->numRequests);
+    transport->Print();
+}
+
+//----------------------------------------------------------------------
+// RpcClient::RpcClient
+// 	Get ready to call the server at "host", "hostBox", and start
+//	the thread that waits for replies.
+//
+//	"box" -- our own mailbox, where the replies come back
+//----------------------------------------------------------------------
+
+RpcClient::RpcClient(NetworkAddress host, MailBoxAddress hostBox,
+		MailBoxAddress box)
+{
+    server = host;
+    serverBox = hostBox;
+    transport = new Transport(box, WindowSize);
+    for (int i = 0; i < MaxRpcCalls; i++) {
+	calls[i].inUse = FALSE;
+	calls[i].replied = new Semaphore("rpc call", 0);
+    }
+    lock = new Lock("rpc client");
+    callFree = new Condition("rpc call free");
+    sent = new Condition("rpc sent");
+    nextReqId = 0;
+    batch = new char[MaxMessageSize];
+    sending = new char[MaxMessageSize];
+    batchLength = 0;
+    busy = FALSE;
+    numCalls = numPosted = numMessages = 0;
+
+    (new Thread("rpc dispatcher"))->Fork(RpcDispatcher, (int) this);
+}
+
+//----------------------------------------------------------------------
+// RpcClient::~RpcClient
+//----------------------------------------------------------------------
+
+RpcClient::~RpcClient()
+{
+    for (int i = 0; i < MaxRpcCalls; i++)
+	delete calls[i].replied;
+    delete lock;
+    delete callFree;
+    delete sent;
+    delete [] batch;
+    delete [] sending;
+    delete transport;
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Append
+// 	Add a request to the batch.  If it doesn't fit, the batch has to
+//	go out first; if another thread is already sending, wait for it
+//	to make room.
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Append(int proc, int reqId, RpcArgs *args)
+{
+    RpcHeader hdr;
+    int length = sizeof(RpcHeader) + args->Length();
+
+    while (batchLength + length > MaxMessageSize) {
+	if (busy)
+	    sent->Wait(lock);
+	else
+	    Send();
+    }
+    hdr.proc = proc;
+    hdr.reqId = reqId;
+    hdr.thread = currentThread->account->id;
+    hdr.length = args->Length();
+    memcpy(batch + batchLength, (char *)&hdr, sizeof(RpcHeader));
+    memcpy(batch + batchLength + sizeof(RpcHeader), args->Data(),
+		args->Length());
+    batchLength += length;
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Send
+// 	Send the batch, and keep going as long as other threads add to
+//	it while we're sending.  If some other thread is already doing
+//	this, there's nothing for us to do; it will send our requests.
+//
+//	Assumes "lock" is held; it is let go while sending.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Send()
+{
+    char *buffer;
+    int length;
+
+    if (busy)
+	return;
+    busy = TRUE;
+    while (batchLength > 0) {
+	buffer = sending;		// swap buffers, so others can
+	sending = batch;		// keep adding requests
+	batch = buffer;
+	length = batchLength;
+	batchLength = 0;
+
+	lock->Release();
+	transport->Send(server, serverBox, sending, length);
+	lock->Acquire();
+	numMessages++;
+	sent->Broadcast(lock);
+    }
+    busy = FALSE;
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Start
+// 	Queue a call to procedure "proc", and return a handle to Finish
+//	it with.  The request isn't sent yet, so that several calls
+//	Started together go out in one message.  Waits if MaxRpcCalls
+//	calls are already outstanding.
+//----------------------------------------------------------------------
+
+int
+RpcClient::Start(int proc, RpcArgs *args)
+{
+    int i;
+
+    lock->Acquire();
+    for (;;) {
+	for (i = 0; i < MaxRpcCalls; i++)
+	    if (!calls[i].inUse)
+		break;
+	if (i < MaxRpcCalls)
+	    break;
+	callFree->Wait(lock);
+    }
+    calls[i].inUse = TRUE;
+    calls[i].done = FALSE;
+    calls[i].reqId = nextReqId++;
+    Append(proc, calls[i].reqId, args);
+    numCalls++;
+    lock->Release();
+    return i;
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Finish
+// 	Send whatever is queued, then wait for the reply to call "call",
+//	a handle returned by Start, and copy out its results.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Finish(int call, RpcArgs *results)
+{
+    RpcCall *c = &calls[call];
+
+    ASSERT((call >= 0) && (call < MaxRpcCalls) && c->inUse);
+    lock->Acquire();
+    Send();
+    lock->Release();
+
+    c->replied->P();
+
+    lock->Acquire();
+    ASSERT(c->done);
+    *results = c->results;
+    c->inUse = FALSE;
+    callFree->Signal(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Call
+// 	Call procedure "proc" on the server, and wait for the results.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Call(int proc, RpcArgs *args, RpcArgs *results)
+{
+    Finish(Start(proc, args), results);
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Post
+// 	Queue a request the caller doesn't need an answer to.  It goes
+//	out with the next message -- the next time someone Finishes a
+//	call, or Flushes.  The server handles it before anything this
+//	client asks for later.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Post(int proc, RpcArgs *args)
+{
+    lock->Acquire();
+    Append(proc, NoReply, args);
+    numPosted++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Flush
+// 	Send everything that is queued, and wait until it has been
+//	handed to the Transport.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Flush()
+{
+    lock->Acquire();
+    Send();
+    while (busy || (batchLength > 0)) {
+	sent->Wait(lock);
+	Send();
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Print
+// 	Print how many requests were sent, and in how many messages.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Print()
+{
+    printf("RPC client: %d calls, %d posted requests, %d messages\n",
+		numCalls, numPosted, numMessages);
+}
+
+//----------------------------------------------------------------------
+// RpcClient::Dispatch
+// 	Loop forever, taking reply messages from the server and waking
+//	up the thread waiting for each reply in them.
+//----------------------------------------------------------------------
+
+void
+RpcClient::Dispatch()
+{
+    char *buffer = new char[MaxMessageSize];
+    RpcHeader *hdr;
+    NetworkAddress from;
+    MailBoxAddress fromBox;
+    int length, pos, i;
+
+    for (;;) {
+	length = transport->Receive(&from, &fromBox, buffer, MaxMessageSize);
+	for (pos = 0; pos + (int)sizeof(RpcHeader) <= length;
+			pos += sizeof(RpcHeader) + hdr->length) {
+	    hdr = (RpcHeader *)(buffer + pos);
+	    if ((hdr->length < 0) || (hdr->length > MaxRpcData) ||
+		    (pos + (int)sizeof(RpcHeader) + hdr->length > length))
+		break;			// garbled
+	    lock->Acquire();
+	    for (i = 0; i < MaxRpcCalls; i++)
+		if (calls[i].inUse && !calls[i].done &&
+			(calls[i].reqId == hdr->reqId))
+		    break;
+	    if (i < MaxRpcCalls) {
+		calls[i].results.Load(buffer + pos + sizeof(RpcHeader),
+			hdr->length);
+		calls[i].done = TRUE;
+		calls[i].replied->V();
+	    }
+	    lock->Release();
+	}
+    }
+}
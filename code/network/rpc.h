@@ -0,0 +1,215 @@
+// rpc.h
+//	Data structures for remote procedure calls between Nachos
+//	machines, over the reliable Transport.
+//
+//	A server registers a handler for each procedure number it
+//	serves.  A client calls a procedure with a list of typed
+//	arguments (ints and strings), and gets back a list of typed
+//	results.  Every call carries a request id, so a client can have
+//	many calls outstanding at once -- even from a single thread,
+//	which can Start several independent calls and then Finish them.
+//
+//	Calls are batched: a call is only added to the client's next
+//	message, which goes out when some thread waits for a reply (or
+//	the message fills up), so independent calls made together cost
+//	one message.  Requests that need no reply (Post) ride along the
+//	same way.  The server batches replies to each client likewise.
+//
+//	On the server, a receiver thread takes messages off the Transport
+//	and queues them; worker threads run the handlers.  Requests from
+//	one client are handled one at a time, in the order they were sent,
+//	so a client can count on a Post being done before anything it
+//	calls afterwards; requests from different clients are handled in
+//	parallel.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef RPC_H
+#define RPC_H
+
+#include "transport.h"
+#include "synch.h"
+#include "synchlist.h"
+#include "list.h"
+
+#define MaxRpcData		128	// encoded bytes of arguments (or
+					// results) in one call
+#define MaxRpcProcs		32	// procedure numbers 0..MaxRpcProcs-1
+#define MaxRpcCalls		32	// calls a client can have waiting
+#define MaxRpcClients		MaxPeers
+#define RpcWorkers		4	// default server worker threads
+
+#define NoReply			(-1)	// reqId of a request nobody waits for
+
+// The arguments or results of a call, in their wire encoding.  Each
+// item is a tag word giving its type and length, followed by the
+// value, padded to a multiple of 4 bytes.  Decoding checks that each
+// item has the type the receiver expects.
+
+enum RpcType { RpcInt = 1, RpcString = 2 };
+
+#define RpcTag(type, len)	(((type) << 16) | (len))
+#define RpcTagType(tag)		((tag) >> 16)
+#define RpcTagLength(tag)	((tag) & 0xffff)
+
+class RpcArgs {
+  public:
+    RpcArgs();				// Empty, ready for Put's
+
+    void PutInt(int value);
+    void PutString(char *s);		// At most MaxRpcString characters
+    bool GetInt(int *value);		// Take the next item; FALSE if it
+    bool GetString(char *s, int size);	// isn't there, or is another type
+    int GetIntOr(int fail);		// Next int, or "fail" if there isn't
+					// one
+
+    void Load(char *from, int numBytes);
+					// Decode "numBytes" from "from"
+    char *Data() { return data; }
+    int Length() { return length; }
+
+  private:
+    char data[MaxRpcData];
+    int length;				// Bytes encoded
+    int pos;				// Where the next Get reads from
+};
+
+#define MaxRpcString		(MaxRpcData - 8)
+
+// Each request or reply in a message starts with this header, followed
+// by "length" bytes of encoded arguments or results.
+
+class RpcHeader {
+  public:
+    int proc;				// Procedure number
+    int reqId;				// Matches the reply to the request
+    int thread;				// Thread on the client making it: its
+					// id, which is never reused
+    int length;				// Bytes of RpcArgs that follow
+};
+
+// A request, as a server handler sees it.  The handler can answer
+// right away, or keep "machine", "box" and "reqId" and Reply later.
+
+class RpcRequest {
+  public:
+    NetworkAddress machine;		// Client that sent it
+    MailBoxAddress box;
+    int proc;
+    int reqId;
+    int thread;
+    RpcArgs args;
+};
+
+// A server handler.  Fills in "results" and returns TRUE to reply now,
+// or returns FALSE if the reply will be sent later with Reply.  "arg"
+// is whatever was given to Register.
+
+typedef bool (*RpcHandler)(int arg, RpcRequest *req, RpcArgs *results);
+
+// What the server keeps for each client: messages waiting to be
+// handled, and replies waiting to be sent.
+
+class RpcClientState {
+  public:
+    NetworkAddress machine;
+    MailBoxAddress box;
+    List *messages;			// Messages not yet handled
+    bool busy;				// Is a worker handling its messages?
+    char replies[MaxMessageSize];	// Replies waiting to be sent
+    int replyLength;
+    int numRequests;
+};
+
+class RpcServer {
+  public:
+    RpcServer(MailBoxAddress box, int workers);
+					// Serve calls sent to "box"
+    ~RpcServer();
+
+    void Register(int proc, RpcHandler handler, int arg);
+    void Reply(NetworkAddress to, MailBoxAddress box, int reqId,
+		RpcArgs *results);	// Answer a request later
+    void Run();				// Take messages off the Transport,
+					// forever
+    void Print();			// Print statistics
+
+    void Work();			// Body of the worker threads
+
+  private:
+    Transport *transport;
+    RpcHandler handlers[MaxRpcProcs];
+    int handlerArgs[MaxRpcProcs];
+    RpcClientState *clients[MaxRpcClients];
+    Lock *lock;				// Protects "clients"
+    SynchList *ready;			// Clients with messages to handle,
+					// and no worker handling them
+    Lock *replyLock;			// Keeps reply batches together
+    int numWorkers;
+    int numRequests, numMessages, numReplyMessages;
+
+    RpcClientState *FindClient(NetworkAddress from, MailBoxAddress box);
+    void Handle(RpcClientState *client, char *message, int length);
+    void SendReplies();			// Send every client its batch
+};
+
+// A client's outstanding call.
+
+class RpcCall {
+  public:
+    bool inUse;
+    bool done;				// Has the reply come?
+    int reqId;
+    RpcArgs results;
+    Semaphore *replied;
+};
+
+class RpcClient {
+  public:
+    RpcClient(NetworkAddress host, MailBoxAddress hostBox,
+		MailBoxAddress box);	// Call the server at "host",
+					// "hostBox", from our own "box"
+    ~RpcClient();
+
+    int Start(int proc, RpcArgs *args);	// Queue a call; returns a handle
+    void Finish(int call, RpcArgs *results);
+					// Wait for the reply to a call
+    void Call(int proc, RpcArgs *args, RpcArgs *results);
+					// Start and Finish
+    void Post(int proc, RpcArgs *args);	// Queue a request that needs no
+					// reply
+    void Flush();			// Send everything queued now
+    void Print();			// Print statistics
+
+    void Dispatch();			// Body of the thread that hands
+					// replies to waiting threads
+
+  private:
+    NetworkAddress server;
+    MailBoxAddress serverBox;
+    Transport *transport;
+    RpcCall calls[MaxRpcCalls];
+    Lock *lock;				// Protects everything below
+    Condition *callFree;		// Signalled when a call slot frees up
+    Condition *sent;			// Broadcast when a message has gone
+					// out
+    int nextReqId;
+
+    char *batch;			// Requests waiting to be sent
+    int batchLength;
+    char *sending;			// Batch being sent, so others can
+					// add to "batch" meanwhile
+    bool busy;				// Is a thread sending?
+    int numCalls, numPosted, numMessages;
+
+    void Append(int proc, int reqId, RpcArgs *args);
+					// Add a request to the batch
+    void Send();			// Send "batch", and whatever is
+					// added while we do
+};
+
+#endif // RPC_H
@@ -0,0 +1,614 @@
+// transport.cc 
+//	Routines to send messages reliably, in order, and of any size,
+//	over the Post Office, even when the network drops packets.
+//
+//	Each Transport has two threads of its own.  The "transport
+//	worker" takes packets out of our mailbox: data fragments are put
+//	in order and reassembled into messages, and answered with an
+//	ack; acks slide the send window forward, letting blocked senders
+//	continue.  The "transport timer" thread wakes up periodically
+//	while anything is unacknowledged, and resends fragments that
+//	have waited too long.  As with the Post Office, the timer's
+//	interrupt handler can't do the work itself, since that needs a
+//	Lock; it just wakes up the thread.
+//
+//	Senders only wait for room in the window, not for each fragment
+//	to be acknowledged, so up to a window of fragments per peer are
+//	on the wire at once -- or fewer, if the receiver's credit says
+//	it can't take that many.
+//
+//	Memory on the receiving side stays bounded: fragments are only
+//	accepted within the credit we have given, so at most
+//	ReceiveQueueSize messages (plus what peers had already been
+//	given credit for) wait for Receive.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "transport.h"
+
+//----------------------------------------------------------------------
+// TransportWorker, TransportTimerThread, TransportTimer
+// 	Dummy functions because C++ can't indirectly invoke member
+//	functions.  The first two are forked as the Transport's threads;
+//	the last is the retransmission timer's interrupt handler.
+//
+//	"arg" -- pointer to the Transport
+//----------------------------------------------------------------------
+
+static void TransportWorker(int arg)
+{ Transport *t = (Transport *) arg; t->Deliver(); }
+static void TransportTimerThread(int arg)
+{ Transport *t = (Transport *) arg; t->Retransmit(); }
+static void TransportTimer(int arg)
+{ Transport *t = (Transport *) arg; t->TimerExpired(); }
+
+//----------------------------------------------------------------------
+// Transport::Transport
+// 	Set up a transport endpoint on a Post Office mailbox, and start
+//	its threads.  Nothing else may Receive from "myBox".
+//
+//	"myBox" -- the mailbox to send from and receive into
+//	"windowSize" -- how many fragments each peer may have
+//		unacknowledged
+//----------------------------------------------------------------------
+
+Transport::Transport(MailBoxAddress myBox, int windowSize)
+{
+    Thread *t;
+
+    ASSERT((windowSize > 0) && (windowSize <= MaxWindowSize));
+    box = myBox;
+    window = windowSize;
+    retransmitTimeout = RetransmitTimeout(window);
+    for (int i = 0; i < MaxPeers; i++)
+	peers[i] = NULL;
+    postOffice->SetCapacity(box, TransportBoxCapacity(window));
+    lock = new Lock("transport lock");
+    windowOpen = new Condition("transport window open");
+    messages = new SynchList;
+    numWaiting = 0;
+    timerFired = new Semaphore("transport timer", 0);
+    timerPending = FALSE;
+
+    numFragmentsSent = numRetransmits = numAcksSent = numDuplicates = 0;
+    numMessagesSent = numMessagesReceived = 0;
+    numRefused = numWindowUpdates = numProbes = 0;
+    bytesDelivered = 0;
+
+    t = new Thread("transport worker");
+    t->Fork(TransportWorker, (int) this);
+    t = new Thread("transport timer");
+    t->Fork(TransportTimerThread, (int) this);
+}
+
+//----------------------------------------------------------------------
+// Transport::~Transport
+// 	De-allocate the transport.  Its threads are still blocked, so
+//	only do this when Nachos is shutting down.
+//----------------------------------------------------------------------
+
+Transport::~Transport()
+{
+    for (int i = 0; i < MaxPeers; i++)
+	if (peers[i] != NULL) {
+	    delete [] peers[i]->message;
+	    delete peers[i];
+	}
+    delete lock;
+    delete windowOpen;
+    delete messages;
+    delete timerFired;
+}
+
+//----------------------------------------------------------------------
+// Transport::FindPeer
+// 	Return the state of our conversation with the Transport at
+//	"peerMachine", "peerBox", starting a new one if this is the
+//	first time we've heard of it.  Returns NULL if we already talk
+//	to MaxPeers others.
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+Peer *
+Transport::FindPeer(NetworkAddress peerMachine, MailBoxAddress peerBox)
+{
+    Peer *peer;
+    int i, free = -1;
+
+    for (i = 0; i < MaxPeers; i++) {
+	if ((peers[i] != NULL) && (peers[i]->machine == peerMachine) &&
+		(peers[i]->box == peerBox))
+	    return peers[i];
+	if ((peers[i] == NULL) && (free == -1))
+	    free = i;
+    }
+    if (free == -1)
+	return NULL;
+
+    peer = new Peer;
+    peer->machine = peerMachine;
+    peer->box = peerBox;
+    peer->sendBase = peer->nextSeq = 0;
+    peer->sendLimit = window;		// until the peer tells us otherwise
+    peer->blocked = FALSE;
+    peer->recvNext = 0;
+    peer->advertised = window;
+    for (i = 0; i < MaxWindowSize; i++)
+	peer->sent[i].valid = peer->received[i].valid = FALSE;
+    peer->message = new char[MaxMessageSize];
+    peer->messageLength = 0;
+    peers[free] = peer;
+    return peer;
+}
+
+//----------------------------------------------------------------------
+// Transport::SendFragment
+// 	Put a transport header on a fragment (or an ack, or a probe), and
+//	mail it to "peer".  Blocks while the network sends the packet, so
+//	it must be called without "lock" held.
+//
+//	"credit" -- for an ack, how many fragments the peer may send
+//----------------------------------------------------------------------
+
+void
+Transport::SendFragment(Peer *peer, int type, int seq, bool last,
+			char *data, int length, int credit)
+{
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+    TransportHeader hdr;
+    char buffer[MaxMailSize];
+
+    ASSERT(length <= (int)MaxFragmentSize);
+    hdr.type = type;
+    hdr.last = last;
+    hdr.credit = credit;
+    hdr.seq = seq;
+    memcpy(buffer, (char *)&hdr, sizeof(TransportHeader));
+    if (length > 0)
+	memcpy(buffer + sizeof(TransportHeader), data, length);
+
+    pktHdr.to = peer->machine;
+    mailHdr.to = peer->box;
+    mailHdr.from = box;
+    mailHdr.length = sizeof(TransportHeader) + length;
+    postOffice->Send(pktHdr, mailHdr, buffer);
+}
+
+//----------------------------------------------------------------------
+// Transport::Send
+// 	Send a message to the Transport at "to", "toBox".  The message is
+//	cut into fragments; each one goes out as soon as there is room
+//	for it in the send window, and the receiver has given us credit
+//	for it.  We return once the last fragment is sent -- not
+//	acknowledged; see Flush.
+//
+//	"data", "length" -- the message; at most MaxMessageSize bytes
+//----------------------------------------------------------------------
+
+void
+Transport::Send(NetworkAddress to, MailBoxAddress toBox, char *data,
+		int length)
+{
+    Peer *peer;
+    Fragment *frag;
+    int pos = 0, n, seq;
+    bool last;
+
+    ASSERT((length >= 0) && (length <= MaxMessageSize));
+    lock->Acquire();
+    peer = FindPeer(to, toBox);
+    ASSERT(peer != NULL);
+    do {
+	n = min(length - pos, (int)MaxFragmentSize);
+	last = (pos + n == length);
+	while ((peer->nextSeq - peer->sendBase >= window) ||
+		(peer->nextSeq >= peer->sendLimit)) {
+	    if (peer->nextSeq >= peer->sendLimit) {
+		peer->blocked = TRUE;	// make sure the timer will probe,
+		StartTimer();		// in case a window update is lost
+	    }
+	    windowOpen->Wait(lock);
+	}
+	peer->blocked = FALSE;
+
+	seq = peer->nextSeq++;
+	frag = &peer->sent[seq % MaxWindowSize];
+	frag->valid = TRUE;
+	frag->last = last;
+	frag->length = n;
+	frag->sentAt = stats->totalTicks;
+	memcpy(frag->data, data + pos, n);
+	StartTimer();
+
+	lock->Release();
+	SendFragment(peer, DataFragment, seq, last, data + pos, n, 0);
+	lock->Acquire();
+	numFragmentsSent++;
+	pos += n;
+    } while (!last);
+    numMessagesSent++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Transport::Receive
+// 	Wait for the next complete message from any peer.  Returns its
+//	length; if it is longer than "maxLength", the rest is dropped.
+//
+//	Taking a message frees room for another one, so peers we had told
+//	to stop sending are sent a window update.
+//
+//	"from", "fromBox" -- set to where the message came from
+//	"data" -- where to put the message
+//----------------------------------------------------------------------
+
+int
+Transport::Receive(NetworkAddress *from, MailBoxAddress *fromBox,
+			char *data, int maxLength)
+{
+    Message *m = (Message *) messages->Remove();
+    int length = m->length;
+    Peer *update[MaxPeers];
+    int acks[MaxPeers], credits[MaxPeers];
+    int i, n = 0, credit;
+
+    lock->Acquire();
+    numWaiting--;
+    credit = Credit();
+    for (i = 0; (i < MaxPeers) && (credit > 0); i++)
+	if ((peers[i] != NULL) && (peers[i]->advertised == 0)) {
+	    peers[i]->advertised = credit;
+	    update[n] = peers[i];
+	    acks[n] = peers[i]->recvNext;
+	    credits[n] = credit;
+	    n++;
+	}
+    numWindowUpdates += n;
+    lock->Release();
+
+    for (i = 0; i < n; i++)
+	SendFragment(update[i], AckFragment, acks[i], FALSE, NULL, 0,
+			credits[i]);
+
+    *from = m->from;
+    *fromBox = m->fromBox;
+    memcpy(data, m->data, min(length, maxLength));
+    delete [] m->data;
+    delete m;
+    return length;
+}
+
+//----------------------------------------------------------------------
+// Transport::MessageWaiting
+// 	Is a complete message waiting to be Received?  Lets a server
+//	pick up every request that has arrived before answering any.
+//----------------------------------------------------------------------
+
+bool
+Transport::MessageWaiting()
+{
+    bool waiting;
+
+    lock->Acquire();
+    waiting = (numWaiting > 0);
+    lock->Release();
+    return waiting;
+}
+
+//----------------------------------------------------------------------
+// Transport::Flush
+// 	Wait until every fragment we've sent has been acknowledged.
+//----------------------------------------------------------------------
+
+void
+Transport::Flush()
+{
+    lock->Acquire();
+    while (Outstanding())
+	windowOpen->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Transport::Outstanding
+// 	Is any fragment, to any peer, still waiting for an ack?
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+bool
+Transport::Outstanding()
+{
+    for (int i = 0; i < MaxPeers; i++)
+	if ((peers[i] != NULL) && (peers[i]->sendBase != peers[i]->nextSeq))
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Transport::WaitingForCredit
+// 	Is any sender waiting for a peer to give it credit?
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+bool
+Transport::WaitingForCredit()
+{
+    for (int i = 0; i < MaxPeers; i++)
+	if ((peers[i] != NULL) && peers[i]->blocked)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Transport::Deliver
+// 	Loop forever, taking packets out of our mailbox.  Every data
+//	fragment is acknowledged, even a duplicate -- its ack may have
+//	been the packet that got lost -- and so is every probe.  Each
+//	ack carries our current credit.
+//----------------------------------------------------------------------
+
+void
+Transport::Deliver()
+{
+    Mail *mail;
+    TransportHeader *hdr;
+    Peer *peer;
+    int ack, credit;
+
+    for (;;) {
+	mail = postOffice->Receive(box);	// borrow it, don't copy it
+	if (mail->mailHdr.length < sizeof(TransportHeader)) {
+	    mail->Release();
+	    continue;
+	}
+	hdr = (TransportHeader *)mail->data;
+
+	lock->Acquire();
+	peer = FindPeer(mail->pktHdr.from, mail->mailHdr.from);
+	if (peer == NULL) {
+	    lock->Release();
+	    mail->Release();
+	    DEBUG('n', "Transport: too many peers, dropping packet\n");
+	    continue;
+	}
+	if (hdr->type == AckFragment) {
+	    GotAck(peer, hdr->seq, hdr->credit);
+	    lock->Release();
+	    mail->Release();
+	    continue;
+	}
+	if (hdr->type == DataFragment)
+	    GotData(peer, hdr, mail->data + sizeof(TransportHeader),
+		    mail->mailHdr.length - sizeof(TransportHeader));
+	ack = peer->recvNext;
+	credit = Credit();
+	peer->advertised = credit;
+	lock->Release();
+	mail->Release();
+
+	SendFragment(peer, AckFragment, ack, FALSE, NULL, 0, credit);
+	numAcksSent++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Transport::GotData
+// 	Store a data fragment from "peer" in its place in the receive
+//	window, then pass along every fragment that is now in order,
+//	reassembling them into messages.  Fragments that are duplicates
+//	are dropped, and so are fragments beyond the credit we can give
+//	right now; the sender will try them again later.
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+void
+Transport::GotData(Peer *peer, TransportHeader *hdr, char *data, int length)
+{
+    Fragment *frag;
+    Message *m;
+
+    if ((hdr->seq < peer->recvNext) ||
+		(hdr->seq >= peer->recvNext + window) ||
+		peer->received[hdr->seq % MaxWindowSize].valid) {
+	numDuplicates++;
+	return;
+    }
+    if (hdr->seq >= peer->recvNext + Credit()) {
+	numRefused++;
+	return;
+    }
+    frag = &peer->received[hdr->seq % MaxWindowSize];
+    frag->valid = TRUE;
+    frag->last = hdr->last;
+    frag->length = length;
+    memcpy(frag->data, data, length);
+
+    for (;;) {
+	frag = &peer->received[peer->recvNext % MaxWindowSize];
+	if (!frag->valid)
+	    break;
+	if (peer->messageLength + frag->length <= MaxMessageSize) {
+	    memcpy(peer->message + peer->messageLength, frag->data,
+			frag->length);
+	    peer->messageLength += frag->length;
+	}
+	if (frag->last) {
+	    m = new Message;
+	    m->from = peer->machine;
+	    m->fromBox = peer->box;
+	    m->length = peer->messageLength;
+	    m->data = peer->message;
+	    messages->Append((void *)m);
+	    numWaiting++;
+	    numMessagesReceived++;
+	    bytesDelivered += m->length;
+	    peer->message = new char[MaxMessageSize];
+	    peer->messageLength = 0;
+	}
+	frag->valid = FALSE;
+	peer->recvNext++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Transport::GotAck
+// 	"peer" has everything before fragment "ack", and will take
+//	"credit" more.  Free the acknowledged fragments, and let blocked
+//	senders go.  An ack for nothing new may still bring more credit
+//	(it may be a window update).
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+void
+Transport::GotAck(Peer *peer, int ack, int credit)
+{
+    if ((ack < peer->sendBase) || (ack > peer->nextSeq))
+	return;				// old or bogus
+    while (peer->sendBase < ack)
+	peer->sent[peer->sendBase++ % MaxWindowSize].valid = FALSE;
+    peer->sendLimit = ack + credit;
+    windowOpen->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Transport::Credit
+// 	Return how many fragments a peer may send us past the next one
+//	we're waiting for: a full window, unless reassembled messages
+//	are piling up faster than they are Received.  Each fragment can
+//	finish at most one message, so giving out no more credit than
+//	there is room in the queue keeps it from growing past
+//	ReceiveQueueSize by more than the credit already handed out.
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+int
+Transport::Credit()
+{
+    return max(0, min(window, ReceiveQueueSize - numWaiting));
+}
+
+//----------------------------------------------------------------------
+// Transport::StartTimer
+// 	Arrange for the timer thread to check for lost fragments, unless
+//	it is already going to.  We check twice per RetransmitTimeout.
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+void
+Transport::StartTimer()
+{
+    if (timerPending)
+	return;
+    timerPending = TRUE;
+    interrupt->Schedule(TransportTimer, (int) this, retransmitTimeout / 2,
+			NetworkTimerInt);
+}
+
+//----------------------------------------------------------------------
+// Transport::TimerExpired
+// 	Interrupt handler: wake up the timer thread.
+//----------------------------------------------------------------------
+
+void
+Transport::TimerExpired()
+{
+    timerFired->V();
+}
+
+//----------------------------------------------------------------------
+// Transport::Retransmit
+// 	Loop forever: each time the timer goes off, resend every fragment
+//	that has gone RetransmitTimeout without an ack, and probe every
+//	peer we have nothing outstanding to, but are out of credit for.
+//	Set the timer again if there is anything left to wait for.  The
+//	fragments are copied out first, so we don't hold "lock" while
+//	sending.
+//----------------------------------------------------------------------
+
+void
+Transport::Retransmit()
+{
+    Fragment *resend = new Fragment[MaxPeers * window];
+    Peer **to = new Peer *[MaxPeers * window];
+    int *seqs = new int[MaxPeers * window];
+    Peer *probe[MaxPeers];
+    Fragment *frag;
+    Peer *peer;
+    int64_t now;
+    int i, seq, n, numProbe;
+
+    for (;;) {
+	timerFired->P();
+
+	lock->Acquire();
+	timerPending = FALSE;
+	now = stats->totalTicks;
+	n = numProbe = 0;
+	for (i = 0; i < MaxPeers; i++) {
+	    peer = peers[i];
+	    if (peer == NULL)
+		continue;
+	    if (peer->blocked && (peer->sendBase == peer->nextSeq))
+		probe[numProbe++] = peer;
+	    for (seq = peer->sendBase; seq < peer->nextSeq; seq++) {
+		frag = &peer->sent[seq % MaxWindowSize];
+		if (now - frag->sentAt < retransmitTimeout)
+		    continue;
+		frag->sentAt = now;
+		resend[n] = *frag;
+		to[n] = peer;
+		seqs[n] = seq;
+		n++;
+	    }
+	}
+	if (Outstanding() || WaitingForCredit())
+	    StartTimer();
+	lock->Release();
+
+	for (i = 0; i < numProbe; i++) {
+	    DEBUG('n', "Transport: probing (%d, %d) for credit\n",
+			probe[i]->machine, probe[i]->box);
+	    SendFragment(probe[i], ProbeFragment, probe[i]->nextSeq, FALSE,
+			NULL, 0, 0);
+	    numProbes++;
+	}
+
+	for (i = 0; i < n; i++) {
+	    DEBUG('n', "Transport: resending fragment %d to (%d, %d)\n",
+			seqs[i], to[i]->machine, to[i]->box);
+	    SendFragment(to[i], DataFragment, seqs[i], resend[i].last,
+			resend[i].data, resend[i].length, 0);
+	    numRetransmits++;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Transport::Print
+// 	Print how much work the transport has done.
+//----------------------------------------------------------------------
+
+void
+Transport::Print()
+{
+    printf("Transport: %d messages sent, %d received (%d bytes)\n",
+		numMessagesSent, numMessagesReceived, (int)bytesDelivered);
+    printf("Transport: %d fragments sent, %d retransmitted, %d acks sent, "
+		"%d duplicates\n", numFragmentsSent, numRetransmits,
+		numAcksSent, numDuplicates);
+    printf("Transport: %d fragments refused for lack of room, "
+		"%d window updates, %d probes\n", numRefused,
+		numWindowUpdates, numProbes);
+}
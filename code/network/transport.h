@@ -0,0 +1,182 @@
+// transport.h 
+//	Data structures for reliable, ordered delivery of messages of
+//	any size (up to MaxMessageSize) between mailboxes on different
+//	machines, on top of the unreliable Post Office.
+//
+//	A message is split into fragments that each fit in one piece of
+//	mail.  Each fragment carries a sequence number; the receiver
+//	acknowledges the highest sequence number up to which it has
+//	everything ("cumulative" acks), buffers fragments that arrive
+//	out of order, and reassembles messages.  The sender keeps up to
+//	a window's worth of fragments (WindowSize, unless the Transport
+//	is told otherwise) unacknowledged at once, and resends any
+//	fragment that hasn't been acknowledged after RetransmitTimeout.
+//
+//	The receiver also does flow control.  Each ack carries a
+//	"credit": how many fragments past the acked one the receiver is
+//	willing to take, given how many reassembled messages are waiting
+//	to be Received.  A sender never goes past the credit it was last
+//	given, so a slow receiver holds its senders back instead of
+//	piling up messages.  When a receiver that had run out of room
+//	frees some, it sends a fresh ack (a "window update"); in case
+//	that is lost, a sender that is out of credit sends a probe every
+//	so often, which is answered with an ack.
+//
+//	A Transport owns one Post Office mailbox; all of its traffic,
+//	data and acks, goes through that box.  The Transport it talks to
+//	is named by a machine and a mailbox number.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "post.h"
+#include "synch.h"
+#include "synchlist.h"
+
+#define WindowSize		8	// default unacknowledged fragments
+					// per peer
+#define MaxWindowSize		32	// largest window a Transport can use
+#define MaxPeers		8	// peers a Transport can talk to
+#define MaxMessageSize		1024	// largest message
+#define ReceiveQueueSize	16	// reassembled messages we let wait
+					// for Receive before refusing more
+
+// Our Post Office mailbox must hold a full window of data, and of
+// acks, from every peer.
+#define TransportBoxCapacity(window)	(2 * MaxPeers * (window))
+
+// Time to wait for an ack before sending a fragment again.  Sending
+// a packet takes NetworkTime, so this leaves room for a full window
+// to go out and come back acknowledged.
+#define RetransmitTimeout(window)	(int64_t)(4 * (window) * NetworkTime)
+
+enum FragmentType { DataFragment, AckFragment, ProbeFragment };
+
+// The following class defines the transport header, which goes at the
+// front of the mail data.  For data, "seq" is the fragment's sequence
+// number; for an ack, it is the sequence number of the next fragment
+// the receiver is waiting for, and "credit" says how many fragments
+// from there on it will accept.  A probe just asks for an ack.
+
+class TransportHeader {
+  public:
+    char type;			// DataFragment, AckFragment or ProbeFragment
+    char last;			// Is this the last fragment of a message?
+    short credit;		// For an ack: fragments we may send
+    int seq;
+};
+
+#define MaxFragmentSize		(MaxMailSize - sizeof(TransportHeader))
+
+// A fragment that has been sent but not yet acknowledged, or that has
+// been received but not yet delivered.
+
+class Fragment {
+  public:
+    bool valid;			// Is this slot in use?
+    bool last;			// Last fragment of its message?
+    int length;			// Bytes of data
+    int64_t sentAt;		// When it was last sent
+    char data[MaxMailSize];
+};
+
+// The state of a conversation with one remote Transport.  Fragments
+// are kept in "sent" and "received" at index seq % MaxWindowSize.
+
+class Peer {
+  public:
+    NetworkAddress machine;	// Where the other Transport is
+    MailBoxAddress box;
+
+    int sendBase;		// Oldest unacknowledged fragment
+    int nextSeq;		// Sequence number for the next fragment
+    int sendLimit;		// First fragment the peer hasn't given
+				// us credit for
+    bool blocked;		// Is a sender waiting for credit?
+    Fragment sent[MaxWindowSize];
+
+    int recvNext;		// Next fragment to deliver
+    int advertised;		// Credit sent in our last ack
+    Fragment received[MaxWindowSize];
+    char *message;		// Message being reassembled
+    int messageLength;
+};
+
+// A message that has been completely reassembled, waiting for Receive.
+
+class Message {
+  public:
+    NetworkAddress from;
+    MailBoxAddress fromBox;
+    int length;
+    char *data;
+};
+
+// The following class defines a reliable transport endpoint.
+
+class Transport {
+  public:
+    Transport(MailBoxAddress myBox, int windowSize);
+					// Use mailbox "myBox" of the Post
+					// Office, and keep up to
+					// "windowSize" fragments per peer
+					// in flight
+    ~Transport();
+
+    void Send(NetworkAddress to, MailBoxAddress toBox, char *data,
+		int length);		// Send a message; returns once all
+					// of it fits in the send window
+    int Receive(NetworkAddress *from, MailBoxAddress *fromBox,
+		char *data, int maxLength);
+					// Wait for the next message, and
+					// return its length
+    bool MessageWaiting();		// Would Receive return right away?
+    void Flush();			// Wait until everything sent has
+					// been acknowledged
+
+    void Print();			// Print statistics
+    int FragmentsSent() { return numFragmentsSent; }
+    int Retransmits() { return numRetransmits; }
+
+    void Deliver();			// Body of the thread that takes
+					// packets out of our mailbox
+    void Retransmit();			// Body of the thread that resends
+					// timed-out fragments
+    void TimerExpired();		// Interrupt handler for the
+					// retransmission timer
+
+  private:
+    MailBoxAddress box;			// Our mailbox
+    int window;				// Fragments in flight per peer
+    int64_t retransmitTimeout;		// RetransmitTimeout(window)
+    Peer *peers[MaxPeers];
+    Lock *lock;				// Protects everything below
+    Condition *windowOpen;		// Broadcast when acks arrive
+    SynchList *messages;		// Reassembled messages
+    int numWaiting;			// Messages not yet Received
+    Semaphore *timerFired;		// V'ed by TimerExpired
+    bool timerPending;			// Is the timer set?
+
+    int numFragmentsSent, numRetransmits, numAcksSent, numDuplicates;
+    int numMessagesSent, numMessagesReceived;
+    int numRefused, numWindowUpdates, numProbes;
+    int64_t bytesDelivered;
+
+    Peer *FindPeer(NetworkAddress peerMachine, MailBoxAddress peerBox);
+    void SendFragment(Peer *peer, int type, int seq, bool last,
+		char *data, int length, int credit);
+    void GotData(Peer *peer, TransportHeader *hdr, char *data, int length);
+    void GotAck(Peer *peer, int ack, int credit);
+    int Credit();			// Fragments we can take from a peer
+    void StartTimer();
+    bool Outstanding();			// Anything waiting for an ack?
+    bool WaitingForCredit();		// Any sender out of credit?
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,80 @@
+/* aiotest.c
+ *	Simple program to test the asynchronous I/O system calls.
+ *
+ *	Queues several writes to different parts of a file at once,
+ *	waits for them all, then reads the file back the same way.
+ */
+
+#include "syscall.h"
+
+#define RINGSIZE 8
+#define NUMREQS 4
+
+IoRequest sq[RINGSIZE];
+IoCompletion cq[RINGSIZE];
+IoRing ring;
+
+/* Queue one request at the tail of the submission ring */
+void queue(int op, int fd, char *buf, int len, int offset, int tag) {
+  IoRequest *r = &sq[ring.sqTail % RINGSIZE];
+
+    r->op = op;
+    r->fd = fd;
+    r->buf = buf;
+    r->len = len;
+    r->offset = offset;
+    r->tag = tag;
+    ring.sqTail++;
+}
+
+/* Submit everything queued, wait for all of it, and count failures */
+int runall(int n) {
+  int failed = 0;
+
+    IoEnter(n);
+    while (ring.cqHead != ring.cqTail) {
+	if (cq[ring.cqHead % RINGSIZE].result < 0)
+	    failed++;
+	ring.cqHead++;
+    }
+    return failed;
+}
+
+int main() {
+  OpenFileId fd;
+  char out[NUMREQS][8];
+  char in[NUMREQS][8];
+  int i, j;
+
+    ring.size = RINGSIZE;
+    ring.sqHead = ring.sqTail = 0;
+    ring.cqHead = ring.cqTail = 0;
+    ring.sq = sq;
+    ring.cq = cq;
+    if (IoSetup(&ring) == -1) {
+	PrintError("IoSetup failed\n", 15);
+	Exit(1);
+    }
+
+    Create("aiofile", 7);
+    fd = Open("aiofile", 7);
+
+    for (i = 0; i < NUMREQS; i++) {
+	for (j = 0; j < 7; j++)
+	    out[i][j] = 'a' + i;
+	out[i][7] = '\n';
+	queue(IoWrite, fd, out[i], 8, i * 8, i);
+    }
+    if (runall(NUMREQS) != 0)
+	PrintError("async write failed\n", 19);
+
+    for (i = 0; i < NUMREQS; i++)
+	queue(IoRead, fd, in[i], 8, i * 8, i);
+    if (runall(NUMREQS) != 0)
+	PrintError("async read failed\n", 18);
+
+    for (i = 0; i < NUMREQS; i++)
+	Write(in[i], 8, ConsoleOutput);	/* aaaaaaa, bbbbbbb, ... */
+    Close(fd);
+    Exit(0);
+}
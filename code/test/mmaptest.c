@@ -0,0 +1,39 @@
+/* mmaptest.c
+ *	Simple program to test the Mmap and Munmap system calls.
+ *
+ *	Writes a file, maps it, changes it through memory, and unmaps
+ *	it; then reads the file back to check the change made it to
+ *	disk.
+ */
+
+#include "syscall.h"
+
+int main() {
+  OpenFileId fd;
+  char *p;
+  char buf[40];
+  int i, bytesread;
+
+    Create("mmapfile", 8);
+    fd = Open("mmapfile", 8);
+    Write("mapped file before Munmap\n", 26, fd);
+
+    p = (char *) Mmap(fd, 0, 0);
+    if ((int) p == -1) {
+	PrintError("Mmap failed\n", 12);
+	Exit(1);
+    }
+
+    /* Each of these reads and writes is a page fault the first time */
+    Write(p, 26, ConsoleOutput);
+    for (i = 0; i < 6; i++)
+	p[i + 12] = "after "[i];
+    Munmap((int) p);
+    Close(fd);
+
+    fd = Open("mmapfile", 8);
+    bytesread = Read(buf, 40, fd);
+    Write(buf, bytesread, ConsoleOutput);	/* "mapped file after  Munmap" */
+    Close(fd);
+    Exit(0);
+}
@@ -0,0 +1,41 @@
+/* mvtest.c
+ *	Simple program to test monitor variables.
+ *
+ *	Bumps a shared counter and a per-machine slot under a shared
+ *	lock.  Run it on several machines against one lock server:
+ *		nachos -m 0 -server
+ *		nachos -m 1 -ls 0 -x ../test/mvtest
+ *		nachos -m 2 -ls 0 -x ../test/mvtest
+ *	and the last one to finish should see every increment.
+ */
+
+#include "syscall.h"
+
+#define NUMROUNDS 20
+
+int main() {
+  int lock, counter, i, value;
+
+    lock = CreateLock("mvtest lock", 11);
+    counter = CreateMV("mvtest counter", 14, 1);
+    if (lock == -1 || counter == -1) {
+	PrintError("mvtest: couldn't create lock or MV\n", 35);
+	Exit(1);
+    }
+
+    for (i = 0; i < NUMROUNDS; i++) {
+	AcquireLock(lock);
+	value = GetMV(counter, 0);
+	SetMV(counter, 0, value + 1);
+	ReleaseLock(lock);
+    }
+
+    /* A bad index is an error, not someone else's data */
+    if (GetMV(counter, 1) != -1)
+	PrintError("mvtest: GetMV past the end succeeded\n", 37);
+
+    AcquireLock(lock);
+    PrintfOne("mvtest: counter is %d\n", 22, GetMV(counter, 0));
+    ReleaseLock(lock);
+    Exit(0);
+}
@@ -0,0 +1,80 @@
+/* rwtest.c
+ *	Simple program to test reader-writer locks and barriers.
+ *
+ *	NUMTHREADS threads go through NUMPHASES phases, meeting at a
+ *	barrier after each one.  In every phase each thread reads a
+ *	shared table several times under the rwlock, yielding in the
+ *	middle of each read so the others can get in, and then adds one
+ *	to every entry under the rwlock held for writing.  A reader must
+ *	never see a table half updated, and after each phase the table
+ *	must hold exactly one update per thread per phase so far.
+ */
+
+#include "syscall.h"
+
+#define NUMTHREADS	4
+#define NUMPHASES	3
+#define NUMREADS	5
+#define TABLESIZE	8
+
+int rw, barrier;
+int table[TABLESIZE];
+int errors;
+
+void
+worker()
+{
+    int phase, i, j, first;
+
+    for (phase = 0; phase < NUMPHASES; phase++) {
+	for (i = 0; i < NUMREADS; i++) {
+	    AcquireRead(rw);
+	    first = table[0];
+	    Yield();
+	    for (j = 1; j < TABLESIZE; j++)
+		if (table[j] != first)
+		    errors++;
+	    ReleaseRead(rw);
+	}
+
+	AcquireWrite(rw);
+	for (j = 0; j < TABLESIZE; j++) {
+	    table[j]++;
+	    Yield();
+	}
+	ReleaseWrite(rw);
+
+	/* One thread checks the phase, while the others wait for the
+	 * next round of the barrier */
+	if (BarrierWait(barrier) == 1) {
+	    if (table[0] != (phase + 1) * NUMTHREADS)
+		errors++;
+	    PrintfTwo("rwtest: phase %d done, %d errors\n", 33, phase,
+			errors);
+	}
+	BarrierWait(barrier);
+    }
+    Exit(0);
+}
+
+int
+main()
+{
+    int i;
+
+    rw = CreateRWLock("rwtest table", 12);
+    barrier = CreateBarrier("rwtest phases", 13, NUMTHREADS);
+    if (rw == -1 || barrier == -1) {
+	PrintError("rwtest: couldn't create rwlock or barrier\n", 42);
+	Exit(1);
+    }
+
+    /* Bad indexes are errors */
+    if (AcquireRead(rw + 100) != -1 || ReleaseWrite(rw) != -1
+		|| BarrierWait(-1) != -1 || CreateBarrier("x", 1, 0) != -1)
+	PrintError("rwtest: bad arguments accepted\n", 31);
+
+    for (i = 0; i < NUMTHREADS; i++)
+	Fork("rwtest worker", 13, worker);
+    Exit(0);
+}
@@ -243,6 +243,150 @@ PrintfTwo:
 	j	$31
 	.end PrintfTwo
 
+	.globl Mmap
+	.ent	Mmap
+Mmap:
+	addiu $2,$0,SC_Mmap
+	syscall
+	j	$31
+	.end Mmap
+
+	.globl Munmap
+	.ent	Munmap
+Munmap:
+	addiu $2,$0,SC_Munmap
+	syscall
+	j	$31
+	.end Munmap
+
+	.globl IoSetup
+	.ent	IoSetup
+IoSetup:
+	addiu $2,$0,SC_IoSetup
+	syscall
+	j	$31
+	.end IoSetup
+
+	.globl IoEnter
+	.ent	IoEnter
+IoEnter:
+	addiu $2,$0,SC_IoEnter
+	syscall
+	j	$31
+	.end IoEnter
+
+	.globl CreateMV
+	.ent	CreateMV
+CreateMV:
+	addiu $2,$0,SC_CreateMV
+	syscall
+	j	$31
+	.end CreateMV
+
+	.globl GetMV
+	.ent	GetMV
+GetMV:
+	addiu $2,$0,SC_GetMV
+	syscall
+	j	$31
+	.end GetMV
+
+	.globl SetMV
+	.ent	SetMV
+SetMV:
+	addiu $2,$0,SC_SetMV
+	syscall
+	j	$31
+	.end SetMV
+
+	.globl DestroyMV
+	.ent	DestroyMV
+DestroyMV:
+	addiu $2,$0,SC_DestroyMV
+	syscall
+	j	$31
+	.end DestroyMV
+
+	.globl CreateRWLock
+	.ent	CreateRWLock
+CreateRWLock:
+	addiu $2,$0,SC_CreateRWLock
+	syscall
+	j	$31
+	.end CreateRWLock
+
+	.globl AcquireRead
+	.ent	AcquireRead
+AcquireRead:
+	addiu $2,$0,SC_AcquireRead
+	syscall
+	j	$31
+	.end AcquireRead
+
+	.globl ReleaseRead
+	.ent	ReleaseRead
+ReleaseRead:
+	addiu $2,$0,SC_ReleaseRead
+	syscall
+	j	$31
+	.end ReleaseRead
+
+	.globl AcquireWrite
+	.ent	AcquireWrite
+AcquireWrite:
+	addiu $2,$0,SC_AcquireWrite
+	syscall
+	j	$31
+	.end AcquireWrite
+
+	.globl ReleaseWrite
+	.ent	ReleaseWrite
+ReleaseWrite:
+	addiu $2,$0,SC_ReleaseWrite
+	syscall
+	j	$31
+	.end ReleaseWrite
+
+	.globl DestroyRWLock
+	.ent	DestroyRWLock
+DestroyRWLock:
+	addiu $2,$0,SC_DestroyRWLock
+	syscall
+	j	$31
+	.end DestroyRWLock
+
+	.globl CreateBarrier
+	.ent	CreateBarrier
+CreateBarrier:
+	addiu $2,$0,SC_CreateBarrier
+	syscall
+	j	$31
+	.end CreateBarrier
+
+	.globl BarrierWait
+	.ent	BarrierWait
+BarrierWait:
+	addiu $2,$0,SC_BarrierWait
+	syscall
+	j	$31
+	.end BarrierWait
+
+	.globl DestroyBarrier
+	.ent	DestroyBarrier
+DestroyBarrier:
+	addiu $2,$0,SC_DestroyBarrier
+	syscall
+	j	$31
+	.end DestroyBarrier
+
+	.globl SyscallStats
+	.ent	SyscallStats
+SyscallStats:
+	addiu $2,$0,SC_SyscallStats
+	syscall
+	j	$31
+	.end SyscallStats
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,54 @@
+/* sysstats.c
+ *	Simple program to test the syscall statistics.
+ *
+ *	NUMTHREADS threads take turns at one lock NUMROUNDS times each,
+ *	yielding while they hold it so the others have to wait.  The
+ *	last one done prints the statistics with SyscallStats, and then
+ *	halts, which prints them again: AcquireLock should show up with
+ *	NUMTHREADS * NUMROUNDS calls, and with waits far longer than
+ *	those of ReleaseLock.
+ */
+
+#include "syscall.h"
+
+#define NUMTHREADS	4
+#define NUMROUNDS	10
+
+int lock;
+int done;
+
+void
+worker()
+{
+    int i, last;
+
+    for (i = 0; i < NUMROUNDS; i++) {
+	AcquireLock(lock);
+	Yield();
+	ReleaseLock(lock);
+    }
+
+    AcquireLock(lock);
+    last = (++done == NUMTHREADS);
+    ReleaseLock(lock);
+    if (last) {
+	SyscallStats();
+	Halt();
+    }
+    Exit(0);
+}
+
+int
+main()
+{
+    int i;
+
+    lock = CreateLock("sysstats lock", 13);
+    if (lock == -1) {
+	PrintError("sysstats: couldn't create lock\n", 31);
+	Exit(1);
+    }
+    for (i = 0; i < NUMTHREADS; i++)
+	Fork("sysstats worker", 15, worker);
+    Exit(0);
+}
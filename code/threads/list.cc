@@ -160,6 +160,70 @@ List::IsEmpty()
 	return FALSE; 
 }
 
+//----------------------------------------------------------------------
+// List::Front
+//      Return the first item on the list, without removing it.
+// 
+// Returns:
+//	The first item, NULL if nothing on the list.
+//----------------------------------------------------------------------
+
+void *
+List::Front()
+{
+    if (IsEmpty())
+	return NULL;
+    return first->item;
+}
+
+//----------------------------------------------------------------------
+// List::RemoveItem
+//      Take "item" off the list, wherever it is on it, keeping the
+//	rest of the list in order.  Used to move an item whose sort key
+//	has changed.
+//
+//	"item" is the thing to take off the list.
+//
+// Returns:
+//	TRUE if "item" was on the list.
+//----------------------------------------------------------------------
+
+bool
+List::RemoveItem(void *item)
+{
+    ListElement *prev = NULL;
+    ListElement *ptr;
+
+    for (ptr = first; ptr != NULL; prev = ptr, ptr = ptr->next)
+	if (ptr->item == item)
+	    break;
+    if (ptr == NULL)
+	return FALSE;
+
+    if (prev == NULL)
+	first = ptr->next;
+    else
+	prev->next = ptr->next;
+    if (last == ptr)
+	last = prev;
+    delete ptr;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// List::Contains
+//      Returns TRUE if "item" is on the list.
+//----------------------------------------------------------------------
+
+bool
+List::Contains(void *item)
+{
+    for (ListElement *ptr = first; ptr != NULL; ptr = ptr->next)
+	if (ptr->item == item)
+	    return TRUE;
+    return FALSE;
+}
+
 //----------------------------------------------------------------------
 // List::SortedInsert
 //      Insert an "item" into a list, so that the list elements are
@@ -52,6 +52,10 @@ class List {
     void Mapcar(VoidFunctionPtr func);	// Apply "func" to every element 
 					// on the list
     bool IsEmpty();		// is the list empty? 
+    void *Front();		// first item, left on the list
+    bool RemoveItem(void *item);	// Take "item" off the list, wherever
+					// it is; FALSE if it isn't there
+    bool Contains(void *item);		// is "item" on the list?
     
 
     // Routines to put/get items on/off list in order (sorted by key)
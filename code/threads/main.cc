@@ -9,27 +9,45 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-s -x <nachos file> -prof <ticks> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-p <nachos file> -r <nachos file> -mkdir <nachos dir>
+//		-l -D -t
 //              -n <network reliability> -m <machine id>
-//              -o <other machine id>
-//              -z
+//              -o <other machine id> -ot <other machine id>
+//              -server -ls <server machine id> -mvb <threads>
+//              -nb <nodes> <message size> <window>
+//              -txq <transmit queue depth>
+//              -aq -qb -pri -pt -acct <file> -trace <file> -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -aq time-slices with a quantum that shrinks as more threads are
+//	ready, and no timer interrupts while no other thread is ready
+//    -qb compares the cost of passing items through a SynchList and
+//	a SynchRing
+//    -pri schedules threads by priority, with priority inheritance
+//	through Locks
+//    -pt runs a priority inversion test (needs -pri)
+//    -acct writes each thread's and process's statistics to a file,
+//	as CSV, at the end
+//    -trace records context switches, syscalls, interrupts and I/O,
+//	and writes them to a file as Chrome trace JSON at the end
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
+//    -prof samples the user program's PC every so many instructions,
+//	and prints a profile by procedure when it exits
 //    -c tests the console
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
+//    -r removes a Nachos file (or empty directory) from the file system
+//    -mkdir creates a Nachos directory
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system 
 //    -t tests the performance of the Nachos file system
@@ -37,7 +55,17 @@
 //  NETWORK
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
+//    -txq sets how many packets the network can be sending at once
 //    -o runs a simple test of the Nachos network software
+//    -ot runs a test of the reliable transport, printing its goodput
+//    -server makes this machine a lock server, and never returns
+//    -ls sends user programs' Lock and Condition syscalls to the
+//	lock server on the given machine
+//    -mvb measures the lock server with the given number of threads
+//	(needs -ls)
+//    -nb benchmarks the network, as one of a ring of <nodes> machines
+//	echoing messages of <message size> bytes over a Transport with
+//	the given window (see network/netbench.sh)
 //
 //  NOTE -- flags are ignored until the relevant assignment.
 //  Some of the flags are interpreted here; some in system.cc.
@@ -57,9 +85,13 @@
 // External functions used by this file
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
+extern void QueueBenchmark(void);
+extern void PriorityTest(void);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
-extern void MailTest(int networkID);
+extern void MailTest(int networkID), TransportTest(int networkID);
+extern void MVBenchmark(int numThreads);
+extern void NetBenchmark(int numNodes, int size, int window);
 #ifdef THREADS
 extern void Part2(void), TestSuite(void), Test2(void), Test1(void), Test3(void), Test4(void), Test5(void), Test7(void);
 #endif //THREADS
@@ -95,6 +127,10 @@ main(int argc, char **argv)
 	argCount = 1;
         if (!strcmp(*argv, "-z"))               // print copyright
             printf (copyright);
+        if (!strcmp(*argv, "-qb"))              // queue benchmark
+            QueueBenchmark();
+        if (!strcmp(*argv, "-pt"))              // priority inversion test
+            PriorityTest();
 #ifdef THREADS
         if (!strcmp(*argv, "-T")) 
         	            // Test Suite
@@ -147,6 +183,10 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    fileSystem->Remove(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-mkdir")) {	// make Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->MakeDirectory(*(argv + 1));
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
             fileSystem->List();
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
@@ -163,6 +203,27 @@ main(int argc, char **argv)
 						// start up another nachos
             MailTest(atoi(*(argv + 1)));
             argCount = 2;
+        } else if (!strcmp(*argv, "-ot")) {
+	    ASSERT(argc > 1);
+            Delay(2); 				// delay for 2 seconds
+						// to give the user time to 
+						// start up another nachos
+            TransportTest(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-server")) {
+            (new LockServer)->Run();
+        } else if (!strcmp(*argv, "-mvb")) {
+	    ASSERT(argc > 1);
+            Delay(2); 				// give the server time to start
+            MVBenchmark(atoi(*(argv + 1)));
+            argCount = 2;
+        } else if (!strcmp(*argv, "-nb")) {
+	    ASSERT(argc > 3);
+            Delay(2); 				// give the other nodes time
+						// to start
+            NetBenchmark(atoi(*(argv + 1)), atoi(*(argv + 2)),
+			atoi(*(argv + 3)));
+            argCount = 4;
         }
 #endif // NETWORK*/
     }
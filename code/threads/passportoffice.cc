@@ -292,8 +292,7 @@ void ApplicationClerkToCustomer(int lineNumber)
     // do my job - customer nowwaiting
     currentThread->Yield();
     FilingJob * applicationFiling = new FilingJob(appClerkData[lineNumber].currentCustomer, lineNumber);
-    Thread * t = new Thread("ApplicationFilingThread");
-    t->Fork((VoidFunctionPtr)fileApplication, (int)applicationFiling); //think about where this should go!
+    kernelWork->Submit((VoidFunctionPtr)fileApplication, (int)applicationFiling);
     appClerkCV[lineNumber]->Signal(appClerkLock[lineNumber]);
     appClerkData[lineNumber].currentCustomer = -1; //set current customer back to -1
     appClerkCV[lineNumber]->Wait(appClerkLock[lineNumber]);
@@ -407,8 +406,7 @@ void CustomerToPictureClerk(int ssn, int myLine)
         printf(GREEN  "Customer %d does like their picture from PictureClerk %d."  ANSI_COLOR_RESET  "\n", ssn, myLine);
         currentThread->Yield();
         FilingJob * pictureFiling = new FilingJob(ssn, myLine);
-        Thread * t = new Thread("PictureFilingThread");
-        t->Fork((VoidFunctionPtr)filePicture, (int)pictureFiling);
+        kernelWork->Submit((VoidFunctionPtr)filePicture, (int)pictureFiling);
         
         int filingTime = (rand() % 80) + 20;
         for (int i = 0; i < filingTime; i++) { currentThread->Yield(); }
@@ -583,11 +581,8 @@ void CustomerToPassportClerk(int ssn, int myLine)
     // TODO: Move the job creation below inside of Passport Clerk
 
     // Create a FilingJob in the system for certifying the Customer's passport.
-    char * name = new char [40];
-    sprintf(name, "PassportCertifyingThread-PC%d-C%d", myLine, ssn);
-    Thread * t = new Thread(name);
     FilingJob * passportCertifyingJob = new FilingJob(ssn, myLine);
-    t->Fork((VoidFunctionPtr)certifyPassport, (int)passportCertifyingJob); //think about where this should go!
+    kernelWork->Submit((VoidFunctionPtr)certifyPassport, (int)passportCertifyingJob);
 
     passportClerkCV[myLine]->Signal(passportClerkLock[myLine]); //leaving
     passportClerkLock[myLine]->Release();
@@ -11,8 +11,10 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Very simple implementation -- straight FIFO, unless priority
+//	scheduling is turned on ("-pri"), in which case the ready list is
+//	kept in order of priority, most urgent first, and FIFO among
+//	threads of the same priority.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -30,6 +32,7 @@
 Scheduler::Scheduler()
 { 
     readyList = new List; 
+    numReady = 0;
 } 
 
 //----------------------------------------------------------------------
@@ -56,7 +59,28 @@ Scheduler::ReadyToRun (Thread *thread)
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+    if (priorityScheduling)
+	readyList->SortedInsert((void *)thread, -thread->getPriority());
+    else
+	readyList->Append((void *)thread);
+    numReady++;
+    if (timer != NULL)			// someone to switch to now, so an
+	timer->Start();			// adaptive timer has to run
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Reorder
+// 	Move a thread on the ready list to the place its new priority
+//	calls for.
+//
+//	"thread" is the thread whose priority has changed.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Reorder (Thread *thread)
+{
+    if (priorityScheduling && readyList->RemoveItem((void *)thread))
+	readyList->SortedInsert((void *)thread, -thread->getPriority());
 }
 
 //----------------------------------------------------------------------
@@ -70,7 +94,23 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    Thread *thread = (Thread *)readyList->Remove();
+
+    if (thread != NULL)
+	numReady--;
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Peek
+// 	Return the thread FindNextToRun would return, without taking it
+//	off the ready list.  NULL if there are no ready threads.
+//----------------------------------------------------------------------
+
+Thread *
+Scheduler::Peek ()
+{
+    return (Thread *)readyList->Front();
 }
 
 //----------------------------------------------------------------------
@@ -102,7 +142,10 @@ Scheduler::Run (Thread *nextThread)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    stats->numContextSwitches++;
+    nextThread->account->numContextSwitches++;
     currentThread = nextThread;		    // switch to the next thread
+    TRACE(TraceSwitch, 0);
     currentThread->setStatus(RUNNING);      // nextThread is now running
     
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
@@ -25,12 +25,18 @@ class Scheduler {
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
     Thread* FindNextToRun();		// Dequeue first thread on the ready 
 					// list, if any, and return thread.
+    Thread* Peek();			// First thread on the ready list,
+					// left there
+    int NumReady() { return numReady; }	// Threads on the ready list
+    void Reorder(Thread* thread);	// Move a ready thread whose priority
+					// has changed
     void Run(Thread* nextThread);	// Cause nextThread to start running
     void Print();			// Print contents of ready list
     
   private:
     List *readyList;  		// queue of threads that are ready to run,
 				// but not running
+    int numReady;		// how many there are
 };
 
 #endif // SCHEDULER_H
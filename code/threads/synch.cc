@@ -132,6 +132,14 @@ Lock::~Lock()
 {
      delete sleepqueue;
 }
+//----------------------------------------------------------------------
+// Lock::Acquire
+//  Wait until the lock is FREE, then take it.  A thread that has to
+//  wait is handed the lock by Release (or moved onto our queue by
+//  Condition::Signal), so it already owns the lock when it wakes up,
+//  and doesn't have to contend for it again.
+//----------------------------------------------------------------------
+
 void Lock::Acquire()
 {
     if (debuggingLocks) printf(YELLOW  "[Lock::Acquire] (%s) %s called acquire."  ANSI_COLOR_RESET  "\n", name, currentThread->getName());
@@ -139,7 +147,6 @@ void Lock::Acquire()
     IntStatus old = interrupt->SetLevel(IntOff);
     if (isHeldByCurrentThread())
     {  
-        //printf("[Lock::Acquire] CurrentThread is already the lock owner. \n");    
         //check if the thread that is trying to acquire the lock already owns it
         (void*) interrupt->SetLevel(old); //restore interrupts
         return;
@@ -147,24 +154,32 @@ void Lock::Acquire()
     if (!lockOwner)
     {
         //I can have it, make state busy, make myself the lock owner
-        lockOwner=currentThread; //i am the lock owner
-        state = 1; //set the lock state to busy
+        GiveTo(currentThread); //i am the lock owner, and the lock is busy
         if (debuggingLocks) printf(YELLOW  "[Lock::Acquire] (%s) %s acquired the lock."   ANSI_COLOR_RESET "\n", name, lockOwner->getName());
     }
     else 
     {
         if (debuggingLocks) printf(YELLOW  "[Lock::Acquire] (%s) %s is trying to acquire a lock already owned by %s. %s is being put on lock's queue."  ANSI_COLOR_RESET  "\n", name, currentThread->getName(), lockOwner->getName(), currentThread->getName());
         
-        sleepqueue->Append((void *)currentThread); //put current thread on lock’s wait Q
+        int64_t waitStart = stats->totalTicks;
+        stats->numLockWaits++;
+        AddWaiter(currentThread); //put current thread on lock’s wait Q
         currentThread->Sleep();
-        old = interrupt->SetLevel(IntOff);
-        this->Acquire();
-
+        currentThread->account->numLockWaits++;
+        currentThread->account->lockWaitTicks += stats->totalTicks - waitStart;
+        ASSERT(lockOwner == currentThread); // Release handed it to us
     }
     (void*) interrupt->SetLevel(old); //end of acquire
-    //printf("lock owner is: %s\n", currentThread->getName());
     return;
 }
+
+//----------------------------------------------------------------------
+// Lock::Release
+//  Give up the lock.  If anyone is waiting, hand it straight to the
+//  first waiter: the lock stays BUSY, so nobody can barge in ahead of
+//  the thread we wake up.
+//----------------------------------------------------------------------
+
 void Lock::Release() 
 {
     if (debuggingLocks) printf(YELLOW  "[Lock::Release] (%s) %s called release."  ANSI_COLOR_RESET  "\n", name, currentThread->getName());
@@ -173,25 +188,138 @@ void Lock::Release()
     
     if(!isHeldByCurrentThread())
     {
-        if (debuggingLocks || debuggingLockErrors) printf(RED  "[Lock::Release] (%s) ERROR: %s is trying to release a lock owned by %s. Returning."  ANSI_COLOR_RESET  "\n", name, currentThread->getName(), lockOwner->getName());
+        if (debuggingLocks || debuggingLockErrors) printf(RED  "[Lock::Release] (%s) ERROR: %s is trying to release a lock owned by %s. Returning."  ANSI_COLOR_RESET  "\n", name, currentThread->getName(), lockOwner ? lockOwner->getName() : "nobody");
         interrupt->SetLevel(oldLevel);
 
         return;
     }
-    if(isHeldByCurrentThread()) //if current thread is lockowner
+
+    if (debuggingLocks) printf(YELLOW  "[Lock::Release] (%s) %s released the lock."  ANSI_COLOR_RESET  "\n", name, currentThread->getName());
+
+    Thread * newThread = (Thread *) sleepqueue->Remove(); //get the next thread that is asleep
+    if (priorityScheduling)
+        currentThread->locksHeld->RemoveItem((void *)this);
+    if(newThread != NULL) //hand the lock over; it stays busy
+    {
+        GiveTo(newThread);
+        stats->numLockHandoffs++;
+        scheduler->ReadyToRun(newThread); //put it in the scheduler.
+    }
+    else
     {
-        if (debuggingLocks) printf(YELLOW  "[Lock::Release] (%s) %s released the lock."  ANSI_COLOR_RESET  "\n", name, currentThread->getName());
-        
         state = 0;//free the lock
         lockOwner = NULL;//return lockOwner to NULL
-        Thread * newThread = (Thread *) sleepqueue->Remove(); //get the next thread that is asleep
-        
-        if(newThread != NULL) //if the next thread isn't null
-        {
-            scheduler->ReadyToRun(newThread); //put it in the scheduler.
-        }
-  }
+    }
+
+    // Give back whatever the waiters for this lock donated to us; if
+    // that leaves the new owner more urgent than we are, let it run
+    bool yield = FALSE;
+    if (priorityScheduling)
+    {
+        currentThread->RecomputePriority();
+        yield = (newThread != NULL) &&
+            (newThread->getPriority() > currentThread->getPriority());
+    }
     interrupt->SetLevel(oldLevel);
+    if (yield && oldLevel == IntOn)
+        currentThread->Yield();
+}
+
+//----------------------------------------------------------------------
+// Lock::Enqueue
+//  Make "thread", which is asleep, wait for the lock as if it had
+//  called Acquire; used by Condition::Signal.  If the lock is free,
+//  the thread gets it now.  Interrupts must be off.
+//----------------------------------------------------------------------
+
+void Lock::Enqueue(Thread *thread)
+{
+    ASSERT(interrupt->getLevel() == IntOff);
+    if (!lockOwner)
+    {
+        GiveTo(thread);
+        scheduler->ReadyToRun(thread);
+    }
+    else
+        AddWaiter(thread);
+}
+
+//----------------------------------------------------------------------
+// Lock::AddWaiter
+//  Put "thread" on the queue for the lock, which is BUSY.  With
+//  priority scheduling, the queue is kept most urgent first, and
+//  the thread lends its priority to the owner if the owner is less
+//  urgent -- and on along the chain, if the owner is itself waiting
+//  for a lock, so whatever holds us up runs at our priority.  The
+//  time from here until the thread gets the lock is counted as a
+//  priority inversion.  Interrupts must be off.
+//----------------------------------------------------------------------
+
+void Lock::AddWaiter(Thread *thread)
+{
+    ASSERT(interrupt->getLevel() == IntOff && lockOwner != NULL);
+    thread->waitingFor = this;
+    if (!priorityScheduling)
+    {
+        sleepqueue->Append((void *)thread);
+        return;
+    }
+    sleepqueue->SortedInsert((void *)thread, -thread->getPriority());
+    if (lockOwner->getPriority() < thread->getPriority())
+        thread->inversionStart = stats->totalTicks;
+
+    Lock *lock = this;
+    while (lock != NULL && lock->lockOwner != NULL &&
+           lock->lockOwner->getPriority() < thread->getPriority())
+    {
+        Thread *owner = lock->lockOwner;
+        DEBUG('t', "%s lends priority %d to %s, holder of %s\n",
+              thread->getName(), thread->getPriority(), owner->getName(),
+              lock->getName());
+        owner->setEffectivePriority(thread->getPriority());
+        lock = owner->waitingFor;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::GiveTo
+//  Make "thread" the owner of the lock, ending any priority inversion
+//  it was waiting out.  The thread needs no priority from the waiters
+//  left on the queue, since it was ahead of all of them.  Interrupts
+//  must be off.
+//----------------------------------------------------------------------
+
+void Lock::GiveTo(Thread *thread)
+{
+    lockOwner = thread;
+    state = 1;
+    thread->waitingFor = NULL;
+    if (!priorityScheduling)
+        return;
+    thread->locksHeld->Append((void *)this);
+    if (thread->inversionStart >= 0)
+    {
+        int64_t ticks = stats->totalTicks - thread->inversionStart;
+
+        stats->numInversions++;
+        stats->inversionTicks += ticks;
+        if (ticks > stats->maxInversionTicks)
+            stats->maxInversionTicks = ticks;
+        thread->inversionStart = -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::Reorder
+//  "thread", waiting for the lock, has had its priority changed;
+//  move it to its new place in the queue.  Interrupts must be off.
+//----------------------------------------------------------------------
+
+void Lock::Reorder(Thread *thread)
+{
+    ASSERT(interrupt->getLevel() == IntOff);
+    if (priorityScheduling && sleepqueue->RemoveItem((void *)thread))
+        sleepqueue->SortedInsert((void *)thread, -thread->getPriority());
 }
 
 bool Lock::isHeldByCurrentThread()
@@ -241,7 +369,9 @@ void Condition::Wait(Lock * conditionLock)
     conditionLock->Release(); //release condition lock
     waitqueue->Append((void*) currentThread); //add current thread to wait queue
     currentThread->Sleep(); //put current thread to sleep
-    conditionLock->Acquire(); //acquire condition lock
+    // Signal moved us onto the lock's queue, and we were woken up with
+    // the lock handed to us
+    ASSERT(conditionLock->isHeldByCurrentThread());
     interrupt->SetLevel(oldLevel); //enable interrupts
 } 
 void Condition::Signal(Lock * conditionLock)
@@ -272,17 +402,16 @@ void Condition::Signal(Lock * conditionLock)
         return;
     }
 
+    // Rather than waking the waiter only for it to wait again for the
+    // lock we hold, move it straight onto the lock's queue
     Thread *next = (Thread *)waitqueue->Remove();
-    if(next!=NULL) //while waitqueue isn't empty
-    {
-        if (debuggingCVs) printf(BLUE  "[Condition::Signal] (%s) %s signalled %s."  ANSI_COLOR_RESET  "\n", name, currentThread->getName(), next->getName());
-        scheduler->ReadyToRun(next);
-        interrupt->SetLevel(oldLevel);
-    }
+    if (debuggingCVs) printf(BLUE  "[Condition::Signal] (%s) %s signalled %s."  ANSI_COLOR_RESET  "\n", name, currentThread->getName(), next->getName());
+    conditionLock->Enqueue(next);
     if(waitqueue->IsEmpty())
     {
         waitingLock = NULL;
     }
+    interrupt->SetLevel(oldLevel);
 } 
 void Condition::Broadcast(Lock* conditionLock)
 {
@@ -305,9 +434,236 @@ void Condition::Broadcast(Lock* conditionLock)
         interrupt->SetLevel(oldLevel);//restore interrupts
         return;
     }
+    // Move every waiter onto the lock's queue; they get the lock one
+    // at a time as it is released, instead of all waking up to fight
+    // over it
+    Thread *next;
+    while((next = (Thread *)waitqueue->Remove()) != NULL) {
+        if (debuggingCVs) printf(BLUE  "[Condition::Broadcast] (%s) %s is signalling %s."  ANSI_COLOR_RESET  "\n", name, currentThread->getName(), next->getName());
+        conditionLock->Enqueue(next);
+    }
+    waitingLock = NULL;
     interrupt->SetLevel(oldLevel);
-    while(!waitqueue->IsEmpty()) {
-        if (debuggingCVs) printf(BLUE  "[Condition::Broadcast] (%s) %s is signalling another thread."  ANSI_COLOR_RESET  "\n", name, currentThread->getName());
-        Signal(conditionLock);
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a reader-writer lock, so that it can be used for
+//	synchronization.  Nobody holds it to begin with.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    numReaders = 0;
+    readers = new List;
+    writer = NULL;
+    waitingReaders = new List;
+    waitingWriters = new List;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	De-allocate the lock, when no one is using it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    ASSERT(!isBusy());
+    delete readers;
+    delete waitingReaders;
+    delete waitingWriters;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Hold the lock for reading.  Wait if a writer holds it, or is
+//	waiting for it.
+//
+//	A waiting reader is counted in by ReleaseWrite before it is
+//	woken, so when it runs again it already holds the lock.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if ((writer == NULL) && waitingWriters->IsEmpty()) {
+	numReaders++;
+	readers->Append((void *)currentThread);
+    } else {
+	waitingReaders->Append((void *)currentThread);
+	currentThread->Sleep();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	Give up a hold for reading, which the current thread must have.
+//	The last reader out hands the lock to the first waiting writer.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseRead()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool held;
+
+    ASSERT((numReaders > 0) && (writer == NULL));
+    held = readers->RemoveItem((void *)currentThread);
+    ASSERT(held);
+    numReaders--;
+    if ((numReaders == 0) && !waitingWriters->IsEmpty()) {
+	writer = (Thread *) waitingWriters->Remove();
+	scheduler->ReadyToRun(writer);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Hold the lock for writing.  Wait until nobody else holds it.
+//
+//	As with readers, the lock is handed to a waiting writer before it
+//	is woken.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(writer != currentThread);
+    if ((writer == NULL) && (numReaders == 0))
+	writer = currentThread;
+    else {
+	waitingWriters->Append((void *)currentThread);
+	currentThread->Sleep();
+	ASSERT(writer == currentThread);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	Give up a hold for writing.  If readers are waiting, let all of
+//	them in at once; otherwise hand the lock to the next writer.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseWrite()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Thread *thread;
+
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    if (!waitingReaders->IsEmpty()) {
+	while ((thread = (Thread *) waitingReaders->Remove()) != NULL) {
+	    numReaders++;
+	    readers->Append((void *)thread);
+	    scheduler->ReadyToRun(thread);
+	}
+    } else if (!waitingWriters->IsEmpty()) {
+	writer = (Thread *) waitingWriters->Remove();
+	scheduler->ReadyToRun(writer);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::isWriteHeldByCurrentThread
+// 	Return TRUE if the current thread holds the lock for writing.
+//----------------------------------------------------------------------
+
+bool
+RWLock::isWriteHeldByCurrentThread()
+{
+    return writer == currentThread;
+}
+
+//----------------------------------------------------------------------
+// RWLock::isReadHeldByCurrentThread
+// 	Return TRUE if the current thread holds the lock for reading.
+//----------------------------------------------------------------------
+
+bool
+RWLock::isReadHeldByCurrentThread()
+{
+    return readers->Contains((void *)currentThread);
+}
+
+//----------------------------------------------------------------------
+// RWLock::isBusy
+// 	Return TRUE if anyone holds the lock, or is waiting for it.
+//----------------------------------------------------------------------
+
+bool
+RWLock::isBusy()
+{
+    return (numReaders > 0) || (writer != NULL)
+	|| !waitingReaders->IsEmpty() || !waitingWriters->IsEmpty();
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier for "numThreads" threads.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"numThreads" is how many threads must arrive before any can go on.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(char* debugName, int numThreads)
+{
+    ASSERT(numThreads > 0);
+    name = debugName;
+    count = numThreads;
+    numArrived = 0;
+    waiting = new List;
+}
+
+//----------------------------------------------------------------------
+// Barrier::~Barrier
+// 	De-allocate the barrier, when no one is waiting at it.
+//----------------------------------------------------------------------
+
+Barrier::~Barrier()
+{
+    ASSERT(!isBusy());
+    delete waiting;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Wait until "count" threads have arrived.  The last to arrive
+//	wakes up the others, and starts the next round.
+//
+//	Returns TRUE in the last thread to arrive, so that exactly one
+//	thread can do any work that goes between rounds.
+//----------------------------------------------------------------------
+
+bool
+Barrier::Wait()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Thread *thread;
+    bool last;
+
+    numArrived++;
+    if (numArrived == count) {
+	while ((thread = (Thread *) waiting->Remove()) != NULL)
+	    scheduler->ReadyToRun(thread);
+	numArrived = 0;
+	last = TRUE;
+    } else {
+	waiting->Append((void *)currentThread);
+	currentThread->Sleep();
+	last = FALSE;
     }
+    (void) interrupt->SetLevel(oldLevel);
+    return last;
 }
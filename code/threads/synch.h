@@ -2,7 +2,8 @@
 //	Data structures for synchronizing threads.
 //
 //	Three kinds of synchronization are defined here: semaphores,
-//	locks, and condition variables.  The implementation for
+//	locks, and condition variables; reader-writer locks and
+//	barriers are built the same way.  The implementation for
 //	semaphores is given; for the latter two, only the procedure
 //	interface is given -- they are to be implemented as part of 
 //	the first assignment.
@@ -78,6 +79,11 @@ class Lock {
 					// holds this lock.  Useful for
 					// checking in Release, and in
 					// Condition variable ops below.
+    void Enqueue(Thread *thread);	// make a sleeping thread wait for
+					// the lock; for Condition::Signal
+    Thread *FirstWaiter() { return (Thread *) sleepqueue->Front(); }
+    void Reorder(Thread *thread);	// move a waiter whose priority
+					// has changed
     List *sleepqueue;
     bool state; //0=free, 1=busy
 
@@ -88,6 +94,10 @@ class Lock {
     // Thread *lockOwner;
     Thread *lockOwner;
     bool isHeldBySomeOne;
+
+    void AddWaiter(Thread *thread);	// queue a thread for the lock,
+					// donating its priority
+    void GiveTo(Thread *thread);	// make a thread the owner
 };
 
 // The following class defines a "condition variable".  A condition
@@ -146,4 +156,69 @@ class Condition {
     // plus some other stuff you'll need to define
 
 };
+
+// The following class defines a "reader-writer lock".  Any number of
+// readers may hold it at once, or a single writer:
+//
+//	AcquireRead -- wait until no writer holds or is waiting for the
+//		lock, then hold it for reading
+//
+//	AcquireWrite -- wait until nobody holds the lock, then hold it
+//		for writing
+//
+// Writers are preferred: once a writer is waiting, readers that come
+// along wait behind it, so a stream of readers can't keep writers out
+// forever.  When a writer releases the lock, every reader waiting at
+// that point is let in together, before the next writer, so writers
+// can't keep readers out either.
+//
+// The lock is handed directly to the threads it wakes up; a woken
+// thread holds the lock as soon as it runs.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);		// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void AcquireRead();
+    void ReleaseRead();
+    void AcquireWrite();
+    void ReleaseWrite();
+    bool isWriteHeldByCurrentThread();
+    bool isReadHeldByCurrentThread();
+    bool isBusy();			// held, or anyone waiting?
+
+  private:
+    char* name;				// for debugging
+    int numReaders;			// readers holding the lock
+    List *readers;			// which they are, once for each
+					// hold
+    Thread *writer;			// writer holding the lock, if any
+    List *waitingReaders;		// threads waiting in AcquireRead
+    List *waitingWriters;		// threads waiting in AcquireWrite
+};
+
+// The following class defines a "barrier" for a fixed number of threads.
+// Each thread calls Wait when it reaches the barrier, and waits there
+// until all "count" threads have arrived; then they all go on.  The
+// barrier is then ready for the next round.
+
+class Barrier {
+  public:
+    Barrier(char* debugName, int numThreads);
+					// barrier for "numThreads" threads
+    ~Barrier();
+    char* getName() { return name; }
+
+    bool Wait();			// returns TRUE in the last thread
+					// to arrive, FALSE in the others
+    bool isBusy() { return numArrived > 0; }	// anyone waiting?
+
+  private:
+    char* name;
+    int count;				// threads that must arrive
+    int numArrived;			// threads waiting this round
+    List *waiting;
+};
 #endif // SYNCH_H
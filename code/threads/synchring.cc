@@ -0,0 +1,135 @@
+// synchring.cc
+//	Routines for a bounded queue between one producer thread and
+//	one consumer thread.
+//
+//	The producer fills in a slot before it moves "tail" past it, and
+//	the consumer takes an item out before it moves "head" past it, so
+//	each side only ever sees slots the other is done with.
+//
+//	The one place the two have to agree is when the ring is empty:
+//	the consumer records itself in "waiter" and sleeps, with
+//	interrupts off from the time it last looks at "tail", so an item
+//	can't be appended in between without the producer seeing
+//	"waiter" and waking it up.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchring.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// SynchRing::SynchRing
+// 	Initialize an empty ring with room for "size" items.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"size" is the most items the ring can hold at once.
+//----------------------------------------------------------------------
+
+SynchRing::SynchRing(char *debugName, int size)
+{
+    ASSERT(size > 0);
+    name = debugName;
+    numSlots = size + 1;
+    items = new void *[numSlots];
+    head = tail = 0;
+    waiter = NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchRing::~SynchRing
+// 	De-allocate the ring.  Nobody may be waiting on it.
+//----------------------------------------------------------------------
+
+SynchRing::~SynchRing()
+{
+    ASSERT(waiter == NULL);
+    delete [] items;
+}
+
+//----------------------------------------------------------------------
+// SynchRing::Append
+// 	Put "item" at the end of the ring, and wake up the consumer if it
+//	is waiting for it.  Only the producer may call this.  Never
+//	waits; returns FALSE, without appending, if the ring is full.
+//
+//	"item" is the thing to put on the ring; it can be a pointer to
+//		anything.
+//----------------------------------------------------------------------
+
+bool
+SynchRing::Append(void *item)
+{
+    int next = (tail + 1) % numSlots;
+    IntStatus oldLevel;
+
+    if (next == head)
+	return FALSE;			// full
+    items[tail] = item;
+    tail = next;			// the item is now the consumer's
+
+    if (waiter != NULL) {
+	oldLevel = interrupt->SetLevel(IntOff);
+	if (waiter != NULL) {
+	    scheduler->ReadyToRun(waiter);
+	    waiter = NULL;
+	}
+	(void) interrupt->SetLevel(oldLevel);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SynchRing::Remove
+// 	Remove the item at the front of the ring, waiting if the ring is
+//	empty.  Only the consumer may call this.
+//
+// Returns:
+//	The removed item.
+//----------------------------------------------------------------------
+
+void *
+SynchRing::Remove()
+{
+    IntStatus oldLevel;
+    void *item;
+
+    if (head == tail) {
+	oldLevel = interrupt->SetLevel(IntOff);
+	while (head == tail) {		// check again, now that an
+					// Append can't slip in
+	    ASSERT(waiter == NULL);	// only one consumer!
+	    waiter = currentThread;
+	    currentThread->Sleep();
+	}
+	(void) interrupt->SetLevel(oldLevel);
+    }
+    item = items[head];
+    head = (head + 1) % numSlots;	// the slot is now the producer's
+    return item;
+}
+
+//----------------------------------------------------------------------
+// SynchRing::Count
+// 	Return how many items are in the ring.  Exact only if called by
+//	the producer or the consumer; anyone else gets a snapshot.
+//----------------------------------------------------------------------
+
+int
+SynchRing::Count()
+{
+    return (tail - head + numSlots) % numSlots;
+}
+
+//----------------------------------------------------------------------
+// SynchRing::Free
+// 	Return how many more items the ring can take.
+//----------------------------------------------------------------------
+
+int
+SynchRing::Free()
+{
+    return numSlots - 1 - Count();
+}
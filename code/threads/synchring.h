@@ -0,0 +1,55 @@
+// synchring.h
+//	Data structures for a bounded queue between exactly one producer
+//	and one consumer.
+//
+//	Like a SynchList, a thread removing an item from an empty ring
+//	waits until one is appended.  Unlike a SynchList, the ring
+//	doesn't need a Lock: the producer is the only one to change
+//	"tail", and the consumer the only one to change "head", so
+//	neither can get in the way of the other.  Interrupts are only
+//	turned off when the consumer has to go to sleep, or the producer
+//	has to wake it up.  Items go into a fixed array, so nothing is
+//	allocated on the way through.
+//
+//	The ring holds at most "size" items; Append on a full ring fails
+//	rather than waiting.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHRING_H
+#define SYNCHRING_H
+
+#include "copyright.h"
+#include "thread.h"
+
+class SynchRing {
+  public:
+    SynchRing(char *debugName, int size);
+				// initialize an empty ring, with room for
+				// "size" items
+    ~SynchRing();		// de-allocate the ring
+
+    bool Append(void *item);	// put an item at the end of the ring, and
+				// wake up the consumer if it is waiting;
+				// returns FALSE if the ring is full
+    void *Remove();		// remove the item at the front of the
+				// ring, waiting if the ring is empty
+
+    int Count();		// items in the ring
+    int Free();			// room left in the ring
+    char *getName() { return name; }
+
+  private:
+    char *name;			// for debugging
+    void **items;		// the ring; one slot is always left empty,
+    int numSlots;		// so a full ring doesn't look empty
+    int head;			// next item to Remove; only the consumer
+				// changes it
+    int tail;			// where the next item goes; only the
+				// producer changes it
+    Thread *waiter;		// consumer sleeping on an empty ring
+};
+
+#endif // SYNCHRING_H
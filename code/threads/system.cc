@@ -19,6 +19,10 @@ Scheduler *scheduler;			// the ready list
 Interrupt *interrupt;           // interrupt status
 Statistics *stats;              // performance metrics
 Timer *timer;                   // the hardware timer device, for invoking context switches
+WorkQueue *kernelWork;		// workers for background jobs
+Trace *trace;			// event trace, if "-trace" was given
+bool priorityScheduling = FALSE;	// ready list, and Lock queues,
+					// ordered by thread priority
 
 
 #ifdef FILESYS_NEEDED
@@ -27,26 +31,33 @@ Timer *timer;                   // the hardware timer device, for invoking conte
 
 #ifdef FILESYS
     SynchDisk *synchDisk;
+    Journal *journal;
 #endif
 
 // USER_PROGRAM requires either FILESYS or FILESYS_STUB
 #ifdef USER_PROGRAM
     Machine *machine;
+    int profileInterval = 0;
 
     BitMap *memBitMap;
     
     vector<KernelLock*> locks;
     vector<KernelCV*> conditions;
     vector<Process*> processInfo;
+    vector<KernelRWLock*> rwlocks;
+    vector<KernelBarrier*> barriers;
 
     Lock *memLock;
     Lock *processLock;
-    Lock *conditionsLock;
-    Lock *locksLock;
+    RWLock *conditionsLock;
+    RWLock *locksLock;
+    RWLock *rwlocksLock;
+    RWLock *barriersLock;
 #endif
 
 #ifdef NETWORK
     PostOffice *postOffice;
+    LockClient *lockClient;
 #endif
 
 
@@ -94,6 +105,9 @@ Initialize(int argc, char **argv)
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+    bool adaptiveTimer = FALSE;
+    char *accountFile = NULL;
+    char *traceFile = NULL;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
@@ -104,6 +118,8 @@ Initialize(int argc, char **argv)
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
+    int lockServer = -1;	// machine running the lock server
+    int txDepth = DefaultTxDepth; // network transmit queue depth
 #endif
     
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
@@ -121,10 +137,28 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-pri")) {
+	    priorityScheduling = TRUE;
+	} else if (!strcmp(*argv, "-aq")) {
+	    adaptiveTimer = TRUE;
+	} else if (!strcmp(*argv, "-acct")) {
+	    ASSERT(argc > 1);
+	    accountFile = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-trace")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-prof")) {
+	    ASSERT(argc > 1);
+	    profileInterval = atoi(*(argv + 1));
+	    ASSERT(profileInterval > 0);
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -139,16 +173,28 @@ Initialize(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    netname = atoi(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-txq")) {
+	    ASSERT(argc > 1);
+	    txDepth = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ls")) {
+	    ASSERT(argc > 1);
+	    lockServer = atoi(*(argv + 1));
+	    argCount = 2;
 	}
 #endif
     }
 
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
+    stats->accountFile = accountFile;
+    if (traceFile != NULL)			// start tracing (if asked)
+	trace = new Trace(traceFile);
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
-    if (randomYield)				// start the timer (if needed)
-	timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    if (randomYield || adaptiveTimer)		// start the timer (if needed)
+	timer = new Timer(TimerInterruptHandler, 0, randomYield,
+			  adaptiveTimer);
 
     threadToBeDestroyed = NULL;
 
@@ -161,6 +207,9 @@ Initialize(int argc, char **argv)
     interrupt->Enable();
     //printf("2");
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
+
+    kernelWork = new WorkQueue("Kernel work", KernelWorkers,
+				KernelWorkQueueSize);
     //printf("3");
     
 #ifdef USER_PROGRAM
@@ -173,9 +222,11 @@ Initialize(int argc, char **argv)
     // TODO: Do we really need locks since OS is the only "program" updating/reading from these tables?
     // TODO: Define Lock *processLock;
     memLock = new Lock("MemBitMapLock");
-    conditionsLock = new Lock("KernelCVLock");
-    locksLock = new Lock("KernelLocksLock");
+    conditionsLock = new RWLock("KernelCVLock");
+    locksLock = new RWLock("KernelLocksLock");
     processLock = new Lock("ProcessLock");
+    rwlocksLock = new RWLock("KernelRWLocksLock");
+    barriersLock = new RWLock("KernelBarriersLock");
 
     memBitMap = new BitMap(NumPhysPages); //num phys pages goes in machine.h according to class notes 
 
@@ -190,7 +241,10 @@ Initialize(int argc, char **argv)
 #endif
 
 #ifdef NETWORK
-    postOffice = new PostOffice(netname, rely, 10);
+    postOffice = new PostOffice(netname, rely, 10, txDepth);
+    lockClient = NULL;
+    if (lockServer >= 0)
+	lockClient = new LockClient(lockServer);
 #endif
 }
 
@@ -202,6 +256,11 @@ void
 Cleanup()
 {
     printf("\nCleaning up...\n");
+    kernelWork->Print();
+    if (trace != NULL) {
+	trace->Write();
+	delete trace;
+    }
 #ifdef NETWORK
     delete postOffice;
 #endif
@@ -213,6 +272,8 @@ Cleanup()
     delete conditionsLock;
     delete processLock;
     delete memLock;
+    delete rwlocksLock;
+    delete barriersLock;
 
     delete memBitMap;
 
@@ -232,6 +293,23 @@ Cleanup()
         }
     }
 
+    // Threads may still be waiting on these when Nachos halts
+    for(unsigned int i = 0; i < rwlocks.size(); i++)
+    {
+        if(rwlocks[i] && !rwlocks[i]->rwlock->isBusy())
+        {
+            delete rwlocks[i]->rwlock;
+        }
+    }
+
+    for(unsigned int i = 0; i < barriers.size(); i++)
+    {
+        if(barriers[i] && !barriers[i]->barrier->isBusy())
+        {
+            delete barriers[i]->barrier;
+        }
+    }
+
     for(int i = 0; i < processInfo.size(); i++)
     {
         if(processInfo[i])
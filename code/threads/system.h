@@ -17,6 +17,8 @@
 #include "timer.h"
 #include "bitmap.h"
 #include "synch.h"
+#include "workqueue.h"
+#include "trace.h"
 #include <vector>
 #include <string>
 using namespace std;
@@ -33,6 +35,10 @@ extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;				// performance metrics
 extern Timer *timer;					// the hardware alarm clock
+extern WorkQueue *kernelWork;			// workers for background jobs
+extern Trace *trace;				// kernel event trace, or NULL
+extern bool priorityScheduling;			// run threads by priority,
+						// with priority inheritance
 
 class Machine;
 
@@ -40,6 +46,8 @@ class Machine;
 #ifdef USER_PROGRAM
 
 	extern Machine* machine;	// user program memory and registers
+	extern int profileInterval;	// instructions between PC samples,
+					// or 0 if not profiling
 
 	//create tables for processes, condition variables, and locks
 	#include "addrspace.h"
@@ -60,6 +68,23 @@ class Machine;
         bool toDelete;
     };  
 
+    // KernelRWLock and KernelBarrier, likewise
+    struct KernelRWLock
+    {
+        RWLock *rwlock;
+        AddrSpace *space;
+        bool toDelete;
+        int users;	// syscalls still using it; only deleted at 0
+    };
+
+    struct KernelBarrier
+    {
+        Barrier *barrier;
+        AddrSpace *space;
+        bool toDelete;
+        int users;	// syscalls still using it; only deleted at 0
+    };
+
     struct Process
     {
     	AddrSpace *space;
@@ -75,13 +100,17 @@ class Machine;
 	extern vector<KernelLock*> locks;
 	extern vector<KernelCV*> conditions;
 	extern vector<Process*> processInfo;
+	extern vector<KernelRWLock*> rwlocks;
+	extern vector<KernelBarrier*> barriers;
 
 	//create locks around these tables so only one program can access at a time
 	#include "synch.h"
     extern Lock *memLock;
 	extern Lock *processLock; //lock on process table
-	extern Lock *conditionsLock;	//lock on cv table
-	extern Lock *locksLock;	//lock on lock table
+	extern RWLock *conditionsLock;	//lock on cv table; lookups read
+	extern RWLock *locksLock;	//lock on lock table; lookups read
+	extern RWLock *rwlocksLock;	//lock on rwlock table; lookups read
+	extern RWLock *barriersLock;	//lock on barrier table; lookups read
 
 #endif
 
@@ -95,7 +124,10 @@ class Machine;
 #ifdef FILESYS
 
 	#include "synchdisk.h"
+	#include "journal.h"
 	extern SynchDisk *synchDisk;
+	extern Journal *journal;	// metadata journal, created and
+					// replayed by the FileSystem
 
 #endif
 
@@ -104,6 +136,10 @@ class Machine;
 	#include "post.h"
 	extern PostOffice* postOffice;
 
+	#include "lockserver.h"
+	extern LockClient *lockClient;	// Non-NULL if Lock and Condition
+					// syscalls go to a lock server
+
 #endif
 
 #endif // SYSTEM_H
@@ -24,6 +24,9 @@
 					// execution stack, for detecting 
 					// stack overflows
 
+static int *stackPool[StackPoolSize];	// stacks ready for new threads
+static int numPooledStacks = 0;
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
@@ -40,6 +43,11 @@ Thread::Thread(char* threadName)
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    basePriority = priority = DefaultPriority;
+    waitingFor = NULL;
+    locksHeld = new List;
+    inversionStart = -1;
+    account = stats->NewThread(threadName);
 #ifdef USER_PROGRAM
     space = NULL;
     //set process ID in the thread to
@@ -60,6 +68,9 @@ Thread::Thread(char* threadName)
 //      NOTE: if this is the main thread, we can't delete the stack
 //      because we didn't allocate it -- we got it automatically
 //      as part of starting up Nachos.
+//
+//	The stack goes back in the pool for the next thread, if there
+//	is room; it keeps its guard pages.
 //----------------------------------------------------------------------
 
 Thread::~Thread()
@@ -67,8 +78,13 @@ Thread::~Thread()
     DEBUG('t', "Deleting thread \"%s\"\n", name);
 
     ASSERT(this != currentThread);
-    if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+    delete locksHeld;
+    if (stack != NULL) {
+	if (numPooledStacks < StackPoolSize)
+	    stackPool[numPooledStacks++] = stack;
+	else
+	    DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+    }
 }
 
 //----------------------------------------------------------------------
@@ -190,14 +206,86 @@ Thread::Yield ()
     
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
     
-    nextThread = scheduler->FindNextToRun();
+    nextThread = scheduler->Peek();
+    if (priorityScheduling && (nextThread != NULL)
+		&& (nextThread->getPriority() < priority))
+	nextThread = NULL;		// don't give way to a less urgent thread
     if (nextThread != NULL) {
+	nextThread = scheduler->FindNextToRun();
 	scheduler->ReadyToRun(this);
 	scheduler->Run(nextThread);
     }
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Thread::setPriority
+// 	Set the thread's base priority.  It goes on running at any higher
+//	priority lent to it by threads waiting for its locks.
+//
+//	"newPriority" -- the new base priority; higher runs first
+//----------------------------------------------------------------------
+
+void
+Thread::setPriority(int newPriority)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    basePriority = newPriority;
+    RecomputePriority();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Thread::setEffectivePriority
+// 	Make the thread run at "newPriority", moving it to its new place
+//	on the ready list, or on the queue of the lock it is waiting for.
+//	Interrupts must be off.
+//----------------------------------------------------------------------
+
+void
+Thread::setEffectivePriority(int newPriority)
+{
+    ASSERT(interrupt->getLevel() == IntOff);
+    if (newPriority == priority)
+	return;
+    DEBUG('t', "Thread \"%s\" now at priority %d\n", name, newPriority);
+    priority = newPriority;
+    if (status == READY)
+	scheduler->Reorder(this);
+    else if (waitingFor != NULL)
+	waitingFor->Reorder(this);
+}
+
+//----------------------------------------------------------------------
+// Thread::RecomputePriority
+// 	Work out the priority the thread should run at now: its base
+//	priority, or that of the most urgent thread waiting for one of
+//	the locks it still holds, whichever is higher.  Called when it
+//	gives up a lock, and with it whatever that lock's waiters lent
+//	it.  Interrupts must be off.
+//----------------------------------------------------------------------
+
+static int donatedPriority;	// for MaxDonated
+
+static void
+MaxDonated(int arg)
+{
+    Thread *waiter = ((Lock *) arg)->FirstWaiter();
+
+    if ((waiter != NULL) && (waiter->getPriority() > donatedPriority))
+	donatedPriority = waiter->getPriority();
+}
+
+void
+Thread::RecomputePriority()
+{
+    ASSERT(interrupt->getLevel() == IntOff);
+    donatedPriority = basePriority;
+    locksHeld->Mapcar(MaxDonated);
+    setEffectivePriority(donatedPriority);
+}
+
 //----------------------------------------------------------------------
 // Thread::Sleep
 // 	Relinquish the CPU, because the current thread is blocked
@@ -254,6 +342,9 @@ void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
 //		calls (*func)(arg)
 //		calls Thread::Finish
 //
+//	The stack of a destroyed thread is reused if there is one;
+//	only when the pool is empty do we ask the host for a new one.
+//
 //	"func" is the procedure to be forked
 //	"arg" is the parameter to be passed to the procedure
 //----------------------------------------------------------------------
@@ -261,7 +352,13 @@ void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    if (numPooledStacks > 0) {
+	stack = stackPool[--numPooledStacks];
+	stats->numStacksReused++;
+    } else {
+	stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+	stats->numStacksAllocated++;
+    }
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
@@ -39,6 +39,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "list.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -55,6 +56,18 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(4 * 1024)	// in words
 
+// Stacks of destroyed threads are kept, up to this many, and handed to
+// new threads, so the host doesn't have to allocate a stack and set up
+// its guard pages each time a thread is forked.
+#define StackPoolSize	32
+
+
+// Priority a thread starts out with.  Priorities only matter when
+// priority scheduling is turned on ("-pri"); higher runs first.
+#define DefaultPriority	0
+
+class Lock;
+class ThreadStatistics;
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
@@ -101,6 +114,25 @@ class Thread {
     void setStatus(ThreadStatus st) { status = st; }
     char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
+
+    // Priorities, for priority scheduling.  A thread holding a Lock
+    // runs at the priority of the most urgent thread waiting for it,
+    // if that is above its own (priority inheritance).
+    void setPriority(int newPriority);	// set the base priority
+    int getPriority() { return priority; }	// priority it runs at
+    int getBasePriority() { return basePriority; }
+    void setEffectivePriority(int newPriority);
+					// run at "newPriority", moving the
+					// thread along any queue it is on
+    void RecomputePriority();		// drop back to the base priority,
+					// or what is still donated to it
+
+    Lock *waitingFor;			// lock the thread is asleep on
+    List *locksHeld;			// locks it holds; only kept up with
+					// priority scheduling
+    int64_t inversionStart;		// when it started waiting for a
+					// lower priority thread, or -1
+    ThreadStatistics *account;		// what the thread has used
     
 
   private:
@@ -111,6 +143,8 @@ class Thread {
 					// (If NULL, don't deallocate stack)
     ThreadStatus status;		// ready, running or blocked
     char* name;
+    int basePriority;			// priority it was given
+    int priority;			// basePriority, or higher if donated
 
     void StackAllocate(VoidFunctionPtr func, int arg);
     					// Allocate a stack for thread.
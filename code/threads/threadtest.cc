@@ -15,6 +15,8 @@
 #ifdef CHANGED
 #include "synch.h"
 #endif
+#include "synchlist.h"
+#include "synchring.h"
 
 #include <stdio.h>
 
@@ -65,6 +67,178 @@ ThreadTest()
     SimpleThread(0);
 }
 
+//----------------------------------------------------------------------
+// QueueBenchmark
+//  Pass items from a producer thread to a consumer thread, first
+//  through a SynchList and then through a SynchRing, and print what
+//  each item cost, in simulated ticks and in real time on the host.
+//
+//  Each is run twice: once with the producer yielding after every
+//  item, so the consumer sleeps and is woken up for each one, and
+//  once with the producer appending a burst before it yields.
+//----------------------------------------------------------------------
+
+#define QueueBenchItems	20000
+#define QueueBenchBurst	16
+
+static SynchList *benchList;
+static SynchRing *benchRing;
+static Semaphore *benchConsumed;
+static int benchItem;		// what gets passed; SynchList won't take NULL
+
+static void
+ListConsumer(int n)
+{
+    for (int i = 0; i < n; i++)
+	(void) benchList->Remove();
+    benchConsumed->V();
+}
+
+static void
+RingConsumer(int n)
+{
+    for (int i = 0; i < n; i++)
+	(void) benchRing->Remove();
+    benchConsumed->V();
+}
+
+static void
+QueueRun(bool ring, int burst)
+{
+    Thread *consumer = new Thread("queue consumer");
+    int startTicks = stats->totalTicks;
+    double startTime = HostTime();
+    int ticks;
+    double elapsed;
+
+    consumer->Fork(ring ? RingConsumer : ListConsumer, QueueBenchItems);
+    for (int i = 0; i < QueueBenchItems; i++) {
+	if (ring) {
+	    while (!benchRing->Append((void *) &benchItem))
+		currentThread->Yield();		// full; let the consumer in
+	} else
+	    benchList->Append((void *) &benchItem);
+	if ((i + 1) % burst == 0)
+	    currentThread->Yield();
+    }
+    benchConsumed->P();
+
+    ticks = stats->totalTicks - startTicks;
+    elapsed = HostTime() - startTime;
+    printf("QueueBench %s, bursts of %d: %d items, %.2f ticks, "
+		"%.3f usec per item\n", ring ? "SynchRing" : "SynchList",
+		burst, QueueBenchItems, (double) ticks / QueueBenchItems,
+		elapsed * 1000000.0 / QueueBenchItems);
+}
+
+void
+QueueBenchmark()
+{
+    benchList = new SynchList;
+    benchRing = new SynchRing("bench ring", QueueBenchBurst);
+    benchConsumed = new Semaphore("bench consumed", 0);
+
+    QueueRun(FALSE, 1);
+    QueueRun(TRUE, 1);
+    QueueRun(FALSE, QueueBenchBurst);
+    QueueRun(TRUE, QueueBenchBurst);
+
+    delete benchList;
+    delete benchRing;
+    delete benchConsumed;
+}
+
+//----------------------------------------------------------------------
+// PriorityTest
+//  The classic priority inversion: a low priority thread holds a
+//  lock that a high priority thread wants, while a medium priority
+//  thread has work to do.  Without priority inheritance the medium
+//  thread runs first, and keeps the high one waiting; with it, the
+//  low thread runs at high priority until it lets the lock go.
+//
+//  Needs priority scheduling ("-pri").
+//----------------------------------------------------------------------
+
+#define PriorityLow	1
+#define PriorityMedium	5
+#define PriorityHigh	10
+#define PriorityTestWork	20	// Yields each thread does
+
+static Lock *priorityLock;
+static Semaphore *priorityStep;
+static bool mediumDone;
+
+static void
+PriorityLowThread(int arg)
+{
+    priorityLock->Acquire();
+    printf("low: holding %s\n", priorityLock->getName());
+    priorityStep->V();				// let the test go on
+    for (int i = 0; i < PriorityTestWork; i++)
+	currentThread->Yield();
+    printf("low: releasing %s, at priority %d\n", priorityLock->getName(),
+		currentThread->getPriority());
+    priorityLock->Release();
+}
+
+static void
+PriorityMediumThread(int arg)
+{
+    for (int i = 0; i < PriorityTestWork; i++)
+	currentThread->Yield();
+    printf("medium: done\n");
+    mediumDone = TRUE;
+    priorityStep->V();
+}
+
+static void
+PriorityHighThread(int arg)
+{
+    printf("high: waiting for %s\n", priorityLock->getName());
+    priorityLock->Acquire();
+    printf("high: got %s%s\n", priorityLock->getName(),
+		mediumDone ? ", after medium (inversion!)" : "");
+    priorityLock->Release();
+    priorityStep->V();
+}
+
+void
+PriorityTest()
+{
+    Thread *t;
+
+    if (!priorityScheduling) {
+	printf("PriorityTest needs priority scheduling (-pri)\n");
+	return;
+    }
+    priorityLock = new Lock("priority lock");
+    priorityStep = new Semaphore("priority step", 0);
+    mediumDone = FALSE;
+
+    // Run above everything else, so we only give way when we wait
+    currentThread->setPriority(PriorityHigh + 1);
+
+    t = new Thread("low");
+    t->setPriority(PriorityLow);
+    t->Fork(PriorityLowThread, 0);
+    priorityStep->P();				// low has the lock
+
+    t = new Thread("medium");
+    t->setPriority(PriorityMedium);
+    t->Fork(PriorityMediumThread, 0);
+    t = new Thread("high");
+    t->setPriority(PriorityHigh);
+    t->Fork(PriorityHighThread, 0);
+
+    priorityStep->P();				// high or medium is done
+    printf("PriorityTest %s\n", mediumDone ? "FAILED" : "passed");
+    priorityStep->P();				// and the other one
+
+    currentThread->setPriority(DefaultPriority);
+    delete priorityLock;
+    delete priorityStep;
+}
+
 #ifdef CHANGED
 // --------------------------------------------------
 // Test Suite
@@ -991,11 +1165,8 @@ void ApplicationClerkToCustomer(int lineNumber)
     currentThread->Yield();
 
     // Create a FilingJob for filing Customer's application within the system
-    char * name = new char [40];
-    sprintf(name, "ApplicationFilingThread-Clerk%d-Cust%d", lineNumber, appClerkData[lineNumber].currentCustomer);
-    Thread * t = new Thread("ApplicationFilingThread");
     FilingJob * applicationFiling = new FilingJob(appClerkData[lineNumber].currentCustomer, lineNumber);
-    t->Fork((VoidFunctionPtr)FileApplication, (int)applicationFiling); //think about where this should go!
+    kernelWork->Submit((VoidFunctionPtr)FileApplication, (int)applicationFiling);
     
     // Notify Customer that I have filed his application and he can move on
     appClerkCV[lineNumber]->Signal(appClerkLock[lineNumber]);
@@ -1122,11 +1293,8 @@ void PictureClerkToCustomer(int lineNumber)
     
     // If Customer liked his photo, file his photo in the system
     if (picClerkData[lineNumber].customerLikedPhoto) {
-        char * name = new char [40];
-        sprintf(name, "PictureFilingThread–Clerk%d–Cust%d", lineNumber, picClerkData[lineNumber].currentCustomer);
-        Thread * t = new Thread(name);
         FilingJob * pictureFiling = new FilingJob(picClerkData[lineNumber].currentCustomer, lineNumber);
-        t->Fork((VoidFunctionPtr)FilePicture, (int)pictureFiling);
+        kernelWork->Submit((VoidFunctionPtr)FilePicture, (int)pictureFiling);
     }
     // Else, Customer didn't like it, do nothing.
 
@@ -1229,6 +1397,7 @@ void PassportClerkToCustomer(int lineNumber)
     currentThread->Yield(); // Simulate: One moment, I need to check if your application and photos were filed in the system
     
     // Get access to the filing system, prevent it from updating while I'm checking
+    FilingJob * passportCertifyingJob = NULL;
     filingApplicationLock.Acquire();
     filingPictureLock.Acquire();
 
@@ -1242,16 +1411,17 @@ void PassportClerkToCustomer(int lineNumber)
         passportClerkData[lineNumber].customersAppReadyToCertify = true;
 
         // Create a FilingJob in the system for certifying the Customer's passport.
-        char * name = new char [40];
-        sprintf(name, "PassportCertifyingThread-Clerk%d-Cust%d", lineNumber, passportClerkData[lineNumber].currentCustomer);
-        Thread * t = new Thread(name);
-        FilingJob * passportCertifyingJob = new FilingJob(passportClerkData[lineNumber].currentCustomer, lineNumber);
-        t->Fork((VoidFunctionPtr)CertifyPassport, (int)passportCertifyingJob);
+        passportCertifyingJob = new FilingJob(passportClerkData[lineNumber].currentCustomer, lineNumber);
     }
 
     filingApplicationLock.Release();
     filingPictureLock.Release();
 
+    // Hand the job to the kernel workers only now: if their queue is full,
+    // we wait for a filing job to finish, and those need the filing locks.
+    if (passportCertifyingJob != NULL)
+        kernelWork->Submit((VoidFunctionPtr)CertifyPassport, (int)passportCertifyingJob);
+
     passportClerkCV[lineNumber]->Signal(passportClerkLock[lineNumber]); // Signal the customer that I have done my work
     passportClerkCV[lineNumber]->Wait(passportClerkLock[lineNumber]); // Wait for customer to tell me he is leaving
 
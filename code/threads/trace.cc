@@ -0,0 +1,228 @@
+// trace.cc
+//	Routines for recording a trace of the kernel, and writing it out
+//	as Chrome trace JSON.
+//
+//	Events are recorded raw, and only turned into JSON at the end.
+//	A context switch is recorded as the time the new thread started
+//	running; the bar for each thread runs from there to the next
+//	switch.  Each thread is a Chrome "thread", and each user process
+//	a Chrome "process" (the kernel's threads are process 0).  A
+//	tick is taken to be a microsecond.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "trace.h"
+#include "system.h"
+
+// Names for the interrupt types, in the order of IntType
+static const char *intNames[] = { "timer", "disk", "console write",
+			    "console read", "network send",
+			    "network recv", "network timer" };
+
+//----------------------------------------------------------------------
+// Trace::Trace
+// 	Start an empty trace.
+//
+//	"traceFile" is where Write will put it.
+//----------------------------------------------------------------------
+
+Trace::Trace(char *traceFile)
+{
+    fileName = traceFile;
+    events = new TraceEvent[TraceSize];
+    numRecorded = 0;
+}
+
+//----------------------------------------------------------------------
+// Trace::~Trace
+// 	De-allocate the trace.
+//----------------------------------------------------------------------
+
+Trace::~Trace()
+{
+    delete [] events;
+}
+
+//----------------------------------------------------------------------
+// EventStart
+// 	Start writing a JSON event for "thread": the separator from the
+//	event before, if any, and the fields every event has.
+//----------------------------------------------------------------------
+
+static bool firstEvent;
+
+static void
+EventStart(FILE *file, ThreadStatistics *thread, const char *phase,
+	   int64_t when)
+{
+    fprintf(file, "%s{\"ph\":\"%s\",\"ts\":%lld,\"pid\":%d,\"tid\":%d",
+		firstEvent ? "" : ",\n", phase, (long long) when,
+		(thread == NULL) ? 0 : thread->processID + 1,
+		(thread == NULL) ? 0 : thread->id);
+    firstEvent = FALSE;
+}
+
+//----------------------------------------------------------------------
+// WriteName
+// 	Write "name" as a JSON string, leaving out any character that
+//	would need escaping.
+//----------------------------------------------------------------------
+
+static void
+WriteName(FILE *file, char *name)
+{
+    fputc('"', file);
+    for (; *name != '\0'; name++)
+	if ((*name != '"') && (*name != '\\') && (*name >= ' '))
+	    fputc(*name, file);
+    fputc('"', file);
+}
+
+//----------------------------------------------------------------------
+// Trace::Write
+// 	Write the events in the ring, oldest first, to "fileName" as
+//	Chrome trace JSON, preceded by the names of every thread and
+//	process.
+//
+//	Once the ring has wrapped, the start of a syscall or disk
+//	request may have been overwritten while its end was kept, and
+//	at the end of the run some are still going.  Viewers get the
+//	nesting wrong for a "B" without an "E" or an "E" without a "B",
+//	so an end whose start isn't in the ring is left out, and
+//	whatever is still open is ended at the time of the last event.
+//----------------------------------------------------------------------
+
+void
+Trace::Write()
+{
+    FILE *file = fopen(fileName, "w");
+    ThreadStatistics *t;
+    ThreadStatistics *running = NULL;	// whose bar is open, and since
+    int64_t runningSince = 0;		// when
+    const char *diskOp = "disk";	// request the disk is working on
+    int diskSector = -1;		// and its sector, or -1 if none
+    int *inSyscall;			// by thread id: syscalls begun and
+    int *syscallCode;			// not yet ended, and the last one's
+					// code
+    int64_t last;
+    unsigned int first, i;
+    int n;
+    TraceEvent *e;
+    char name[32];
+
+    if (file == NULL) {
+	printf("Can't write trace to %s\n", fileName);
+	return;
+    }
+    first = (numRecorded > TraceSize) ? numRecorded - TraceSize : 0;
+    last = (numRecorded == 0) ? 0
+		: events[(numRecorded - 1) & (TraceSize - 1)].when;
+    inSyscall = new int[stats->numThreads + 1];
+    syscallCode = new int[stats->numThreads + 1];
+    for (n = 0; n <= stats->numThreads; n++)
+	inSyscall[n] = 0;
+    firstEvent = TRUE;
+    fprintf(file, "{\"traceEvents\":[\n");
+
+    for (t = stats->threads; t != NULL; t = t->next) {
+	EventStart(file, t, "M", 0);
+	fprintf(file, ",\"name\":\"thread_name\",\"args\":{\"name\":");
+	WriteName(file, t->name);
+	fprintf(file, "}}");
+	if (t->processID < 0)
+	    sprintf(name, "kernel");
+	else
+	    sprintf(name, "process %d", t->processID);
+	EventStart(file, t, "M", 0);
+	fprintf(file, ",\"name\":\"process_name\",\"args\":{\"name\":\"%s\"}}",
+		name);
+    }
+
+    for (i = first; i != numRecorded; i++) {
+	e = &events[i & (TraceSize - 1)];
+	switch (e->type) {
+	  case TraceSwitch:
+	    if (running != NULL) {
+		EventStart(file, running, "X", runningSince);
+		fprintf(file, ",\"dur\":%lld,\"name\":\"running\"}",
+			(long long) (e->when - runningSince));
+	    }
+	    running = e->thread;
+	    runningSince = e->when;
+	    break;
+	  case TraceSyscallEnter:
+	    inSyscall[e->thread->id]++;
+	    syscallCode[e->thread->id] = e->arg;
+	    EventStart(file, e->thread, "B", e->when);
+	    fprintf(file, ",\"cat\":\"syscall\",\"name\":\"syscall %d\"}",
+			e->arg);
+	    break;
+	  case TraceSyscallExit:
+	    if (inSyscall[e->thread->id] == 0)
+		break;			// began before the ring's oldest
+	    inSyscall[e->thread->id]--;
+	    EventStart(file, e->thread, "E", e->when);
+	    fprintf(file, ",\"cat\":\"syscall\",\"name\":\"syscall %d\"}",
+			e->arg);
+	    break;
+	  case TraceInterrupt:
+	    EventStart(file, e->thread, "i", e->when);
+	    fprintf(file, ",\"s\":\"t\",\"cat\":\"interrupt\","
+			"\"name\":\"%s interrupt\"}",
+			((e->arg >= 0) && (e->arg <= NetworkTimerInt)) ?
+			intNames[e->arg] : "unknown");
+	    break;
+	  case TraceDiskRead:
+	  case TraceDiskWrite:
+	    diskOp = (e->type == TraceDiskRead) ? "disk read" : "disk write";
+	    diskSector = e->arg;
+	    EventStart(file, NULL, "b", e->when);	// one disk, for
+							// everyone
+	    fprintf(file, ",\"cat\":\"disk\",\"id\":1,\"name\":\"%s\","
+			"\"args\":{\"sector\":%d}}", diskOp, e->arg);
+	    break;
+	  case TraceDiskDone:
+	    if (diskSector < 0)
+		break;			// started before the ring's oldest
+	    diskSector = -1;
+	    EventStart(file, NULL, "e", e->when);
+	    fprintf(file, ",\"cat\":\"disk\",\"id\":1,\"name\":\"%s\"}",
+			diskOp);
+	    break;
+	  case TraceNetSend:
+	  case TraceNetReceive:
+	    EventStart(file, e->thread, "i", e->when);
+	    fprintf(file, ",\"s\":\"t\",\"cat\":\"network\","
+			"\"name\":\"%s\",\"args\":{\"machine\":%d}}",
+			(e->type == TraceNetSend) ? "send" : "receive", e->arg);
+	    break;
+	}
+    }
+    if (running != NULL) {
+	EventStart(file, running, "X", runningSince);
+	fprintf(file, ",\"dur\":%lld,\"name\":\"running\"}",
+		(long long) (stats->totalTicks - runningSince));
+    }
+    for (t = stats->threads; t != NULL; t = t->next)
+	for (; inSyscall[t->id] > 0; inSyscall[t->id]--) {
+	    EventStart(file, t, "E", last);
+	    fprintf(file, ",\"cat\":\"syscall\",\"name\":\"syscall %d\"}",
+			syscallCode[t->id]);
+	}
+    if (diskSector >= 0) {
+	EventStart(file, NULL, "e", last);
+	fprintf(file, ",\"cat\":\"disk\",\"id\":1,\"name\":\"%s\"}",
+		diskOp);
+    }
+    delete [] inSyscall;
+    delete [] syscallCode;
+
+    fprintf(file, "\n],\"otherData\":{\"events\":%u,\"dropped\":%u}}\n",
+		numRecorded - first, first);
+    fclose(file);
+    printf("Trace: %u events written to %s, %u dropped\n",
+		numRecorded - first, fileName, first);
+}
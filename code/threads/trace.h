@@ -0,0 +1,85 @@
+// trace.h
+//	Data structures for tracing what the kernel does, cheaply enough
+//	to leave on.
+//
+//	Context switches, syscalls, interrupts, and disk and network
+//	requests are recorded as they happen, in a fixed ring of events.
+//	Recording an event is a handful of stores; when tracing is off
+//	(the default), the TRACE macro costs one test.  Once the ring is
+//	full, the oldest events are overwritten, so a trace always has
+//	the last TraceSize events of the run.
+//
+//	At the end, the trace is written out as Chrome trace JSON, for
+//	chrome://tracing or Perfetto: a bar for each stretch a thread
+//	runs, and for each syscall and disk request, with marks for
+//	interrupts and network packets.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "stats.h"
+
+#define TraceSize	(1 << 16)	// events kept; a power of two
+
+// What happened.  "arg" in the event says more, as noted.
+
+enum TraceType {
+    TraceSwitch,		// a thread started running
+    TraceSyscallEnter,		// a syscall began; arg is its code
+    TraceSyscallExit,		// a syscall returned; arg is its code
+    TraceInterrupt,		// an interrupt handler ran; arg is its IntType
+    TraceDiskRead,		// a disk read was started; arg is the sector
+    TraceDiskWrite,		// a disk write was started; arg is the sector
+    TraceDiskDone,		// the disk finished a request
+    TraceNetSend,		// a packet was sent; arg is where to
+    TraceNetReceive		// a packet arrived; arg is where from
+};
+
+class TraceEvent {
+  public:
+    int64_t when;		// totalTicks at the time
+    ThreadStatistics *thread;	// the thread running; its statistics
+				// outlive it, so they stand in for it
+    int type;			// a TraceType
+    int arg;
+};
+
+class Trace {
+  public:
+    Trace(char *traceFile);	// start an empty trace, to be written
+				// to "traceFile"
+    ~Trace();
+
+    void Record(int64_t when, ThreadStatistics *thread, int type, int arg)
+    {
+	TraceEvent *e = &events[numRecorded++ & (TraceSize - 1)];
+
+	e->when = when;
+	e->thread = thread;
+	e->type = type;
+	e->arg = arg;
+    }
+
+    void Write();		// write the trace as Chrome trace JSON
+
+  private:
+    char *fileName;
+    TraceEvent *events;		// the ring
+    unsigned int numRecorded;	// events ever recorded; the next goes
+				// in events[numRecorded % TraceSize]
+};
+
+// Record an event, if tracing is on.  Only for files that include
+// system.h, for "trace", "stats" and "currentThread".
+
+#define TRACE(type, arg)	\
+    if (trace != NULL)		\
+	trace->Record(stats->totalTicks, currentThread->account, type, arg)
+
+#endif // TRACE_H
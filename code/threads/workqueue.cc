@@ -0,0 +1,177 @@
+// workqueue.cc
+//	Routines for a pool of kernel worker threads, fed by a bounded
+//	queue of tasks.
+//
+//	Everything is kept under one lock.  A worker takes a task off the
+//	queue with the lock held, and runs it with the lock released, so
+//	the other workers (and Submit) can go on meanwhile.
+//
+//	"numIdle" counts workers waiting for a task that nobody has
+//	signalled yet.  Submit signals one of them if there is one, and
+//	otherwise forks a new worker if it may; if neither, some busy
+//	worker will get to the task when it is done with its own.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "workqueue.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// WorkerHelper
+// 	Dummy function because C++ can't indirectly invoke member
+//	functions; forked as the body of each worker thread.
+//
+//	"arg" -- pointer to the WorkQueue the worker serves
+//----------------------------------------------------------------------
+
+static void WorkerHelper(int arg)
+{ WorkQueue *queue = (WorkQueue *) arg; queue->Work(); }
+
+//----------------------------------------------------------------------
+// WorkQueue::WorkQueue
+// 	Initialize an empty queue.  No worker is forked until there is
+//	work for it.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"workers" is the most worker threads to fork.
+//	"queueSize" is the most tasks that can wait in the queue.
+//----------------------------------------------------------------------
+
+WorkQueue::WorkQueue(char *debugName, int workers, int queueSize)
+{
+    ASSERT((workers > 0) && (queueSize > 0));
+    name = debugName;
+    lock = new Lock("work queue lock");
+    notEmpty = new Condition("work queue not empty");
+    notFull = new Condition("work queue not full");
+    drained = new Condition("work queue drained");
+    size = queueSize;
+    tasks = new WorkItem[size];
+    first = numQueued = 0;
+    maxWorkers = workers;
+    numWorkers = numIdle = numBusy = 0;
+    numSubmitted = numCompleted = numFullWaits = maxQueued = 0;
+}
+
+//----------------------------------------------------------------------
+// WorkQueue::~WorkQueue
+// 	De-allocate the queue.  Workers never exit, so this is only
+//	allowed if none was ever forked.
+//----------------------------------------------------------------------
+
+WorkQueue::~WorkQueue()
+{
+    ASSERT(numWorkers == 0);
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+    delete drained;
+    delete [] tasks;
+}
+
+//----------------------------------------------------------------------
+// WorkQueue::Submit
+// 	Queue a call to (*func)(arg), to be made by one of the workers.
+//	Waits if the queue is full.
+//
+//	"func" is the procedure to call
+//	"arg" is the parameter to pass it
+//----------------------------------------------------------------------
+
+void
+WorkQueue::Submit(VoidFunctionPtr func, int arg)
+{
+    WorkItem *task;
+    Thread *t;
+
+    lock->Acquire();
+    while (numQueued == size) {
+	numFullWaits++;
+	notFull->Wait(lock);
+    }
+    task = &tasks[(first + numQueued) % size];
+    task->func = func;
+    task->arg = arg;
+    numQueued++;
+    numSubmitted++;
+    if (numQueued > maxQueued)
+	maxQueued = numQueued;
+
+    if (numIdle > 0) {
+	numIdle--;
+	notEmpty->Signal(lock);
+    } else if (numWorkers < maxWorkers) {
+	numWorkers++;
+	DEBUG('t', "Forking worker %d for %s\n", numWorkers, name);
+	t = new Thread("kernel worker");
+	t->Fork(WorkerHelper, (int) this);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// WorkQueue::Drain
+// 	Wait until the queue is empty and no worker is running a task.
+//	Must not be called from a task.
+//----------------------------------------------------------------------
+
+void
+WorkQueue::Drain()
+{
+    lock->Acquire();
+    while ((numQueued > 0) || (numBusy > 0))
+	drained->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// WorkQueue::Work
+// 	Take tasks off the queue and run them, forever.
+//----------------------------------------------------------------------
+
+void
+WorkQueue::Work()
+{
+    WorkItem task;
+
+    lock->Acquire();
+    for (;;) {
+	while (numQueued == 0) {
+	    numIdle++;
+	    notEmpty->Wait(lock);
+	}
+	task = tasks[first];
+	first = (first + 1) % size;
+	numQueued--;
+	numBusy++;
+	notFull->Signal(lock);
+	lock->Release();
+
+	(*task.func)(task.arg);
+
+	lock->Acquire();
+	numBusy--;
+	numCompleted++;
+	if ((numQueued == 0) && (numBusy == 0))
+	    drained->Broadcast(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+// WorkQueue::Print
+// 	Print how many tasks have gone through the queue, and how many
+//	workers it took.  Prints nothing if the queue was never used.
+//----------------------------------------------------------------------
+
+void
+WorkQueue::Print()
+{
+    if (numSubmitted == 0)
+	return;
+    printf("%s: %d tasks submitted, %d done, %d workers, at most %d "
+		"of %d queued, %d waits for room\n", name, numSubmitted,
+		numCompleted, numWorkers, maxQueued, size, numFullWaits);
+}
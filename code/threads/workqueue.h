@@ -0,0 +1,76 @@
+// workqueue.h
+//	Data structures for a pool of kernel worker threads, fed by a
+//	bounded queue of tasks.
+//
+//	Short jobs that the kernel wants done in the background are
+//	Submitted to a WorkQueue instead of each being given a Thread of
+//	its own.  A fixed set of worker threads takes tasks off the queue
+//	and runs them, one after another, so a job costs no Fork, stack
+//	or Finish.
+//
+//	Workers are only forked when a task arrives and every worker
+//	already forked is busy, up to the limit; after that, tasks wait
+//	in the queue for a worker to come free.  Submit waits if the
+//	queue is full.
+//
+//	A task must not wait for a task submitted after it, since it may
+//	be holding the only worker.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "synch.h"
+
+#define KernelWorkers		4	// workers in the kernel's queue
+#define KernelWorkQueueSize	32	// tasks it can hold
+
+// A task: call (*func)(arg).
+
+class WorkItem {
+  public:
+    VoidFunctionPtr func;
+    int arg;
+};
+
+class WorkQueue {
+  public:
+    WorkQueue(char *debugName, int workers, int queueSize);
+				// initialize a queue for "queueSize"
+				// tasks, run by up to "workers" threads
+    ~WorkQueue();		// de-allocate the queue; no worker may
+				// have been forked
+
+    void Submit(VoidFunctionPtr func, int arg);
+				// queue a call to (*func)(arg), waiting
+				// if the queue is full
+    void Drain();		// wait until every task submitted so far
+				// is done
+    void Print();		// print statistics
+
+    void Work();		// body of the worker threads
+
+  private:
+    char *name;			// for debugging
+    Lock *lock;			// protects everything below
+    Condition *notEmpty;	// workers wait here for a task
+    Condition *notFull;		// Submit waits here for room
+    Condition *drained;		// Drain waits here
+    WorkItem *tasks;		// the queue, a ring of "size" tasks
+    int size;
+    int first;			// next task to run
+    int numQueued;
+    int maxWorkers;
+    int numWorkers;		// workers forked so far
+    int numIdle;		// workers waiting for a task, and not yet
+				// signalled
+    int numBusy;		// workers running a task
+    int numSubmitted, numCompleted, numFullWaits, maxQueued;
+};
+
+#endif // WORKQUEUE_H
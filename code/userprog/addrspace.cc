@@ -21,12 +21,13 @@
 #include "noff.h"
 #include "table.h"
 #include "synch.h"
+#include "asyncio.h"
 
 extern "C" { int bzero(char *, int); };
 
 Table::Table(int s) : map(s), table(0), lock(0), size(s) {
     table = new void *[size];
-    lock = new Lock("TableLock");
+    lock = new RWLock("TableLock");
 }
 
 Table::~Table() {
@@ -42,9 +43,17 @@ Table::~Table() {
 
 void *Table::Get(int i) {
     // Return the element associated with the given if, or 0 if
-    // there is none.
+    // there is none.  Any number of threads can look things up at
+    // once; only Put and Remove keep the others out.
+    void *f = 0;
 
-    return (i >=0 && i < size && map.Test(i)) ? table[i] : 0;
+    if (i >= 0 && i < size) {
+	lock->AcquireRead();
+	if (map.Test(i))
+	    f = table[i];
+	lock->ReleaseRead();
+    }
+    return f;
 }
 
 int Table::Put(void *f) {
@@ -52,11 +61,11 @@ int Table::Put(void *f) {
     // lock so 2 files don't get the same space.
     int i;	// to find the next slot
 
-    lock->Acquire();
+    lock->AcquireWrite();
     i = map.Find();
-    lock->Release();
     if ( i != -1)
 	table[i] = f;
+    lock->ReleaseWrite();
     return i;
 }
 
@@ -67,13 +76,13 @@ void *Table::Remove(int i) {
     void *f =0;
 
     if ( i >= 0 && i < size ) {
-	lock->Acquire();
+	lock->AcquireWrite();
 	if ( map.Test(i) ) {
 	    map.Clear(i);
 	    f = table[i];
 	    table[i] = 0;
 	}
-	lock->Release();
+	lock->ReleaseWrite();
     }
     return f;
 }
@@ -125,6 +134,12 @@ AddrSpace::AddrSpace(OpenFile *executable) : fileTable(MaxOpenFiles)
     fileTable.Put(0);
     fileTable.Put(0);
 
+    for (i = 0; i < MaxMappings; i++)
+	mappings[i] = NULL;
+    mapLock = new Lock("mmap lock");
+    asyncIO = NULL;
+    profile = NULL;
+
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && (WordToHost(noffH.noffMagic) == NOFFMAGIC))
     {
@@ -132,6 +147,8 @@ AddrSpace::AddrSpace(OpenFile *executable) : fileTable(MaxOpenFiles)
     }
     	
     ASSERT(noffH.noffMagic == NOFFMAGIC);
+    codeStart = noffH.code.virtualAddr;
+    codeSize = noffH.code.size;
 
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size;
     numPages = divRoundUp(size, PageSize) + divRoundUp(UserStackSize, PageSize);
@@ -209,9 +226,33 @@ AddrSpace::AddrSpace(OpenFile *executable) : fileTable(MaxOpenFiles)
 
 AddrSpace::~AddrSpace()
 {
+    if (profile != NULL) {		// the program is done; say where
+	profile->Print();		// it spent its time
+	delete profile;
+    }
+    delete asyncIO;
+    for (int i = 0; i < MaxMappings; i++)
+	delete mappings[i];
+    delete mapLock;
     delete pageTable;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::StartProfile
+// 	Start counting samples of the program's PC, to be printed when
+//	the address space goes away.
+//
+//	"fileName" is the program's executable, whose COFF file has the
+//	symbols for the profile.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::StartProfile(char *fileName)
+{
+    if (profile == NULL)
+	profile = new Profile(fileName, codeStart, codeSize);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::InitRegisters
 // 	Set the initial values for the user-level register set.
@@ -347,6 +388,9 @@ void AddrSpace::ReclaimStack(int stackPage)
 
 void AddrSpace::ReclaimPageTable()
 {
+    if (asyncIO != NULL)		// I/O threads may still be using
+	asyncIO->Drain();		// our pages
+    UnmapAll();
     memLock->Acquire();
     for(int i = 0; i < numPages; i++)
     {
@@ -363,3 +407,359 @@ void AddrSpace::ReclaimPageTable()
 }
 
 
+
+//----------------------------------------------------------------------
+// AddrSpace::IsUnmappedPage
+// 	Return TRUE if virtual page "vpn" was given back by an earlier
+//	Munmap, and so can be used for a new mapping.  Such a page is
+//	invalid, has no physical page, and isn't part of any mapping --
+//	a mapped page that just hasn't been touched yet is in one.
+//	(Stacks given back by ReclaimStack keep their physical page
+//	number, so they're never mistaken for one.)
+//
+//	Assumes "mapLock" is held.
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsUnmappedPage(int vpn)
+{
+    if (pageTable[vpn].valid || (pageTable[vpn].physicalPage != -1))
+	return FALSE;
+    for (int i = 0; i < MaxMappings; i++)
+	if ((mappings[i] != NULL) && (vpn >= mappings[i]->firstPage) &&
+		(vpn < mappings[i]->firstPage + mappings[i]->numPages))
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindUnmappedRun
+// 	Look for "pages" pages in a row that were given back by Munmap,
+//	so that a new mapping can reuse them instead of growing the
+//	page table.
+//
+//	Returns the first page of the run, or -1 if there isn't one.
+//
+//	Assumes "mapLock" is held.
+//----------------------------------------------------------------------
+
+int AddrSpace::FindUnmappedRun(int pages)
+{
+    int run = 0;
+
+    for (int vpn = 0; vpn < (int) numPages; vpn++) {
+	if (IsUnmappedPage(vpn))
+	    run++;
+	else
+	    run = 0;
+	if (run == pages)
+	    return vpn - pages + 1;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Map
+// 	Map part of an open file into the address space, in pages given
+//	back by an earlier Munmap if there are enough of them in a row,
+//	or else after the pages already in use.  Nothing is read yet:
+//	the new pages are invalid, so the first reference to each one
+//	causes a page fault, and HandlePageFault reads it in from the
+//	file.
+//
+//	The file is looked up in "fileTable" only once "mapLock" is
+//	held.  Close takes it out of the table before it waits for
+//	"mapLock" to undo the file's mappings, so a file closed while
+//	we wait for the lock is never mapped, and one closed after we
+//	look it up isn't deleted until its mapping has been undone.
+//
+//	Returns the virtual address of the mapping, or -1 if the request
+//	doesn't make sense, the file isn't open, or there are too many
+//	mappings.
+//
+//	"id" -- the open file to map
+//	"offset" -- where in the file to start; must be a multiple of
+//		PageSize
+//	"length" -- how many bytes to map; 0 means to the end of the file
+//----------------------------------------------------------------------
+
+int AddrSpace::Map(int id, int offset, int length)
+{
+    TranslationEntry *newPT;
+    MmapRegion *region;
+    OpenFile *file;
+    int which, pages, first, i;
+
+    if ((offset < 0) || ((offset % PageSize) != 0) || (length < 0))
+	return -1;
+
+    mapLock->Acquire();
+    file = (OpenFile *) fileTable.Get(id);
+    if (file == NULL) {
+	mapLock->Release();
+	return -1;
+    }
+    if (length == 0)
+	length = file->Length() - offset;
+    if (length <= 0) {
+	mapLock->Release();
+	return -1;
+    }
+    pages = divRoundUp(length, PageSize);
+
+    for (which = 0; which < MaxMappings; which++)
+	if (mappings[which] == NULL)
+	    break;
+    if (which == MaxMappings) {
+	mapLock->Release();
+	return -1;
+    }
+
+    memLock->Acquire();
+    first = FindUnmappedRun(pages);
+    if (first == -1) {			// no room; grow the page table
+	first = numPages;
+	newPT = new TranslationEntry[numPages + pages];
+	for (i = 0; i < first; i++)
+	    newPT[i] = pageTable[i];
+	for (i = first; i < first + pages; i++) {
+	    newPT[i].virtualPage = i;
+	    newPT[i].physicalPage = -1;
+	    newPT[i].valid = FALSE;
+	    newPT[i].use = FALSE;
+	    newPT[i].dirty = FALSE;
+	    newPT[i].readOnly = FALSE;
+	}
+	delete pageTable;
+	pageTable = newPT;
+	numPages += pages;
+	RestoreState();
+    }
+
+    region = new MmapRegion;
+    region->firstPage = first;
+    region->numPages = pages;
+    region->file = file;
+    region->offset = offset;
+    region->length = length;
+    mappings[which] = region;
+    memLock->Release();
+    mapLock->Release();
+
+    DEBUG('a', "Mapped %d bytes at offset %d to 0x%x\n", length, offset,
+		region->firstPage * PageSize);
+    return region->firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandlePageFault
+// 	Bring in a page of a mapped file, the first time it is
+//	referenced.  The part of the page past the end of the mapping
+//	is zeroed.
+//
+//	Returns FALSE if "vpn" isn't part of any mapping -- a real
+//	error in the user program.
+//
+//	"vpn" -- the virtual page that faulted
+//----------------------------------------------------------------------
+
+bool AddrSpace::HandlePageFault(int vpn)
+{
+    MmapRegion *region = NULL;
+    int ppn, position, bytes;
+    char *page;
+
+    mapLock->Acquire();
+    for (int i = 0; i < MaxMappings; i++)
+	if ((mappings[i] != NULL) && (vpn >= mappings[i]->firstPage) &&
+		(vpn < mappings[i]->firstPage + mappings[i]->numPages)) {
+	    region = mappings[i];
+	    break;
+	}
+    if (region == NULL) {
+	mapLock->Release();
+	return FALSE;
+    }
+    if (pageTable[vpn].valid) {		// another thread got here first
+	mapLock->Release();
+	return TRUE;
+    }
+
+    memLock->Acquire();
+    ppn = memBitMap->Find();
+    memLock->Release();
+    if (ppn == -1) {
+	printf("No more physical memory available.\n");
+	interrupt->Halt();
+    }
+
+    page = &(machine->mainMemory[ppn * PageSize]);
+    position = (vpn - region->firstPage) * PageSize;
+    bytes = min(PageSize, region->length - position);
+    bytes = region->file->ReadAt(page, bytes, region->offset + position);
+    if (bytes < 0)
+	bytes = 0;
+    bzero(page + bytes, PageSize - bytes);
+
+    pageTable[vpn].physicalPage = ppn;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;
+    pageTable[vpn].valid = TRUE;
+    stats->numPageFaults++;
+    currentThread->account->numPageFaults++;
+    mapLock->Release();
+
+    DEBUG('a', "Page fault on mapped page %d, loaded into frame %d\n", vpn,
+		ppn);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseMapping
+// 	Write the dirty pages of a mapping back to its file, then free
+//	its physical pages.  Its virtual pages stay in the page table,
+//	but invalid, so touching them again is an error, until a later
+//	Map reuses them.  Unmapped pages at the end of the page table
+//	are dropped from it, so a program that maps and unmaps over and
+//	over doesn't keep growing its address space.
+//
+//	Assumes "mapLock" is held.
+//----------------------------------------------------------------------
+
+void AddrSpace::ReleaseMapping(int which)
+{
+    MmapRegion *region = mappings[which];
+    int vpn, position, bytes;
+
+    for (int i = 0; i < region->numPages; i++) {
+	vpn = region->firstPage + i;
+	if (!pageTable[vpn].valid)
+	    continue;
+	if (pageTable[vpn].dirty) {
+	    position = i * PageSize;
+	    bytes = min(PageSize, region->length - position);
+	    region->file->WriteAt(
+		&(machine->mainMemory[pageTable[vpn].physicalPage * PageSize]),
+		bytes, region->offset + position);
+	}
+	memLock->Acquire();
+	memBitMap->Clear(pageTable[vpn].physicalPage);
+	memLock->Release();
+	pageTable[vpn].physicalPage = -1;
+	pageTable[vpn].valid = FALSE;
+	pageTable[vpn].use = FALSE;
+	pageTable[vpn].dirty = FALSE;
+    }
+    delete region;
+    mappings[which] = NULL;
+
+    memLock->Acquire();
+    while ((numPages > 0) && IsUnmappedPage(numPages - 1))
+	numPages--;
+    RestoreState();
+    memLock->Release();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap
+// 	Undo the Map that returned "vaddr".  Returns FALSE if there
+//	isn't one.
+//----------------------------------------------------------------------
+
+bool AddrSpace::Unmap(int vaddr)
+{
+    bool found = FALSE;
+
+    mapLock->Acquire();
+    for (int i = 0; i < MaxMappings; i++)
+	if ((mappings[i] != NULL) &&
+		(mappings[i]->firstPage * PageSize == vaddr)) {
+	    ReleaseMapping(i);
+	    found = TRUE;
+	    break;
+	}
+    mapLock->Release();
+    return found;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapFile
+// 	Undo every mapping of "file", which is about to be closed.
+//----------------------------------------------------------------------
+
+void AddrSpace::UnmapFile(OpenFile *file)
+{
+    mapLock->Acquire();
+    for (int i = 0; i < MaxMappings; i++)
+	if ((mappings[i] != NULL) && (mappings[i]->file == file))
+	    ReleaseMapping(i);
+    mapLock->Release();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapAll
+// 	Undo every mapping, when the process goes away.
+//----------------------------------------------------------------------
+
+void AddrSpace::UnmapAll()
+{
+    mapLock->Acquire();
+    for (int i = 0; i < MaxMappings; i++)
+	if (mappings[i] != NULL)
+	    ReleaseMapping(i);
+    mapLock->Release();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn
+// 	Copy "len" bytes at virtual address "vaddr" in this address space
+//	into "buf".  Unlike machine->ReadMem, this walks our own page
+//	table, so it works from kernel threads (like the asynchronous
+//	I/O threads) that aren't running in this address space.
+//
+//	Returns the number of bytes copied, or -1 if "vaddr" is bad.
+//----------------------------------------------------------------------
+
+int AddrSpace::CopyIn(int vaddr, char *buf, int len)
+{
+    int vpn, offset;
+
+    for (int i = 0; i < len; i++, vaddr++) {
+	vpn = vaddr / PageSize;
+	offset = vaddr % PageSize;
+	if ((vaddr < 0) || (vpn >= (int)numPages))
+	    return -1;
+	if (!pageTable[vpn].valid && !HandlePageFault(vpn))
+	    return -1;
+	pageTable[vpn].use = TRUE;
+	buf[i] = machine->mainMemory[pageTable[vpn].physicalPage * PageSize +
+					offset];
+    }
+    return len;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOut
+// 	Copy "len" bytes from "buf" to virtual address "vaddr" in this
+//	address space.  See CopyIn.
+//----------------------------------------------------------------------
+
+int AddrSpace::CopyOut(int vaddr, char *buf, int len)
+{
+    int vpn, offset;
+
+    for (int i = 0; i < len; i++, vaddr++) {
+	vpn = vaddr / PageSize;
+	offset = vaddr % PageSize;
+	if ((vaddr < 0) || (vpn >= (int)numPages))
+	    return -1;
+	if (!pageTable[vpn].valid && !HandlePageFault(vpn))
+	    return -1;
+	if (pageTable[vpn].readOnly)
+	    return -1;
+	pageTable[vpn].use = TRUE;
+	pageTable[vpn].dirty = TRUE;
+	machine->mainMemory[pageTable[vpn].physicalPage * PageSize + offset] =
+		buf[i];
+    }
+    return len;
+}
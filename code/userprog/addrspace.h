@@ -16,11 +16,29 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "table.h"
+#include "profile.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
 
 #define MaxOpenFiles 256
 #define MaxChildSpaces 256
+#define MaxMappings 16			// memory-mapped files per process
+
+class Lock;
+class AsyncIO;
+
+// A file (or part of one) mapped into an address space by Mmap.  The
+// pages start out invalid, and are read in from the file the first
+// time they are touched; dirty pages are written back on Munmap.
+
+class MmapRegion {
+  public:
+    int firstPage;			// First virtual page of the mapping
+    int numPages;			// Pages in the mapping
+    OpenFile *file;			// The file being mapped
+    int offset;				// Where in the file the mapping starts
+    int length;				// Number of bytes mapped
+};
 
 class AddrSpace {
   public:
@@ -40,11 +58,41 @@ class AddrSpace {
     void ReclaimStack(int stackPage);
     void ReclaimPageTable();
 
+    int Map(int id, int offset, int length);
+					// Map part of open file "id" into the
+					// address space; return its virtual
+					// address
+    bool Unmap(int vaddr);		// Undo a Map, writing back dirty pages
+    void UnmapFile(OpenFile *file);	// Undo every Map of "file"
+    void UnmapAll();			// Undo every Map
+    bool HandlePageFault(int vpn);	// Bring in a page of a mapped file
+
+    int CopyIn(int vaddr, char *buf, int len);
+    int CopyOut(int vaddr, char *buf, int len);
+					// Copy to/from this address space
+					// from a thread that may not be
+					// running in it
+
+    AsyncIO *asyncIO;			// Rings registered by IoSetup, or NULL
+
+    void StartProfile(char *fileName);	// Start sampling the program's PC;
+					// "fileName" is its executable
+    Profile *profile;			// Its PC samples, or NULL
+
  private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    MmapRegion *mappings[MaxMappings];	// Files mapped by Mmap
+    Lock *mapLock;			// Protects "mappings", and page faults
+					// on mapped pages
+    int codeStart, codeSize;		// Where the code segment is
+
+    void ReleaseMapping(int which);	// Write back and free a mapping
+    bool IsUnmappedPage(int vpn);	// Freed by an earlier Munmap?
+    int FindUnmappedRun(int pages);	// Where "pages" such pages in a row
+					// start, or -1
 };
 
 #endif // ADDRSPACE_H
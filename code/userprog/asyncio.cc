@@ -0,0 +1,262 @@
+// asyncio.cc
+//	Routines to let a user program have several file reads and
+//	writes in progress at once.
+//
+//	IoEnter runs in the user thread: it copies requests out of the
+//	submission ring (and, for writes, the data to be written) and
+//	appends them to "ioQueue".  A small pool of kernel threads takes
+//	requests off the queue and does the I/O; under the real file
+//	system, that is where the thread blocks on SynchDisk.  When a
+//	request is done, its I/O thread copies the data (for reads) and
+//	a completion into the process' memory through the process' own
+//	page table, since the I/O thread has no address space of its own.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "syscall.h"
+#include "asyncio.h"
+#include "synchlist.h"
+
+static SynchList *ioQueue = NULL;	// IoOps waiting for an I/O thread
+
+//----------------------------------------------------------------------
+// IoThread
+// 	Body of a kernel I/O thread: do requests forever.
+//----------------------------------------------------------------------
+
+static void
+IoThread(int which)
+{
+    IoOp *op;
+    int result;
+
+    for (;;) {
+	op = (IoOp *) ioQueue->Remove();
+	DEBUG('a', "I/O thread %d: %s of %d bytes at %d\n", which,
+		(op->op == IoRead) ? "read" : "write", op->len, op->offset);
+	if (op->op == IoRead)
+	    result = op->file->ReadAt(op->data, op->len, op->offset);
+	else
+	    result = op->file->WriteAt(op->data, op->len, op->offset);
+	op->owner->Complete(op, result);
+    }
+}
+
+//----------------------------------------------------------------------
+// StartIoThreads
+// 	Fork the kernel I/O threads, the first time a process asks for
+//	asynchronous I/O.
+//----------------------------------------------------------------------
+
+void
+StartIoThreads()
+{
+    Thread *t;
+
+    if (ioQueue != NULL)
+	return;
+    ioQueue = new SynchList;
+    for (int i = 0; i < NumIoThreads; i++) {
+	t = new Thread("io thread");
+	t->Fork(IoThread, i);
+    }
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::AsyncIO
+// 	Set up asynchronous I/O for a process, using the IoRing at user
+//	address "ringAddr".  If the ring's size is out of range, or the
+//	rings aren't all in the address space, "valid" is set to FALSE.
+//
+//	"procSpace" -- the process' address space
+//	"ringAddr" -- user address of its IoRing
+//----------------------------------------------------------------------
+
+AsyncIO::AsyncIO(AddrSpace *procSpace, int ringAddr)
+{
+    char probe;
+
+    space = procSpace;
+    ring = ringAddr;
+    lock = new Lock("async io lock");
+    completed = new Condition("async io completed");
+    inFlight = 0;
+
+    size = ReadWord(ring + RingSize * 4);
+    sq = ReadWord(ring + RingSq * 4);
+    cq = ReadWord(ring + RingCq * 4);
+    cqTail = ReadWord(ring + RingCqTail * 4);
+    valid = (size > 0) && (size <= MaxIoRingSize) &&
+	    (space->CopyIn(ring + RingCq * 4, &probe, 1) == 1) &&
+	    (space->CopyIn(sq, &probe, 1) == 1) &&
+	    (space->CopyIn(sq + size * RequestWords * 4 - 1, &probe, 1) == 1) &&
+	    (space->CopyIn(cq, &probe, 1) == 1) &&
+	    (space->CopyIn(cq + size * CompletionWords * 4 - 1, &probe, 1) == 1);
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::~AsyncIO
+// 	The process is going away; wait for the I/O threads to finish
+//	with its memory first.
+//----------------------------------------------------------------------
+
+AsyncIO::~AsyncIO()
+{
+    Drain();
+    delete lock;
+    delete completed;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::ReadWord, AsyncIO::WriteWord
+// 	Read or write an integer in the process' memory.  A bad address
+//	reads as -1, and writes to one are dropped.
+//----------------------------------------------------------------------
+
+int
+AsyncIO::ReadWord(int vaddr)
+{
+    int value;
+
+    if (space->CopyIn(vaddr, (char *)&value, 4) != 4)
+	return -1;
+    return WordToHost(value);
+}
+
+void
+AsyncIO::WriteWord(int vaddr, int value)
+{
+    value = WordToMachine(value);
+    space->CopyOut(vaddr, (char *)&value, 4);
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Post
+// 	Add a completion to the completion ring.  Enter never lets more
+//	requests be outstanding than there is room for, so there is
+//	always a free slot.
+//
+//	Assumes "lock" is held.
+//----------------------------------------------------------------------
+
+void
+AsyncIO::Post(int tag, int result)
+{
+    int slot = cq + (cqTail % size) * CompletionWords * 4;
+
+    WriteWord(slot, tag);
+    WriteWord(slot + 4, result);
+    cqTail++;
+    WriteWord(ring + RingCqTail * 4, cqTail);
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Enter
+// 	Hand every request in the submission ring to the I/O threads,
+//	as long as there is room left in the completion ring for its
+//	result.  Bad requests complete at once, with a result of -1.
+//	Then wait until at least "minComplete" completions are waiting
+//	for the process to consume them, or nothing is outstanding.
+//
+//	Returns the number of requests taken off the submission ring.
+//----------------------------------------------------------------------
+
+int
+AsyncIO::Enter(int minComplete)
+{
+    int req[RequestWords];
+    int head, tail, slot, i, submitted = 0;
+    IoOp *op;
+    OpenFile *file;
+
+    lock->Acquire();
+    head = ReadWord(ring + RingSqHead * 4);
+    tail = ReadWord(ring + RingSqTail * 4);
+    for (; head != tail; head++) {
+	if (inFlight + (cqTail - ReadWord(ring + RingCqHead * 4)) >= size)
+	    break;			// completion ring could overflow
+	slot = sq + (head % size) * RequestWords * 4;
+	for (i = 0; i < RequestWords; i++)
+	    req[i] = ReadWord(slot + i * 4);
+	submitted++;
+
+	// req[] is { op, fd, buf, len, offset, tag }
+	file = NULL;
+	if (req[1] != ConsoleInput && req[1] != ConsoleOutput)
+	    file = (OpenFile *) space->fileTable.Get(req[1]);
+	if ((file == NULL) || ((req[0] != IoRead) && (req[0] != IoWrite)) ||
+		(req[3] < 0) || (req[3] > MaxIoLength) || (req[4] < 0)) {
+	    Post(req[5], -1);
+	    continue;
+	}
+
+	op = new IoOp;
+	op->owner = this;
+	op->op = req[0];
+	op->file = file;
+	op->buf = req[2];
+	op->len = req[3];
+	op->offset = req[4];
+	op->tag = req[5];
+	op->data = new char[op->len + 1];
+	if ((op->op == IoWrite) &&
+		(space->CopyIn(op->buf, op->data, op->len) != op->len)) {
+	    Post(op->tag, -1);
+	    delete [] op->data;
+	    delete op;
+	    continue;
+	}
+	inFlight++;
+	ioQueue->Append((void *)op);
+    }
+    WriteWord(ring + RingSqHead * 4, head);
+
+    while ((inFlight > 0) &&
+	    (cqTail - ReadWord(ring + RingCqHead * 4) < minComplete))
+	completed->Wait(lock);
+    lock->Release();
+    return submitted;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Complete
+// 	An I/O thread finished "op".  Copy what was read into the
+//	process' buffer, post the completion, and wake up anyone waiting
+//	in Enter or Drain.
+//----------------------------------------------------------------------
+
+void
+AsyncIO::Complete(IoOp *op, int result)
+{
+    if ((op->op == IoRead) && (result > 0) &&
+	    (space->CopyOut(op->buf, op->data, result) != result))
+	result = -1;
+
+    lock->Acquire();
+    Post(op->tag, result);
+    inFlight--;
+    completed->Broadcast(lock);
+    lock->Release();
+
+    delete [] op->data;
+    delete op;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Drain
+// 	Wait until every request handed to the I/O threads is done; for
+//	instance, before closing a file they might be using.
+//----------------------------------------------------------------------
+
+void
+AsyncIO::Drain()
+{
+    lock->Acquire();
+    while (inFlight > 0)
+	completed->Wait(lock);
+    lock->Release();
+}
@@ -0,0 +1,92 @@
+// asyncio.h
+//	Data structures for asynchronous file I/O from user programs.
+//
+//	A process registers a pair of rings in its own memory (see
+//	IoRing in syscall.h).  IoEnter hands the requests in the
+//	submission ring to a pool of kernel I/O threads, and returns
+//	without waiting for them; each I/O thread does one read or write
+//	at a time, blocking on the disk instead of the user thread, and
+//	posts the result to the completion ring.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include "openfile.h"
+#include "synch.h"
+
+#define NumIoThreads		4	// kernel threads doing async I/O
+#define MaxIoLength		4096	// biggest single request
+
+// The kernel can't use the IoRing, IoRequest and IoCompletion structs
+// from syscall.h directly, since pointers are a different size on the
+// host.  These are the offsets of their fields, in words, as laid out
+// by the MIPS compiler.
+#define RingSize		0
+#define RingSqHead		1
+#define RingSqTail		2
+#define RingCqHead		3
+#define RingCqTail		4
+#define RingSq			5
+#define RingCq			6
+
+#define RequestWords		6	// op, fd, buf, len, offset, tag
+#define CompletionWords		2	// tag, result
+
+class AsyncIO;
+class AddrSpace;
+
+// One request, on its way through an I/O thread.
+
+class IoOp {
+  public:
+    AsyncIO *owner;			// Process that submitted it
+    int op;				// IoRead or IoWrite
+    OpenFile *file;
+    int buf;				// User address of the data
+    int len;
+    int offset;
+    int tag;
+    char *data;				// Kernel copy of the data
+};
+
+// The asynchronous I/O state of one process.
+
+class AsyncIO {
+  public:
+    AsyncIO(AddrSpace *procSpace, int ringAddr);
+    ~AsyncIO();				// Waits for outstanding requests
+
+    bool valid;				// Was the ring usable?
+
+    int Enter(int minComplete);		// Submit requests, and maybe wait
+					// for completions
+    void Complete(IoOp *op, int result);
+					// Post a completion; called by an
+					// I/O thread
+    void Drain();			// Wait until nothing is outstanding
+
+  private:
+    AddrSpace *space;			// The process' address space
+    int ring;				// User address of its IoRing
+    int size;				// Entries in each ring
+    int sq, cq;				// User addresses of the rings
+    int cqTail;				// Kernel's copy of ring->cqTail
+    Lock *lock;				// Protects the rest, and the ring
+    Condition *completed;		// Signalled when a request finishes
+    int inFlight;			// Requests handed to I/O threads
+
+    int ReadWord(int vaddr);
+    void WriteWord(int vaddr, int value);
+    void Post(int tag, int result);	// Add an entry to the completion ring
+};
+
+extern void StartIoThreads();		// Fork the I/O threads, if that
+					// hasn't been done yet
+
+#endif // ASYNCIO_H
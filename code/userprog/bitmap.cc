@@ -102,6 +102,69 @@ BitMap::Find()
     return -1;
 }
 
+//----------------------------------------------------------------------
+// BitMap::FindNear
+// 	Like Find, but start the search at "hint" and wrap around to the
+//	beginning of the bitmap.  Used to keep related allocations (such
+//	as the sectors of a growing file) close together.
+//
+//	"hint" is the first bit to look at.
+//----------------------------------------------------------------------
+
+int 
+BitMap::FindNear(int hint) 
+{
+    if (hint < 0 || hint >= numBits)
+	hint = 0;
+    for (int n = 0; n < numBits; n++) {
+	int i = (hint + n) % numBits;
+	if (!Test(i)) {
+	    Mark(i);
+	    return i;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Find "count" consecutive clear bits, starting the search at "hint"
+//	and wrapping around.  As a side effect, set all of the bits in the 
+//	run.
+//
+//	If there is no run of "count" clear bits, return -1 and leave the 
+//	bitmap unchanged.
+//
+//	"count" is the length of the run wanted
+//	"hint" is the first bit to look at
+//----------------------------------------------------------------------
+
+int 
+BitMap::FindRun(int count, int hint) 
+{
+    if (count <= 0 || count > numBits)
+	return -1;
+    if (hint < 0 || hint >= numBits)
+	hint = 0;
+
+    for (int n = 0; n < numBits; n++) {
+	int start = (hint + n) % numBits;
+	int len = 0;
+
+	if (start + count > numBits)	// runs don't wrap around
+	    continue;
+	while (len < count && !Test(start + len))
+	    len++;
+	if (len == count) {
+	    for (int i = start; i < start + count; i++)
+		Mark(i);
+	    return start;
+	}
+	n += len;			// skip past the bits we just checked
+    }
+    return -1;
+}
+
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
@@ -43,6 +43,13 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindNear(int hint);	// Like Find, but start looking at "hint"
+				// and wrap around
+    int FindRun(int count, int hint);
+				// Find and set "count" consecutive clear
+				// bits, searching from "hint".  Return the
+				// first bit of the run, or -1 if there is
+				// no run that long.
     int NumClear();		// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
@@ -23,6 +23,7 @@
 #include "copyright.h"
 #include "system.h"
 #include "syscall.h"
+#include "asyncio.h"
 #include <stdio.h>
 #include <iostream>
 #include <string>
@@ -53,10 +54,15 @@ int copyin(unsigned int vaddr, int len, char *buf)
     {
         result = machine->ReadMem( vaddr, 1, paddr ); // Read 1 byte at vaddr into paddr
 
-        //while(!result) // FALL 09 CHANGES
-        //{
-        //    result = machine->ReadMem( vaddr, 1, paddr ); // FALL 09 CHANGES: TO HANDLE PAGE FAULT IN THE ReadMem SYS CALL
-        //}
+        // A failed ReadMem has already run the page fault handler; if
+        // vaddr is in a mapped file, the page is there now, so try once
+        // more.  RaiseException left us in UserMode; we're still in
+        // the kernel.
+        if (!result)
+        {
+            interrupt->setStatus(SystemMode);
+            result = machine->ReadMem( vaddr, 1, paddr );
+        }
 
         buf[bytes++] = *paddr; // Update value of buffer to byte read from vaddr (per loop)
 
@@ -91,7 +97,15 @@ int copyout(unsigned int vaddr, int len, char *buf) {
     while ( bytes >= 0 && bytes < len)
     {
         // Note that we check every byte's address
-        result = machine->WriteMem( vaddr, 1, (int)(buf[bytes++]) ); // Write 1 byte of buffer to vaddr
+        result = machine->WriteMem( vaddr, 1, (int)(buf[bytes]) ); // Write 1 byte of buffer to vaddr
+
+        // Retry after a page fault, as in copyin
+        if (!result)
+        {
+            interrupt->setStatus(SystemMode);
+            result = machine->WriteMem( vaddr, 1, (int)(buf[bytes]) );
+        }
+        bytes++;
 
         // If translation failed
         if (!result)
@@ -312,6 +326,11 @@ void Close_Syscall(int fd) {
 
     if (f)
     {
+        // Write back and drop any mappings of the file first, and
+        // make sure no asynchronous I/O is still using it
+        currentThread->space->UnmapFile(f);
+        if (currentThread->space->asyncIO)
+            currentThread->space->asyncIO->Drain();
         delete f;
     }
     else
@@ -320,6 +339,90 @@ void Close_Syscall(int fd) {
     }
 }
 
+//----------------------------------------------------------------------
+// Mmap_Syscall
+//  Map length bytes of the open file id, starting at offset, into the
+//  process' address space.  Pages are read in on first touch (see
+//  AddrSpace::HandlePageFault), and modified pages are written back
+//  to the file by Munmap, Close or Exit.  Returns the virtual address
+//  of the mapping, or -1 on error.
+//
+//  "id" -- the open file to map
+//  "offset" -- where in the file to start, a multiple of PageSize
+//  "length" -- bytes to map, or 0 for the rest of the file
+//----------------------------------------------------------------------
+
+int Mmap_Syscall(int id, int offset, int length)
+{
+    // Map looks the file up itself, holding the lock that Close waits
+    // for, so the file can't be deleted out from under the mapping
+    int vaddr = currentThread->space->Map(id, offset, length);
+
+    if (vaddr == -1)
+        printf("%s","Mmap failed: bad OpenFileId, offset or length, or too many mappings\n");
+    return vaddr;
+}
+
+//----------------------------------------------------------------------
+// Munmap_Syscall
+//  Undo the Mmap that returned addr, writing modified pages back to
+//  the file.
+//----------------------------------------------------------------------
+
+void Munmap_Syscall(int addr)
+{
+    if (!currentThread->space->Unmap(addr))
+        printf("%s","Bad address passed to Munmap\n");
+}
+
+//----------------------------------------------------------------------
+// IoSetup_Syscall
+//  Register the IoRing at vaddr for asynchronous I/O, starting the
+//  kernel I/O threads if this is the first process to use them.
+//  Returns 0, or -1 if the ring is bad or one is already registered.
+//----------------------------------------------------------------------
+
+int IoSetup_Syscall(int vaddr)
+{
+    AddrSpace *space = currentThread->space;
+    AsyncIO *aio;
+
+    if (space->asyncIO)
+    {
+        printf("%s","IoSetup called twice\n");
+        return -1;
+    }
+
+    aio = new AsyncIO(space, vaddr);
+    if (!aio->valid)
+    {
+        printf("%s","Bad ring passed to IoSetup\n");
+        delete aio;
+        return -1;
+    }
+
+    StartIoThreads();
+    space->asyncIO = aio;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// IoEnter_Syscall
+//  Submit the process' queued I/O requests, and wait for at least
+//  minComplete completions.  Returns the number submitted, or -1 if
+//  IoSetup wasn't called.
+//----------------------------------------------------------------------
+
+int IoEnter_Syscall(int minComplete)
+{
+    if (!currentThread->space->asyncIO)
+    {
+        printf("%s","IoEnter called before IoSetup\n");
+        return -1;
+    }
+    return currentThread->space->asyncIO->Enter(minComplete);
+}
+
 //----------------------------------------------------------------------
 // PrintError_Syscall
 //  Helper Method for printing red output to console while debugging.
@@ -427,16 +530,17 @@ int Random_Syscall(int lower, int upper)
 }
 
 //----------------------------------------------------------------------
-// validatelockindex
+// checklockindex
 //  Validate lock index corresponds to a (1) valid location, (2) defined
-//  lock that (3) belongs to currentThread's process.
+//  lock that (3) belongs to currentThread's process. The caller holds
+//  locksLock.
 //
 //  Returns -1 if invalid index, 0 if valid
 //
 //  "index" -- the location of the KernelLock object inside locks 
 //----------------------------------------------------------------------
 
-int validatelockindex(int index)
+static int checklockindex(int index)
 {
     // (1) Index corresponds to valid location
     if (index < 0)
@@ -473,6 +577,75 @@ int validatelockindex(int index)
     return 0;
 }
 
+//----------------------------------------------------------------------
+// validatelockindex
+//  checklockindex, holding the lock table for reading so lookups
+//  don't wait for one another.
+//
+//  Returns -1 if invalid index, 0 if valid
+//----------------------------------------------------------------------
+
+int validatelockindex(int index)
+{
+    locksLock->AcquireRead();
+    int result = checklockindex(index);
+    locksLock->ReleaseRead();
+
+    return result;
+}
+
+#ifdef NETWORK
+//----------------------------------------------------------------------
+// RemoteLockCall
+//  When Nachos is started with "-ls", Lock and Condition syscalls are
+//  carried out by the lock server instead of the local tables.  Every
+//  call waits for the server's reply, so the thread counts as
+//  sleeping while it's outstanding, just as it would inside a local
+//  Acquire or Wait.
+//
+//  Returns the server's result
+//
+//  "op" -- the LockOp to perform
+//  "indexlock", "indexcv" -- what it's about (-1 if not used)
+//  "value" -- for CreateMVOp, the size of the MV
+//  "vaddr", "len" -- for the Create ops, where to find the name
+//----------------------------------------------------------------------
+
+int RemoteLockCall(int op, int indexlock, int indexcv, int value,
+                   unsigned int vaddr, int len)
+{
+    char buf[MaxLockName + 1];
+    char * name = NULL;
+    int result;
+
+    if (op == CreateLockOp || op == CreateCVOp || op == CreateMVOp)
+    {
+        // Names longer than the protocol allows are truncated
+        if (len <= 0 || copyin(vaddr, min(len, MaxLockName), buf) == -1)
+        {
+            printf("%s","Bad name passed to create remote lock, CV or MV\n");
+            return -1;
+        }
+        buf[min(len, MaxLockName)] = '\0';
+        name = buf;
+    }
+
+    processLock->Acquire();
+    processInfo.at(currentThread->processID)->numExecutingThreads--;
+    processInfo.at(currentThread->processID)->numSleepingThreads++;
+    processLock->Release();
+
+    result = lockClient->Call(op, indexlock, indexcv, value, name);
+
+    processLock->Acquire();
+    processInfo.at(currentThread->processID)->numExecutingThreads++;
+    processInfo.at(currentThread->processID)->numSleepingThreads--;
+    processLock->Release();
+
+    return result;
+}
+#endif // NETWORK
+
 //----------------------------------------------------------------------
 // CreateLock_Syscall
 //  After grabbing the name for the lock, adds a new KernelLock holding
@@ -487,13 +660,18 @@ int validatelockindex(int index)
 
 int CreateLock_Syscall(unsigned int vaddr, int len) 
 {
-    locksLock->Acquire(); // Interupts enabled, need to synchronize
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(CreateLockOp, -1, -1, 0, vaddr, len);
+#endif
+
+    locksLock->AcquireWrite(); // Interupts enabled, need to synchronize
 
     // Validate length is nonzero and positive
     if (len <= 0)
     {
         printf("%s","Length for lock's identifier name must be nonzero and positive\n");
-        locksLock->Release();
+        locksLock->ReleaseWrite();
         return -1;
     }
 
@@ -503,7 +681,7 @@ int CreateLock_Syscall(unsigned int vaddr, int len)
     if (!buf)
     {
         printf("%s","Error allocating kernel buffer for creating new lock!\n");
-        locksLock->Release();
+        locksLock->ReleaseWrite();
         return -1;
     }
 
@@ -511,7 +689,7 @@ int CreateLock_Syscall(unsigned int vaddr, int len)
     if (copyin(vaddr, len, buf) == -1)
     {
         printf("%s","Bad pointer passed to create new lock\n");
-        locksLock->Release();
+        locksLock->ReleaseWrite();
         delete[] buf;
         return -1;
     }
@@ -526,7 +704,7 @@ int CreateLock_Syscall(unsigned int vaddr, int len)
     locks.push_back(newKernelLock); // Add to lock collection; indexed by lockID
     int indexLock = locks.size() - 1;
 
-    locksLock->Release();
+    locksLock->ReleaseWrite();
 
     return indexLock; // Processes can Acquire/Release
 }
@@ -546,6 +724,11 @@ int CreateLock_Syscall(unsigned int vaddr, int len)
 
 int AcquireLock_Syscall(int indexlock)
 {
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(AcquireOp, indexlock, -1, 0, 0, 0);
+#endif
+
     // Lock index: (1) valid location, (2) defined, (3) belongs to currentThread's process
     if (validatelockindex(indexlock) == -1)
     {
@@ -609,6 +792,11 @@ void deletelock(int indexlock)
 
 int ReleaseLock_Syscall(int indexlock)
 {
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(ReleaseOp, indexlock, -1, 0, 0, 0);
+#endif
+
     // Lock index: (1) valid location, (2) defined, (3) belongs to currentThread's process
     if (validatelockindex(indexlock) == -1)
     {
@@ -621,9 +809,9 @@ int ReleaseLock_Syscall(int indexlock)
     // If no waiting threads and marked for deletion
     if (curKernelLock->toDelete && curKernelLock->lock->sleepqueue->IsEmpty() && !curKernelLock->lock->state)
     {
-        locksLock->Acquire();
+        locksLock->AcquireWrite();
         deletelock(indexlock);
-        locksLock->Release();
+        locksLock->ReleaseWrite();
     }
 
     return indexlock;
@@ -643,32 +831,37 @@ int ReleaseLock_Syscall(int indexlock)
 
 int DestroyLock_Syscall(int indexlock)
 {
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(DestroyLockOp, indexlock, -1, 0, 0, 0);
+#endif
+
     // Lock index: (1) valid location, (2) defined, (3) belongs to currentThread's process
     if (validatelockindex(indexlock) == -1)
     {
         return -1;
     }
 
-    locksLock->Acquire();
+    locksLock->AcquireWrite();
 
     KernelLock * currentKernelLock = locks.at(indexlock);
 
     if (currentKernelLock->lock->sleepqueue->IsEmpty() && !currentKernelLock->lock->state)
     {
         deletelock(indexlock);
-        locksLock->Release();
+        locksLock->ReleaseWrite();
         return 0;
     }
 
     // Threads are waiting to Acquire; Let them use lock then Delete on last Release.
     printf("Lock %d toDelete is set to true. Cannot be deleted because sleepqueue is not empty.\n", indexlock);
     currentKernelLock->toDelete = true;
-    locksLock->Release();
+    locksLock->ReleaseWrite();
     return -1;
 }
 
 //----------------------------------------------------------------------
-// validatecvindeces
+// checkcvindeces
 //  Validate lock and cv index corresponds to a (1) valid location, 
 //  (2) defined lock and cv that (3) belongs to currentThread's process.
 //
@@ -678,7 +871,7 @@ int DestroyLock_Syscall(int indexlock)
 //  "indexcv" -- the location of the KernerlCV object inside conditions 
 //----------------------------------------------------------------------
 
-int validatecvindeces(int indexcv, int indexlock)
+static int checkcvindeces(int indexcv, int indexlock)
 {
     // (1) index to valid location
     if (indexcv < 0 || indexlock < 0)
@@ -724,6 +917,25 @@ int validatecvindeces(int indexcv, int indexlock)
     return 0;
 }
 
+//----------------------------------------------------------------------
+// validatecvindeces
+//  checkcvindeces, holding both tables for reading. The lock table is
+//  always taken first.
+//
+//  Returns -1 if invalid indeces, 0 if valid
+//----------------------------------------------------------------------
+
+int validatecvindeces(int indexcv, int indexlock)
+{
+    locksLock->AcquireRead();
+    conditionsLock->AcquireRead();
+    int result = checkcvindeces(indexcv, indexlock);
+    conditionsLock->ReleaseRead();
+    locksLock->ReleaseRead();
+
+    return result;
+}
+
 //----------------------------------------------------------------------
 // CreateCV_Syscall
 //  Creates a condition with the specified name. KernelCV inside of 
@@ -738,13 +950,18 @@ int validatecvindeces(int indexcv, int indexlock)
 
 int CreateCV_Syscall(unsigned int vaddr, int len)
 {
-    conditionsLock->Acquire(); // Synchronize CV creation; Interrupts enabled
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(CreateCVOp, -1, -1, 0, vaddr, len);
+#endif
+
+    conditionsLock->AcquireWrite(); // Synchronize CV creation; Interrupts enabled
 
     // Validate length is nonzero and positive
     if (len <= 0)
     {
         printf("Invalid length for CV identifier\n");
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return -1;
     }
 
@@ -754,7 +971,7 @@ int CreateCV_Syscall(unsigned int vaddr, int len)
     if (!buf)
     {
         printf("Error allocating kernel buffer for creating new CV!\n");
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return -1;
     }
 
@@ -763,7 +980,7 @@ int CreateCV_Syscall(unsigned int vaddr, int len)
     {
         printf("Bad pointer passed to create new CV\n");
         delete[] buf;
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return -1;
     }
 
@@ -777,7 +994,7 @@ int CreateCV_Syscall(unsigned int vaddr, int len)
     conditions.push_back(newKernelCV); // Add to collection for later usage
     int conditionIndex = conditions.size() - 1;
 
-    conditionsLock->Release();
+    conditionsLock->ReleaseWrite();
 
     return conditionIndex; // User can call Wait, Signal, Broadcast
 }
@@ -797,6 +1014,11 @@ int CreateCV_Syscall(unsigned int vaddr, int len)
 
 int Wait_Syscall(int indexcv, int indexlock)
 {
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(WaitOp, indexlock, indexcv, 0, 0, 0);
+#endif
+
     // Lock/CV indeces: (1) valid location, (2) defined, (3) belongs to currentThread's process
     if (validatecvindeces(indexcv, indexlock) == -1)
     {
@@ -863,6 +1085,11 @@ void deletecondition(int indexcv)
 
 int Signal_Syscall(int indexcv, int indexlock)
 {
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(SignalOp, indexlock, indexcv, 0, 0, 0);
+#endif
+
     // Lock/CV indeces: (1) valid location, (2) defined, (3) belongs to currentThread's process
     if (validatecvindeces(indexcv, indexlock) == -1)
     {
@@ -875,9 +1102,9 @@ int Signal_Syscall(int indexcv, int indexlock)
     // Marked for deletion and no waiting threads, delete
     if (curKernelCV->toDelete && curKernelCV->condition->waitqueue->IsEmpty())
     {
-        conditionsLock->Acquire();
+        conditionsLock->AcquireWrite();
         deletecondition(indexcv);
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
     }
 
     return indexcv;
@@ -898,6 +1125,11 @@ int Signal_Syscall(int indexcv, int indexlock)
 
 int Broadcast_Syscall(int indexcv, int indexlock)
 {
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(BroadcastOp, indexlock, indexcv, 0, 0, 0);
+#endif
+
     // Lock/CV indeces: (1) valid location, (2) defined, (3) belongs to currentThread's process
     if (validatecvindeces(indexcv, indexlock) == -1)
     {
@@ -910,9 +1142,9 @@ int Broadcast_Syscall(int indexcv, int indexlock)
     // Just woke up any waiting threads. If marked for deletion, now delete.
     if (curKernelCV->toDelete)
     {
-        conditionsLock->Acquire();
+        conditionsLock->AcquireWrite();
         deletecondition(indexcv);
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
     }
 
     return indexcv;
@@ -933,13 +1165,18 @@ int Broadcast_Syscall(int indexcv, int indexlock)
 
 int DestroyCV_Syscall(int indexcv)
 {
-    conditionsLock->Acquire();
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(DestroyCVOp, -1, indexcv, 0, 0, 0);
+#endif
+
+    conditionsLock->AcquireWrite();
 
     // Lock/CV indeces: (1) valid location, (2) defined, (3) belongs to currentThread's process
     if (indexcv < 0) 
     {
         printf("%s","Invalid index for destroy\n");
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return -1;
     }
 
@@ -948,7 +1185,7 @@ int DestroyCV_Syscall(int indexcv)
     if (indexcv > size - 1) 
     {
         printf("%s","index out of bounds for destroy\n");
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return -1;
     }
 
@@ -957,14 +1194,14 @@ int DestroyCV_Syscall(int indexcv)
     if (!currentKernelCV || !currentKernelCV->condition)
     {
         printf("Condition struct or condition var of index %d is null and can't be destroyed.\n", indexcv);
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return -1;
     }
 
     if (currentKernelCV->space != currentThread->space) 
     {
         printf("Condition of index %d does not belong to the current process\n", indexcv);
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return -1;
     }
 
@@ -972,14 +1209,600 @@ int DestroyCV_Syscall(int indexcv)
     if (currentKernelCV->condition->waitqueue->IsEmpty())
     {
         deletecondition(indexcv);
-        conditionsLock->Release();
+        conditionsLock->ReleaseWrite();
         return 0;
     }
 
     // Mark for later deletion by (1) last thread to Signal or (2) any thread to Broadcast
     printf("Condition %d toDelete set to true. Cannot be deleted since waitqueue is not empty.\n", indexcv);
     currentKernelCV->toDelete = true;
-    conditionsLock->Release();
+    conditionsLock->ReleaseWrite();
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// copyinname
+//  Copy the name of a new synchronization object in from user memory.
+//
+//  Returns a new, null-terminated kernel copy, or NULL if the length or
+//  pointer is bad.
+//
+//  "vaddr" -- the virtual address of the name
+//  "len" -- length of the name
+//  "what" -- what is being created, for the error message
+//----------------------------------------------------------------------
+
+char * copyinname(unsigned int vaddr, int len, char * what)
+{
+    // Validate length is nonzero and positive
+    if (len <= 0)
+    {
+        printf("Length for %s's identifier name must be nonzero and positive\n", what);
+        return NULL;
+    }
+
+    char * buf = new char[len + 1];
+
+    // Translation failed; else string copied into buf (!= -1)
+    if (copyin(vaddr, len, buf) == -1)
+    {
+        printf("Bad pointer passed to create new %s\n", what);
+        delete[] buf;
+        return NULL;
+    }
+
+    buf[len] = '\0'; // Add null terminating character to name
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// startsleeping, stopsleeping
+//  Keep the process table consistent around a call that may put the
+//  thread to sleep, as in AcquireLock_Syscall.
+//----------------------------------------------------------------------
+
+void startsleeping()
+{
+    processLock->Acquire();
+    processInfo.at(currentThread->processID)->numExecutingThreads--;
+    processInfo.at(currentThread->processID)->numSleepingThreads++;
+    processLock->Release();
+}
+
+void stopsleeping()
+{
+    processLock->Acquire();
+    processInfo.at(currentThread->processID)->numExecutingThreads++;
+    processInfo.at(currentThread->processID)->numSleepingThreads--;
+    processLock->Release();
+}
+
+//----------------------------------------------------------------------
+// findrwlock
+//  Look up a reader-writer lock, checking that "index" is a (1) valid
+//  location, (2) defined rwlock that (3) belongs to currentThread's 
+//  process. Lookups only hold the table for reading, so they don't
+//  wait for one another; only Create and Destroy keep them out.
+//
+//  The table can't stay held while the rwlock is in use, since a
+//  thread may block in it, so the entry is counted as in use instead
+//  and won't be deleted until the matching putrwlock.
+//
+//  Returns the KernelRWLock, or NULL if "index" is invalid
+//
+//  "index" -- the location of the KernelRWLock object inside rwlocks
+//----------------------------------------------------------------------
+
+KernelRWLock * findrwlock(int index)
+{
+    KernelRWLock * curKernelRWLock = NULL;
+
+    rwlocksLock->AcquireRead();
+    if (index < 0 || index > (int) rwlocks.size() - 1)
+        printf("Invalid rwlock table index %d.\n", index);
+    else if (!rwlocks.at(index))
+        printf("RWLock %d is NULL.\n", index);
+    else if (rwlocks.at(index)->space != currentThread->space)
+        printf("RWLock %d does not belong to the current process.\n", index);
+    else
+    {
+        curKernelRWLock = rwlocks.at(index);
+
+        // Other readers may be counting in too
+        IntStatus oldLevel = interrupt->SetLevel(IntOff);
+        curKernelRWLock->users++;
+        (void) interrupt->SetLevel(oldLevel);
+    }
+    rwlocksLock->ReleaseRead();
+
+    return curKernelRWLock;
+}
+
+//----------------------------------------------------------------------
+// deleterwlock
+//  Delete the rwlock at "index". The caller holds rwlocksLock for
+//  writing, and nobody may be using, holding or waiting for the rwlock.
+//
+//  "index" -- the (valid) index of the rwlock inside rwlocks
+//----------------------------------------------------------------------
+
+void deleterwlock(int index)
+{
+    KernelRWLock * curKernelRWLock = rwlocks.at(index);
+
+    delete curKernelRWLock->rwlock;
+    delete curKernelRWLock;
+    rwlocks.at(index) = NULL;
+
+    printf("RWLock %d was successfully deleted.\n", index);
+}
+
+//----------------------------------------------------------------------
+// putrwlock
+//  Done with a rwlock returned by findrwlock. If it's marked for
+//  deletion and nobody else is using, holding or waiting for it,
+//  delete it.
+//
+//  Returns TRUE if the rwlock was deleted
+//
+//  "index" -- the index of the rwlock inside rwlocks
+//  "curKernelRWLock" -- what findrwlock returned for "index"
+//----------------------------------------------------------------------
+
+bool putrwlock(int index, KernelRWLock * curKernelRWLock)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    curKernelRWLock->users--;
+    bool toDelete = curKernelRWLock->toDelete;
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (!toDelete)
+    {
+        return FALSE;
+    }
+
+    // Another thread may have deleted it while we waited for the
+    // table, so check it's still there before looking at it
+    bool deleted = FALSE;
+
+    rwlocksLock->AcquireWrite();
+    if (rwlocks.at(index) == curKernelRWLock
+        && curKernelRWLock->users == 0 && !curKernelRWLock->rwlock->isBusy())
+    {
+        deleterwlock(index);
+        deleted = TRUE;
+    }
+    rwlocksLock->ReleaseWrite();
+
+    return deleted;
+}
+
+//----------------------------------------------------------------------
+// CreateRWLock_Syscall
+//  Creates a reader-writer lock with the specified name.
+//
+//  Returns "indexrwlock" for AcquireRead, AcquireWrite and the
+//  Releases; -1 on error
+//
+//  "vaddr" -- the virtual address of the rwlock name
+//  "len" -- length of rwlock name
+//----------------------------------------------------------------------
+
+int CreateRWLock_Syscall(unsigned int vaddr, int len)
+{
+    char * buf = copyinname(vaddr, len, "rwlock");
+
+    if (!buf)
+    {
+        return -1;
+    }
+
+    KernelRWLock * newKernelRWLock = new KernelRWLock();
+    newKernelRWLock->toDelete = false;
+    newKernelRWLock->users = 0;
+    newKernelRWLock->space = currentThread->space;
+    newKernelRWLock->rwlock = new RWLock(buf);
+
+    rwlocksLock->AcquireWrite();
+    rwlocks.push_back(newKernelRWLock);
+    int indexrwlock = rwlocks.size() - 1;
+    rwlocksLock->ReleaseWrite();
+
+    return indexrwlock;
+}
+
+//----------------------------------------------------------------------
+// AcquireRWLock
+//  Acquire the rwlock at "indexrwlock" for reading or writing, if it
+//  is valid and hasn't been marked for deletion. The thread may sleep.
+//
+//  Returns "indexrwlock", or -1 on error
+//
+//  "indexrwlock" -- index of the rwlock inside rwlocks
+//  "write" -- acquire for writing, rather than reading?
+//----------------------------------------------------------------------
+
+int AcquireRWLock(int indexrwlock, bool write)
+{
+    KernelRWLock * curKernelRWLock = findrwlock(indexrwlock);
+
+    if (!curKernelRWLock)
+    {
+        return -1;
+    }
+
+    if (curKernelRWLock->toDelete)
+    {
+        printf("Cannot acquire rwlock %d because it's been marked for deletion.\n", indexrwlock);
+        putrwlock(indexrwlock, curKernelRWLock);
+        return -1;
+    }
+
+    if (write && curKernelRWLock->rwlock->isWriteHeldByCurrentThread())
+    {
+        printf("RWLock %d is already held for writing by this thread.\n", indexrwlock);
+        putrwlock(indexrwlock, curKernelRWLock);
+        return -1;
+    }
+
+    startsleeping();
+    if (write)
+        curKernelRWLock->rwlock->AcquireWrite();
+    else
+        curKernelRWLock->rwlock->AcquireRead();
+    stopsleeping();
+
+    putrwlock(indexrwlock, curKernelRWLock);
+    return indexrwlock;
+}
+
+//----------------------------------------------------------------------
+// ReleaseRWLock
+//  Release the current thread's hold on the rwlock at "indexrwlock".
+//  If the rwlock is marked for deletion and nobody else is using it,
+//  delete it.
+//
+//  Returns "indexrwlock", or -1 on error
+//
+//  "indexrwlock" -- index of the rwlock inside rwlocks
+//  "write" -- release a hold for writing, rather than reading?
+//----------------------------------------------------------------------
+
+int ReleaseRWLock(int indexrwlock, bool write)
+{
+    KernelRWLock * curKernelRWLock = findrwlock(indexrwlock);
+
+    if (!curKernelRWLock)
+    {
+        return -1;
+    }
+
+    RWLock * rwlock = curKernelRWLock->rwlock;
+
+    if (write ? !rwlock->isWriteHeldByCurrentThread()
+              : !rwlock->isReadHeldByCurrentThread())
+    {
+        printf("RWLock %d is not held for %s by this thread.\n", indexrwlock, write ? "writing" : "reading");
+        putrwlock(indexrwlock, curKernelRWLock);
+        return -1;
+    }
+
+    if (write)
+        rwlock->ReleaseWrite();
+    else
+        rwlock->ReleaseRead();
+
+    putrwlock(indexrwlock, curKernelRWLock);
+    return indexrwlock;
+}
+
+int AcquireRead_Syscall(int indexrwlock)  { return AcquireRWLock(indexrwlock, FALSE); }
+int AcquireWrite_Syscall(int indexrwlock) { return AcquireRWLock(indexrwlock, TRUE); }
+int ReleaseRead_Syscall(int indexrwlock)  { return ReleaseRWLock(indexrwlock, FALSE); }
+int ReleaseWrite_Syscall(int indexrwlock) { return ReleaseRWLock(indexrwlock, TRUE); }
+
+//----------------------------------------------------------------------
+// DestroyRWLock_Syscall
+//  Deletes the rwlock, or marks it for deletion by the last thread to
+//  release it if anyone is holding or waiting for it.
+//
+//  Returns 0 if deleted now, -1 if invalid index or deletion is put off
+//
+//  "indexrwlock" -- index of the rwlock inside rwlocks
+//----------------------------------------------------------------------
+
+int DestroyRWLock_Syscall(int indexrwlock)
+{
+    KernelRWLock * curKernelRWLock = findrwlock(indexrwlock);
+
+    if (!curKernelRWLock)
+    {
+        return -1;
+    }
+
+    curKernelRWLock->toDelete = true;
+    if (putrwlock(indexrwlock, curKernelRWLock))
+    {
+        return 0;
+    }
+
+    printf("RWLock %d toDelete is set to true. Cannot be deleted because it is in use.\n", indexrwlock);
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// findbarrier
+//  Look up a barrier, checking that "index" is a (1) valid location,
+//  (2) defined barrier that (3) belongs to currentThread's process.
+//  As in findrwlock, the table is only held for reading, and the entry
+//  is counted as in use until the matching putbarrier.
+//
+//  Returns the KernelBarrier, or NULL if "index" is invalid
+//
+//  "index" -- the location of the KernelBarrier object inside barriers
+//----------------------------------------------------------------------
+
+KernelBarrier * findbarrier(int index)
+{
+    KernelBarrier * curKernelBarrier = NULL;
+
+    barriersLock->AcquireRead();
+    if (index < 0 || index > (int) barriers.size() - 1)
+        printf("Invalid barrier table index %d.\n", index);
+    else if (!barriers.at(index))
+        printf("Barrier %d is NULL.\n", index);
+    else if (barriers.at(index)->space != currentThread->space)
+        printf("Barrier %d does not belong to the current process.\n", index);
+    else
+    {
+        curKernelBarrier = barriers.at(index);
+
+        IntStatus oldLevel = interrupt->SetLevel(IntOff);
+        curKernelBarrier->users++;
+        (void) interrupt->SetLevel(oldLevel);
+    }
+    barriersLock->ReleaseRead();
+
+    return curKernelBarrier;
+}
+
+//----------------------------------------------------------------------
+// deletebarrier
+//  Delete the barrier at "index". The caller holds barriersLock for
+//  writing, and nobody may be using or waiting at the barrier.
+//
+//  "index" -- the (valid) index of the barrier inside barriers
+//----------------------------------------------------------------------
+
+void deletebarrier(int index)
+{
+    KernelBarrier * curKernelBarrier = barriers.at(index);
+
+    delete curKernelBarrier->barrier;
+    delete curKernelBarrier;
+    barriers.at(index) = NULL;
+
+    printf("Barrier %d was successfully deleted.\n", index);
+}
+
+//----------------------------------------------------------------------
+// putbarrier
+//  Done with a barrier returned by findbarrier. If it's marked for
+//  deletion and nobody else is using or waiting at it, delete it.
+//
+//  Returns TRUE if the barrier was deleted
+//
+//  "index" -- the index of the barrier inside barriers
+//  "curKernelBarrier" -- what findbarrier returned for "index"
+//----------------------------------------------------------------------
+
+bool putbarrier(int index, KernelBarrier * curKernelBarrier)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    curKernelBarrier->users--;
+    bool toDelete = curKernelBarrier->toDelete;
+    (void) interrupt->SetLevel(oldLevel);
+
+    if (!toDelete)
+    {
+        return FALSE;
+    }
+
+    bool deleted = FALSE;
+
+    barriersLock->AcquireWrite();
+    if (barriers.at(index) == curKernelBarrier
+        && curKernelBarrier->users == 0 && !curKernelBarrier->barrier->isBusy())
+    {
+        deletebarrier(index);
+        deleted = TRUE;
+    }
+    barriersLock->ReleaseWrite();
+
+    return deleted;
+}
+
+//----------------------------------------------------------------------
+// CreateBarrier_Syscall
+//  Creates a barrier with the specified name, for "count" threads.
+//
+//  Returns "indexbarrier" for BarrierWait; -1 on error
+//
+//  "vaddr" -- the virtual address of the barrier name
+//  "len" -- length of barrier name
+//  "count" -- how many threads must arrive before any goes on
+//----------------------------------------------------------------------
+
+int CreateBarrier_Syscall(unsigned int vaddr, int len, int count)
+{
+    if (count <= 0)
+    {
+        printf("%s","Barrier count must be positive\n");
+        return -1;
+    }
+
+    char * buf = copyinname(vaddr, len, "barrier");
+
+    if (!buf)
+    {
+        return -1;
+    }
+
+    KernelBarrier * newKernelBarrier = new KernelBarrier();
+    newKernelBarrier->toDelete = false;
+    newKernelBarrier->users = 0;
+    newKernelBarrier->space = currentThread->space;
+    newKernelBarrier->barrier = new Barrier(buf, count);
+
+    barriersLock->AcquireWrite();
+    barriers.push_back(newKernelBarrier);
+    int indexbarrier = barriers.size() - 1;
+    barriersLock->ReleaseWrite();
+
+    return indexbarrier;
+}
+
+//----------------------------------------------------------------------
+// BarrierWait_Syscall
+//  Wait at the barrier until all its threads have arrived. If the
+//  barrier was marked for deletion, the last thread out of the
+//  syscall deletes it once the others are let go.
+//
+//  Returns 1 in the last thread to arrive, 0 in the others, -1 on error
+//
+//  "indexbarrier" -- index of the barrier inside barriers
+//----------------------------------------------------------------------
+
+int BarrierWait_Syscall(int indexbarrier)
+{
+    KernelBarrier * curKernelBarrier = findbarrier(indexbarrier);
+
+    if (!curKernelBarrier)
+    {
+        return -1;
+    }
+
+    // A barrier marked for deletion still lets its current round finish,
+    // or the threads already waiting would never be let go
+    startsleeping();
+    bool last = curKernelBarrier->barrier->Wait();
+    stopsleeping();
+
+    putbarrier(indexbarrier, curKernelBarrier);
+    return last ? 1 : 0;
+}
+
+//----------------------------------------------------------------------
+// DestroyBarrier_Syscall
+//  Deletes the barrier, or marks it for deletion at the end of the
+//  current round if threads are waiting at it.
+//
+//  Returns 0 if deleted now, -1 if invalid index or deletion is put off
+//
+//  "indexbarrier" -- index of the barrier inside barriers
+//----------------------------------------------------------------------
+
+int DestroyBarrier_Syscall(int indexbarrier)
+{
+    KernelBarrier * curKernelBarrier = findbarrier(indexbarrier);
+
+    if (!curKernelBarrier)
+    {
+        return -1;
+    }
+
+    curKernelBarrier->toDelete = true;
+    if (putbarrier(indexbarrier, curKernelBarrier))
+    {
+        return 0;
+    }
+
+    printf("Barrier %d toDelete is set to true. Cannot be deleted because threads are waiting.\n", indexbarrier);
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// CreateMV_Syscall
+//  Creates (or finds, if one by that name exists) a monitor variable
+//  of "size" ints on the lock server. MVs only exist on the server, so
+//  Nachos must have been started with "-ls".
+//
+//  Returns "indexmv" for GetMV, SetMV and DestroyMV; -1 on error
+//
+//  "vaddr" -- the virtual address of the MV name
+//  "len" -- length of MV name
+//  "size" -- number of ints in the MV
+//----------------------------------------------------------------------
+
+int CreateMV_Syscall(unsigned int vaddr, int len, int size)
+{
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(CreateMVOp, -1, -1, size, vaddr, len);
+#endif
+
+    printf("%s","Monitor variables need a lock server (-ls)\n");
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// GetMV_Syscall
+//  Reads element "index" of a monitor variable from the server. Any
+//  SetMVs this machine has batched up go to the server first.
+//
+//  Returns the value, or -1 if the MV or index is invalid
+//----------------------------------------------------------------------
+
+int GetMV_Syscall(int indexmv, int index)
+{
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(GetMVOp, indexmv, index, 0, 0, 0);
+#endif
+
+    printf("%s","Monitor variables need a lock server (-ls)\n");
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SetMV_Syscall
+//  Sets element "index" of a monitor variable. Doesn't wait for the
+//  server: the update is batched, and sent with this machine's next
+//  request (for instance, the Release of the lock protecting the MV).
+//  Errors, like a bad index, are silently ignored by the server.
+//
+//  Returns "value"
+//----------------------------------------------------------------------
+
+int SetMV_Syscall(int indexmv, int index, int value)
+{
+#ifdef NETWORK
+    if (lockClient)
+    {
+        lockClient->Post(SetMVOp, indexmv, index, value);
+        return value;
+    }
+#endif
+
+    printf("%s","Monitor variables need a lock server (-ls)\n");
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// DestroyMV_Syscall
+//  Deletes a monitor variable on the server.
+//
+//  Returns 0 if deleted, -1 if invalid
+//----------------------------------------------------------------------
+
+int DestroyMV_Syscall(int indexmv)
+{
+#ifdef NETWORK
+    if (lockClient)
+        return RemoteLockCall(DestroyMVOp, indexmv, 0, 0, 0, 0);
+#endif
+
+    printf("%s","Monitor variables need a lock server (-ls)\n");
     return -1;
 }
 
@@ -1008,6 +1831,12 @@ void Yield_Syscall()
 
 void Exit_Syscall(int status)
 {
+#ifdef NETWORK
+    // Don't leave batched SetMVs behind
+    if (lockClient)
+        lockClient->Flush();
+#endif
+
     currentThread->Yield(); // Stop executing thread
     processLock->Acquire();
 
@@ -1042,9 +1871,9 @@ void Exit_Syscall(int status)
             {
                 if (locks.at(i)->space == currentThread->space)
                 {
-                    locksLock->Acquire();
+                    locksLock->AcquireWrite();
                     deletelock(i);
-                    locksLock->Release();
+                    locksLock->ReleaseWrite();
                 }
             }
         }
@@ -1056,13 +1885,39 @@ void Exit_Syscall(int status)
             {
                 if (conditions.at(i)->space == currentThread->space)
                 {
-                    conditionsLock->Acquire();
+                    conditionsLock->AcquireWrite();
                     deletecondition(i);
-                    conditionsLock->Release();
+                    conditionsLock->ReleaseWrite();
                 }
             }
         }
 
+        rwlocksLock->AcquireWrite();
+        for (int i = 0; i < (int) rwlocks.size(); i++)
+        {
+            if (rwlocks.at(i) && rwlocks.at(i)->space == currentThread->space)
+            {
+                if (rwlocks.at(i)->users > 0 || rwlocks.at(i)->rwlock->isBusy())
+                    rwlocks.at(i)->toDelete = true;
+                else
+                    deleterwlock(i);
+            }
+        }
+        rwlocksLock->ReleaseWrite();
+
+        barriersLock->AcquireWrite();
+        for (int i = 0; i < (int) barriers.size(); i++)
+        {
+            if (barriers.at(i) && barriers.at(i)->space == currentThread->space)
+            {
+                if (barriers.at(i)->users > 0 || barriers.at(i)->barrier->isBusy())
+                    barriers.at(i)->toDelete = true;
+                else
+                    deletebarrier(i);
+            }
+        }
+        barriersLock->ReleaseWrite();
+
         currentThread->space->ReclaimPageTable();
 
         Process * p = processInfo.at(currentThread->processID);
@@ -1079,6 +1934,8 @@ void Exit_Syscall(int status)
     printf("Thread is last in process and this is last process. Nachos halting.\n");
     processLock->Release();
 
+    currentThread->space->UnmapAll();
+
     interrupt->Halt();
 }
 
@@ -1162,6 +2019,7 @@ void Fork_Syscall(unsigned int vaddr, int len, unsigned int vFuncAddr)
     Thread * t = new Thread(buf);
 
     t->processID = p->processID;
+    t->account->processID = p->processID;
     t->space = p->space;
 
     p->numExecutingThreads++;
@@ -1246,6 +2104,8 @@ void Exec_Syscall(int vaddr, int len)
 
     // Load executable into address space
     space = new AddrSpace(executable);
+    if (profileInterval > 0)
+        space->StartProfile(buf);
 
     // Add new process to process table; Used for determining how to handle Exits
     Process * p = new Process();
@@ -1258,6 +2118,7 @@ void Exec_Syscall(int vaddr, int len)
     // Thread needs to be able to restore itself on context switches (AS) and handling Exits (processID)
     Thread * t = new Thread(buf);
     t->processID = p->processID;
+    t->account->processID = p->processID;
     t->space = space;
 
     // Close executable; Completely loaded into AS
@@ -1275,6 +2136,88 @@ void Exec_Syscall(int vaddr, int len)
 
 void Join_Syscall() {}
 
+//----------------------------------------------------------------------
+// Syscall statistics
+//  For each syscall code, how many times it was called, and how long
+//  it took to return: in simulated ticks, and in nanoseconds of host
+//  time.  Both include any time spent blocked (e.g. waiting for a
+//  lock), since that is what the caller sees.  Exit and Halt never
+//  return, so they are counted but not timed.
+//----------------------------------------------------------------------
+
+static char *syscallNames[] = { "Halt", "Exit", "Exec", "Join", "Create",
+    "Open", "Read", "Write", "Close", "Fork", "Yield", "CreateLock",
+    "AcquireLock", "ReleaseLock", "DestroyLock", "CreateCV", "Wait",
+    "Signal", "Broadcast", "DestroyCV", "Random", "PrintError",
+    "PrintfOne", "PrintfTwo", "Mmap", "Munmap", "IoSetup", "IoEnter",
+    "CreateMV", "GetMV", "SetMV", "DestroyMV", "CreateRWLock",
+    "AcquireRead", "ReleaseRead", "AcquireWrite", "ReleaseWrite",
+    "DestroyRWLock", "CreateBarrier", "BarrierWait", "DestroyBarrier",
+    "SyscallStats" };
+
+static int syscallCounts[NumSyscallTypes];
+static LatencyHistogram syscallTicks[NumSyscallTypes];
+static LatencyHistogram syscallNanos[NumSyscallTypes];
+
+//----------------------------------------------------------------------
+// SyscallReport
+//  Print, for each syscall that has been called, the number of calls
+//  and the mean, median, 99th percentile and longest time to return,
+//  followed by the histograms they come from.  Prints nothing if no
+//  syscall has been made.  Called at Halt, and by SyscallStats.
+//----------------------------------------------------------------------
+
+void SyscallReport()
+{
+    LatencyHistogram *t, *n;
+    char number[16];
+    char *name;
+    bool any = FALSE;
+
+    for (int i = 0; i < NumSyscallTypes; i++)
+    {
+        if (syscallCounts[i] == 0)
+            continue;
+        if (!any)
+            printf("Syscalls:   calls   ticks: mean   p50   p99   max"
+                   "     ns: mean   p50   p99   max\n");
+        any = TRUE;
+        if (i < (int) (sizeof(syscallNames) / sizeof(char *)))
+            name = syscallNames[i];
+        else
+        {
+            sprintf(number, "syscall %d", i);
+            name = number;
+        }
+        t = &syscallTicks[i];
+        n = &syscallNanos[i];
+        printf("  %-14s %7d %11lld %5lld %5lld %5lld %10lld %5lld %5lld %5lld\n",
+               name, syscallCounts[i],
+               (long long) (t->count ? t->total / t->count : 0),
+               (long long) t->Percentile(50), (long long) t->Percentile(99),
+               (long long) t->longest,
+               (long long) (n->count ? n->total / n->count : 0),
+               (long long) n->Percentile(50), (long long) n->Percentile(99),
+               (long long) n->longest);
+        if (t->count > 0)
+        {
+            t->Print("ticks");
+            n->Print("ns");
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// SyscallStats_Syscall
+//  Print the syscall statistics so far, for a user program that wants
+//  them before it halts.
+//----------------------------------------------------------------------
+
+void SyscallStats_Syscall()
+{
+    SyscallReport();
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 //  When machine encounters an Exception while executing a user program,
@@ -1321,6 +2264,15 @@ void ExceptionHandler(ExceptionType which)
 
     if (which == SyscallException)
     {
+        int64_t startTicks = stats->totalTicks;
+        int64_t startNanos = HostNanos();
+
+        if (type >= 0 && type < NumSyscallTypes)
+        {
+            currentThread->account->numSyscalls[type]++;
+            syscallCounts[type]++;
+        }
+        TRACE(TraceSyscallEnter, type);
         switch (type) 
         {
             default:
@@ -1328,6 +2280,11 @@ void ExceptionHandler(ExceptionType which)
 
             case SC_Halt:
             DEBUG('a', "Shutdown, initiated by user program.\n");
+            currentThread->space->UnmapAll();
+#ifdef NETWORK
+            if (lockClient)
+                lockClient->Flush();
+#endif
             interrupt->Halt();
             break;
 
@@ -1444,6 +2401,96 @@ void ExceptionHandler(ExceptionType which)
             DEBUG('a', "Random syscall.\n");
             rv = Random_Syscall(machine->ReadRegister(4), machine->ReadRegister(5));
             break;
+
+            case SC_Mmap:
+            DEBUG('a', "Mmap syscall.\n");
+            rv = Mmap_Syscall(machine->ReadRegister(4), machine->ReadRegister(5), machine->ReadRegister(6));
+            break;
+
+            case SC_Munmap:
+            DEBUG('a', "Munmap syscall.\n");
+            Munmap_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_IoSetup:
+            DEBUG('a', "IoSetup syscall.\n");
+            rv = IoSetup_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_IoEnter:
+            DEBUG('a', "IoEnter syscall.\n");
+            rv = IoEnter_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_CreateRWLock:
+            DEBUG('a', "CreateRWLock syscall.\n");
+            rv = CreateRWLock_Syscall(machine->ReadRegister(4), machine->ReadRegister(5));
+            break;
+
+            case SC_AcquireRead:
+            DEBUG('a', "AcquireRead syscall.\n");
+            rv = AcquireRead_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_ReleaseRead:
+            DEBUG('a', "ReleaseRead syscall.\n");
+            rv = ReleaseRead_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_AcquireWrite:
+            DEBUG('a', "AcquireWrite syscall.\n");
+            rv = AcquireWrite_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_ReleaseWrite:
+            DEBUG('a', "ReleaseWrite syscall.\n");
+            rv = ReleaseWrite_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_DestroyRWLock:
+            DEBUG('a', "DestroyRWLock syscall.\n");
+            rv = DestroyRWLock_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_CreateBarrier:
+            DEBUG('a', "CreateBarrier syscall.\n");
+            rv = CreateBarrier_Syscall(machine->ReadRegister(4), machine->ReadRegister(5), machine->ReadRegister(6));
+            break;
+
+            case SC_BarrierWait:
+            DEBUG('a', "BarrierWait syscall.\n");
+            rv = BarrierWait_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_DestroyBarrier:
+            DEBUG('a', "DestroyBarrier syscall.\n");
+            rv = DestroyBarrier_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_CreateMV:
+            DEBUG('a', "CreateMV syscall.\n");
+            rv = CreateMV_Syscall(machine->ReadRegister(4), machine->ReadRegister(5), machine->ReadRegister(6));
+            break;
+
+            case SC_GetMV:
+            DEBUG('a', "GetMV syscall.\n");
+            rv = GetMV_Syscall(machine->ReadRegister(4), machine->ReadRegister(5));
+            break;
+
+            case SC_SetMV:
+            DEBUG('a', "SetMV syscall.\n");
+            rv = SetMV_Syscall(machine->ReadRegister(4), machine->ReadRegister(5), machine->ReadRegister(6));
+            break;
+
+            case SC_DestroyMV:
+            DEBUG('a', "DestroyMV syscall.\n");
+            rv = DestroyMV_Syscall(machine->ReadRegister(4));
+            break;
+
+            case SC_SyscallStats:
+            DEBUG('a', "SyscallStats syscall.\n");
+            SyscallStats_Syscall();
+            break;
         }
 
         // Put in the return value and increment the PC
@@ -1451,8 +2498,22 @@ void ExceptionHandler(ExceptionType which)
         machine->WriteRegister(PrevPCReg, machine->ReadRegister(PCReg));
         machine->WriteRegister(PCReg, machine->ReadRegister(NextPCReg));
         machine->WriteRegister(NextPCReg, machine->ReadRegister(PCReg) + 4);
+        if (type >= 0 && type < NumSyscallTypes)
+        {
+            syscallTicks[type].Record(stats->totalTicks - startTicks);
+            syscallNanos[type].Record(HostNanos() - startNanos);
+        }
+        TRACE(TraceSyscallExit, type);
         return;
     } 
+    else if (which == PageFaultException &&
+             currentThread->space->HandlePageFault(
+                machine->ReadRegister(BadVAddrReg) / PageSize))
+    {
+        // The page is in memory now; return without touching the PC,
+        // so the faulting instruction runs again
+        return;
+    }
     else 
     {
         cout<<"Unexpected user mode exception - which:"<<which<<"  type:"<< type<<endl;
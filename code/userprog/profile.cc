@@ -0,0 +1,240 @@
+// profile.cc
+//	Routines to profile a user program from samples of its PC, and
+//	print the profile by procedure.
+//
+//	A sample is just a count against the instruction the PC was at;
+//	the counts are only added up by procedure when the profile is
+//	printed, so sampling stays cheap.  The procedures are the text
+//	symbols in the external symbol table of the MIPS COFF file, which
+//	coff.h describes only up to the section headers; the rest of the
+//	layout is below.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "profile.h"
+#include "coff.h"
+
+// The MIPS symbolic header, found at f_symptr in the COFF file header.
+// We only need where the external symbols and their names are.
+
+struct CoffSymHeader {
+    short magic;
+    short vstamp;
+    int ilineMax, cbLine, cbLineOffset;
+    int idnMax, cbDnOffset;
+    int ipdMax, cbPdOffset;
+    int isymMax, cbSymOffset;
+    int ioptMax, cbOptOffset;
+    int iauxMax, cbAuxOffset;
+    int issMax, cbSsOffset;
+    int issExtMax, cbSsExtOffset;	// external symbols' names
+    int ifdMax, cbFdOffset;
+    int crfd, cbRfdOffset;
+    int iextMax, cbExtOffset;		// external symbols
+};
+
+// An external symbol.  "bits" packs the symbol type (low 6 bits) and
+// storage class (next 5).
+
+struct CoffExtSymbol {
+    short flags;
+    short ifd;
+    int iss;				// name, in the names of externals
+    int value;				// for a procedure, its address
+    unsigned int bits;
+};
+
+#define SymbolType(bits)	((bits) & 0x3f)
+#define SymbolClass(bits)	(((bits) >> 6) & 0x1f)
+#define stProc			6	// type of a procedure
+#define scText			1	// class of something in the text
+
+//----------------------------------------------------------------------
+// Profile::Profile
+// 	Start an empty profile.
+//
+//	"progName" is the program's executable.
+//	"start" and "size" are where its code is, in its address space.
+//----------------------------------------------------------------------
+
+Profile::Profile(char *progName, int start, int size)
+{
+    fileName = new char[strlen(progName) + 1];
+    strcpy(fileName, progName);
+    codeStart = start;
+    numWords = divRoundUp(size, 4);
+    counts = new int[numWords];
+    for (int i = 0; i < numWords; i++)
+	counts[i] = 0;
+    numSamples = numOutside = 0;
+    symbols = NULL;
+    numSymbols = 0;
+    strings = NULL;
+}
+
+//----------------------------------------------------------------------
+// Profile::~Profile
+// 	De-allocate the profile.
+//----------------------------------------------------------------------
+
+Profile::~Profile()
+{
+    delete [] fileName;
+    delete [] counts;
+    delete [] symbols;
+    delete [] strings;
+}
+
+//----------------------------------------------------------------------
+// Profile::LoadSymbols
+// 	Read the procedures, and their names, from the COFF file the
+//	program was made from, and put them in order of address.
+//
+// Returns:
+//	FALSE if there is no COFF file, or no procedures in it.
+//----------------------------------------------------------------------
+
+bool
+Profile::LoadSymbols()
+{
+    char *coffName = new char[strlen(fileName) + 6];
+    struct filehdr fileHeader;
+    CoffSymHeader symHeader;
+    CoffExtSymbol ext;
+    int numExternals, stringSize, address, i, j;
+    unsigned int bits;
+    FILE *file;
+
+    sprintf(coffName, "%s.coff", fileName);
+    file = fopen(coffName, "r");
+    delete [] coffName;
+    if (file == NULL)
+	return FALSE;
+    if ((fread(&fileHeader, sizeof(fileHeader), 1, file) != 1)
+		|| (ShortToHost(fileHeader.f_magic) != MIPSELMAGIC)
+		|| (fseek(file, WordToHost(fileHeader.f_symptr), 0) != 0)
+		|| (fread(&symHeader, sizeof(symHeader), 1, file) != 1)) {
+	fclose(file);
+	return FALSE;
+    }
+
+    stringSize = WordToHost(symHeader.issExtMax);
+    strings = new char[stringSize + 1];
+    fseek(file, WordToHost(symHeader.cbSsExtOffset), 0);
+    stringSize = fread(strings, 1, stringSize, file);
+    strings[stringSize] = '\0';
+
+    symbols = new ProfileSymbol[MaxProfileSymbols];
+    numExternals = WordToHost(symHeader.iextMax);
+    fseek(file, WordToHost(symHeader.cbExtOffset), 0);
+    for (i = 0; (i < numExternals) && (numSymbols < MaxProfileSymbols); i++) {
+	if (fread(&ext, sizeof(ext), 1, file) != 1)
+	    break;
+	bits = WordToHost(ext.bits);
+	ext.iss = WordToHost(ext.iss);
+	if ((SymbolType(bits) != stProc) || (SymbolClass(bits) != scText)
+		|| (ext.iss < 0) || (ext.iss >= stringSize))
+	    continue;
+
+	// insert in order of address
+	address = WordToHost(ext.value);
+	for (j = numSymbols; (j > 0) && (symbols[j - 1].address > address); j--)
+	    symbols[j] = symbols[j - 1];
+	symbols[j].address = address;
+	symbols[j].name = &strings[ext.iss];
+	symbols[j].samples = 0;
+	numSymbols++;
+    }
+    fclose(file);
+    return (numSymbols > 0);
+}
+
+//----------------------------------------------------------------------
+// Profile::Print
+// 	Print the ProfileLines procedures with the most samples, with
+//	their share of all the samples.  Prints nothing if there were no
+//	samples.
+//----------------------------------------------------------------------
+
+void
+Profile::Print()
+{
+    int unknown = 0;		// samples before the first procedure
+    ProfileSymbol swap;
+    int i, j, s, best;
+
+    if (numSamples == 0)
+	return;
+    printf("Profile of %s: %d samples, one every %d instructions\n",
+		fileName, numSamples, profileInterval);
+    if (!LoadSymbols()) {
+	PrintByAddress();
+	return;
+    }
+
+    // credit each instruction's samples to the procedure it is in
+    for (i = 0, s = 0; i < numWords; i++) {
+	if (counts[i] == 0)
+	    continue;
+	while ((s + 1 < numSymbols)
+		&& (symbols[s + 1].address <= codeStart + i * 4))
+	    s++;
+	if (symbols[s].address <= codeStart + i * 4)
+	    symbols[s].samples += counts[i];
+	else
+	    unknown += counts[i];
+    }
+
+    // busiest first
+    for (i = 0; (i < numSymbols) && (i < ProfileLines); i++) {
+	best = i;
+	for (j = i + 1; j < numSymbols; j++)
+	    if (symbols[j].samples > symbols[best].samples)
+		best = j;
+	if (symbols[best].samples == 0)
+	    break;
+	swap = symbols[i];
+	symbols[i] = symbols[best];
+	symbols[best] = swap;
+	printf("  %6.2f%% %8d  %s\n", symbols[i].samples * 100.0 / numSamples,
+		symbols[i].samples, symbols[i].name);
+    }
+    if (unknown > 0)
+	printf("  %6.2f%% %8d  (no procedure)\n", unknown * 100.0 / numSamples,
+		unknown);
+    if (numOutside > 0)
+	printf("  %6.2f%% %8d  (outside the code)\n",
+		numOutside * 100.0 / numSamples, numOutside);
+}
+
+//----------------------------------------------------------------------
+// Profile::PrintByAddress
+// 	Print the ProfileLines instructions with the most samples, for
+//	when there are no symbols to add them up by.
+//----------------------------------------------------------------------
+
+void
+Profile::PrintByAddress()
+{
+    int i, j, best;
+
+    printf("  (no symbols in %s.coff; by address)\n", fileName);
+    for (i = 0; i < ProfileLines; i++) {
+	best = 0;
+	for (j = 1; j < numWords; j++)
+	    if (counts[j] > counts[best])
+		best = j;
+	if ((numWords == 0) || (counts[best] == 0))
+	    break;
+	printf("  %6.2f%% %8d  0x%x\n", counts[best] * 100.0 / numSamples,
+		counts[best], codeStart + best * 4);
+	counts[best] = 0;		// so the next one is found
+    }
+    if (numOutside > 0)
+	printf("  %6.2f%% %8d  (outside the code)\n",
+		numOutside * 100.0 / numSamples, numOutside);
+}
@@ -0,0 +1,76 @@
+// profile.h
+//	Data structures for profiling user programs by sampling the
+//	simulated PC.
+//
+//	With "-prof <ticks>", Machine::Run looks at the PC of the user
+//	program every so many instructions, and counts it against the
+//	address space that is running.  When the address space goes away
+//	(at the process' last Exit, or when Nachos halts), the counts are
+//	printed as a flat profile: samples by procedure, busiest first.
+//
+//	NOFF files have no symbols, so procedure names come from the
+//	COFF file the program was made from, "<program>.coff" as the test
+//	Makefile leaves it.  Without it, the profile is by address.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "utility.h"
+
+#define MaxProfileSymbols	512	// procedures we keep names for
+#define ProfileLines		20	// procedures (or addresses) printed
+
+// A procedure from the COFF symbol table: where it starts, its name,
+// and the samples that fell in it.
+
+class ProfileSymbol {
+  public:
+    int address;
+    char *name;
+    int samples;
+};
+
+class Profile {
+  public:
+    Profile(char *progName, int start, int size);
+				// start an empty profile of the program
+				// in "progName", whose code is at
+				// "start" for "size" bytes
+    ~Profile();
+
+    void Sample(int pc)		// count one sample at "pc"
+    {
+	unsigned int word = (unsigned int) (pc - codeStart) / 4;
+
+	if (word < (unsigned int) numWords)
+	    counts[word]++;
+	else
+	    numOutside++;
+	numSamples++;
+    }
+
+    void Print();		// print the flat profile
+
+  private:
+    char *fileName;		// the program, for its COFF file
+    int codeStart;
+    int numWords;		// instructions in the code segment
+    int *counts;		// samples for each of them
+    int numSamples;
+    int numOutside;		// samples outside the code segment
+
+    ProfileSymbol *symbols;	// procedures, in order of address
+    int numSymbols;
+    char *strings;		// their names
+
+    bool LoadSymbols();		// read the procedures from the COFF file
+    void PrintByAddress();	// profile without symbols
+};
+
+#endif // PROFILE_H
@@ -37,6 +37,8 @@ void StartProcess(char *filename)
     }
 
     space = new AddrSpace(executable);
+    if (profileInterval > 0)
+	space->StartProfile(filename);
 
     Process * p = new Process();
 
@@ -47,6 +49,7 @@ void StartProcess(char *filename)
     p->numSleepingThreads = 0;
 
     currentThread->processID = p->processID;
+    currentThread->account->processID = p->processID;
     currentThread->space = space;
 
     delete executable;			// close file
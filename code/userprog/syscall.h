@@ -47,6 +47,24 @@
 #define SC_PrintError	21
 #define SC_PrintfOne	22
 #define SC_PrintfTwo	23
+#define SC_Mmap			24
+#define SC_Munmap		25
+#define SC_IoSetup		26
+#define SC_IoEnter		27
+#define SC_CreateMV		28
+#define SC_GetMV		29
+#define SC_SetMV		30
+#define SC_DestroyMV	31
+#define SC_CreateRWLock	32
+#define SC_AcquireRead	33
+#define SC_ReleaseRead	34
+#define SC_AcquireWrite	35
+#define SC_ReleaseWrite	36
+#define SC_DestroyRWLock	37
+#define SC_CreateBarrier	38
+#define SC_BarrierWait	39
+#define SC_DestroyBarrier	40
+#define SC_SyscallStats	41
 
 
 #define MAXFILENAME 256
@@ -269,6 +287,65 @@ int Broadcast(int indexcv, int indexlock);
 
 int DestroyCV(int indexcv);
 
+//----------------------------------------------------------------------
+// CreateRWLock
+//	Creates reader-writer lock with name and returns index to it for
+//	future access.  Any number of threads may hold it for reading at
+//	once, or one thread for writing.  Once a writer is waiting, new
+//	readers wait behind it.  These are always local, even with "-ls".
+//----------------------------------------------------------------------
+
+int CreateRWLock(char *name, int size);
+
+//----------------------------------------------------------------------
+// AcquireRead, ReleaseRead
+//	Hold, or stop holding, rwlock "indexrwlock" for reading.
+//----------------------------------------------------------------------
+
+int AcquireRead(int indexrwlock);
+int ReleaseRead(int indexrwlock);
+
+//----------------------------------------------------------------------
+// AcquireWrite, ReleaseWrite
+//	Hold, or stop holding, rwlock "indexrwlock" for writing.
+//----------------------------------------------------------------------
+
+int AcquireWrite(int indexrwlock);
+int ReleaseWrite(int indexrwlock);
+
+//----------------------------------------------------------------------
+// DestroyRWLock
+//	Deletes rwlock, or marks it for deletion when the last thread
+//	using it releases it.
+//----------------------------------------------------------------------
+
+int DestroyRWLock(int indexrwlock);
+
+//----------------------------------------------------------------------
+// CreateBarrier
+//	Creates barrier with name for "count" threads, and returns index
+//	to it for future access.
+//----------------------------------------------------------------------
+
+int CreateBarrier(char *name, int size, int count);
+
+//----------------------------------------------------------------------
+// BarrierWait
+//	Waits until "count" threads have called BarrierWait on the barrier,
+//	then lets them all go on; the barrier is then ready to be used
+//	again.  Returns 1 in the last thread to arrive, 0 in the others.
+//----------------------------------------------------------------------
+
+int BarrierWait(int indexbarrier);
+
+//----------------------------------------------------------------------
+// DestroyBarrier
+//	Deletes barrier, or marks it for deletion once the threads waiting
+//	at it have been let go.
+//----------------------------------------------------------------------
+
+int DestroyBarrier(int indexbarrier);
+
 
 //======================================================================
 //	
@@ -304,6 +381,142 @@ void PrintError(char *buffer, int size);
 
 int Random(int lower, int upper);
 
+//----------------------------------------------------------------------
+// Mmap
+//	Map "length" bytes of the open file "id", starting at "offset" (a
+//	multiple of the page size), into the address space.  A "length"
+//	of 0 maps the rest of the file.  Returns the address of the
+//	mapping, or -1.  Pages are read from the file as they are
+//	touched; changes go back to the file on Munmap, Close or Exit.
+//----------------------------------------------------------------------
+
+int Mmap(OpenFileId id, int offset, int length);
+
+//----------------------------------------------------------------------
+// Munmap
+//	Undo the Mmap that returned "addr", writing changes to the file.
+//----------------------------------------------------------------------
+
+void Munmap(int addr);
+
+//----------------------------------------------------------------------
+// SyscallStats
+//	Print, for each syscall made so far by anyone, the number of
+//	calls and how long they took, in ticks and in host time.  The
+//	same report is printed when Nachos halts.
+//----------------------------------------------------------------------
+
+void SyscallStats();
+
+//======================================================================
+//	
+//	Asynchronous I/O
+//	
+//	A process sets up a submission ring and a completion ring in its
+//	own memory, and registers them with IoSetup.  To start I/O, it
+//	fills in IoRequests at sq[sqTail % size], advances sqTail, and
+//	calls IoEnter.  Kernel I/O threads do the reads and writes while
+//	the process keeps running; each finished request shows up as an
+//	IoCompletion at cq[cqTail % size].  The process consumes
+//	completions by advancing cqHead.
+//
+//	Head and tail counters only ever increase.  The kernel never
+//	has more requests outstanding than there is room for in the
+//	completion ring; any extra stay in the submission ring until a
+//	later IoEnter.
+//	
+//======================================================================
+
+#define IoRead		0
+#define IoWrite		1
+
+#define MaxIoRingSize	256
+
+typedef struct {
+    int op;			/* IoRead or IoWrite */
+    int fd;			/* open file (not the console) */
+    char *buf;			/* where to read into/write from */
+    int len;			/* bytes to transfer */
+    int offset;			/* position in the file */
+    int tag;			/* returned in the completion */
+} IoRequest;
+
+typedef struct {
+    int tag;			/* the request's tag */
+    int result;			/* bytes transferred, or -1 */
+} IoCompletion;
+
+typedef struct {
+    int size;			/* entries in each ring */
+    int sqHead, sqTail;		/* kernel advances sqHead */
+    int cqHead, cqTail;		/* kernel advances cqTail */
+    IoRequest *sq;
+    IoCompletion *cq;
+} IoRing;
+
+//----------------------------------------------------------------------
+// IoSetup
+//	Register "ring" for asynchronous I/O.  Returns 0, or -1 if the
+//	ring is bad or the process already registered one.  Writes to a
+//	buffer the process is reading into are only safe to look at
+//	after the completion arrives.
+//----------------------------------------------------------------------
+
+int IoSetup(IoRing *ring);
+
+//----------------------------------------------------------------------
+// IoEnter
+//	Submit the requests between sqHead and sqTail, then wait until
+//	at least "minComplete" completions are waiting to be consumed
+//	(or nothing is outstanding).  Returns the number of requests
+//	submitted.
+//----------------------------------------------------------------------
+
+int IoEnter(int minComplete);
+
+//======================================================================
+//	
+//	Monitor variables
+//	
+//	Arrays of ints kept by the lock server, shared by every process
+//	that creates one with the same name, on any machine.  Nachos
+//	must be started with "-ls <server id>".  Protect them with a
+//	lock from CreateLock, which is shared the same way.
+//	
+//======================================================================
+
+//----------------------------------------------------------------------
+// CreateMV
+//	Create the MV called "name", with "size" ints all set to 0, or
+//	find it if it already exists.  Returns its index, or -1.
+//----------------------------------------------------------------------
+
+int CreateMV(char *name, int len, int size);
+
+//----------------------------------------------------------------------
+// GetMV
+//	Return element "index" of MV "indexmv".
+//----------------------------------------------------------------------
+
+int GetMV(int indexmv, int index);
+
+//----------------------------------------------------------------------
+// SetMV
+//	Set element "index" of MV "indexmv" to "value".  Doesn't wait for
+//	the server; the update is sent with this process's machine's
+//	next request to the server, so it is visible to other processes
+//	once the lock protecting the MV has been released.
+//----------------------------------------------------------------------
+
+int SetMV(int indexmv, int index, int value);
+
+//----------------------------------------------------------------------
+// DestroyMV
+//	Delete MV "indexmv".  Returns 0, or -1 if there is no such MV.
+//----------------------------------------------------------------------
+
+int DestroyMV(int indexmv);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
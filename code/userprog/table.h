@@ -7,12 +7,13 @@
 
 #include "bitmap.h"
 
-class Lock;
+class RWLock;
 
 class Table {
     BitMap map;
     void **table;
-    Lock *lock;
+    RWLock *lock;	// Get only reads, so lookups don't
+			// hold each other up
     int size;
  public:
     Table(int);